@@ -85,27 +85,55 @@ SRes SzFolder_Decode(const CSzFolder *folder, const UInt64 *packSizes,
     ILookInStream *stream, UInt64 startPos,
     Byte *outBuffer, size_t outSize, ISzAlloc *allocMain);
 
+/*
+SzFolder_CheckSupported returns SZ_OK, if the coders of folder can be decoded,
+  or SZ_ERROR_UNSUPPORTED. It doesn't allocate any memory.
+  Folders with BCJ2 filter (4 coders) can be decoded only with SzFolder_Decode.
+*/
+
+SRes SzFolder_CheckSupported(const CSzFolder *folder);
+
+/*
+SzFolder_DecodeToStream decodes folder and writes its data to outStream
+  in small pieces, as they are decoded. Only the dictionary of LZMA / LZMA2
+  (not larger than the folder) and small buffers are allocated.
+  It returns SZ_ERROR_UNSUPPORTED for BCJ2 folders before any data is written.
+  It returns SZ_ERROR_WRITE, if outStream writes less data than requested.
+  The model of PPMd is allocated with allocModel, all other memory with allocMain.
+  allocModel can be same as allocMain.
+*/
+
+SRes SzFolder_DecodeToStream(const CSzFolder *folder, const UInt64 *packSizes,
+    ILookInStream *stream, UInt64 startPos,
+    ISeqOutStream *outStream, ISzAlloc *allocMain, ISzAlloc *allocModel);
+
 typedef struct
 {
   UInt32 Low;
   UInt32 High;
 } CNtfsFileTime;
 
+/* Bit arrays have one bit per item, the highest bit of byte first
+   (same order as bit vectors in 7z headers). */
+
+#define SzBitArray_Check(p, i) (((p)[(i) >> 3] & (0x80 >> ((i) & 7))) != 0)
+
+/* Vals[i] is valid, if bit (i) in Defs is set.
+   Defs and Vals are NULL, if the property is not defined for any file. */
+
+#define SzBitWithVals_Check(p, i) ((p)->Defs != 0 && SzBitArray_Check((p)->Defs, i))
+
+typedef struct
+{
+  Byte *Defs;
+  UInt32 *Vals;
+} CSzBitUi32s;
+
 typedef struct
 {
-  CNtfsFileTime MTime;
-  UInt64 Size;
-  UInt32 Crc;
-  UInt32 Attrib;
-  Byte HasStream;
-  Byte IsDir;
-  Byte IsAnti;
-  Byte CrcDefined;
-  Byte MTimeDefined;
-  Byte AttribDefined;
-} CSzFileItem;
-
-void SzFile_Init(CSzFileItem *p);
+  Byte *Defs;
+  CNtfsFileTime *Vals;
+} CSzBitNtfsTimes;
 
 typedef struct
 {
@@ -113,10 +141,19 @@ typedef struct
   Byte *PackCRCsDefined;
   UInt32 *PackCRCs;
   CSzFolder *Folders;
-  CSzFileItem *Files;
   UInt32 NumPackStreams;
   UInt32 NumFolders;
   UInt32 NumFiles;
+
+  /* Files are stored as structure of arrays of (NumFiles) items.
+     UnpackPositions has (NumFiles + 1) items: the file (i) takes
+     [UnpackPositions[i], UnpackPositions[i + 1]) in the sequence of all unpacked streams.
+     IsDirs is NULL, if there are no directories. */
+  UInt64 *UnpackPositions;
+  Byte *IsDirs;
+  CSzBitUi32s CRCs;
+  CSzBitUi32s Attribs;
+  CSzBitNtfsTimes MTimes;
 } CSzAr;
 
 void SzAr_Init(CSzAr *p);
@@ -155,10 +192,16 @@ typedef struct
   UInt32 *FolderStartFileIndex;
   UInt32 *FileIndexToFolderIndexMap;
 
-  size_t *FileNameOffsets; /* in 2-byte steps */
+  UInt32 *FileNameOffsets; /* in 2-byte steps, (NumFiles + 1) items */
   CBuf FileNames;  /* UTF-16-LE */
+
+  UInt32 *NameHash; /* (NameHashMask + 1) items: (file index + 1) or 0 for empty slot */
+  UInt32 NameHashMask;
 } CSzArEx;
 
+#define SzArEx_GetFileSize(p, i) ((p)->db.UnpackPositions[(i) + 1] - (p)->db.UnpackPositions[i])
+#define SzArEx_IsDir(p, i) ((p)->db.IsDirs != 0 && SzBitArray_Check((p)->db.IsDirs, i))
+
 void SzArEx_Init(CSzArEx *p);
 void SzArEx_Free(CSzArEx *p, ISzAlloc *alloc);
 UInt64 SzArEx_GetFolderStreamPos(const CSzArEx *p, UInt32 folderIndex, UInt32 indexInFolder);
@@ -172,6 +215,20 @@ if dest != NULL, the return value specifies the number of 16-bit characters that
 
 size_t SzArEx_GetFileNameUtf16(const CSzArEx *p, size_t fileIndex, UInt16 *dest);
 
+/*
+SzArEx_CreateNameIndex creates hash table of file names (allocated with alloc)
+  for SzArEx_FindFile. It needs 12 bytes or less per file.
+  SzArEx_Free frees the table, so (alloc) must be same allocMain
+  that is passed to SzArEx_Free (and SzArEx_Open).
+SzArEx_FindFile returns the index of file with exactly same name
+  (null-terminated UTF-16 string, as it's stored in archive),
+  or (UInt32)(Int32)-1, if there is no such file.
+  It uses linear search, if there is no name index.
+*/
+
+SRes SzArEx_CreateNameIndex(CSzArEx *p, ISzAlloc *alloc);
+UInt32 SzArEx_FindFile(const CSzArEx *p, const UInt16 *name);
+
 SRes SzArEx_Extract(
     const CSzArEx *db,
     ILookInStream *inStream,
@@ -185,6 +242,88 @@ SRes SzArEx_Extract(
     ISzAlloc *allocTemp);
 
 
+/* ---------- Extracting of all files ---------- */
+
+/*
+ISzExtractCallback::Write
+  gets the data of file (fileIndex). It can be called several times for one file.
+ISzExtractCallback::Finish
+  is called after the last Write call for that file.
+  res: SZ_OK or SZ_ERROR_CRC, if the CRC of file doesn't match.
+If any callback returns error code, extraction is stopped with that code.
+Extraction is also stopped with SZ_ERROR_CRC after Finish call for file with CRC error.
+*/
+
+typedef struct
+{
+  SRes (*Write)(void *p, UInt32 fileIndex, const void *buf, size_t size);
+  SRes (*Finish)(void *p, UInt32 fileIndex, SRes res);
+} ISzExtractCallback;
+
+/*
+SzArEx_ExtractFolder extracts the files of one folder (solid block).
+  The data of files are sent to callback as they are decoded, so the
+  memory usage doesn't depend on folder size: it's the LZMA dictionary
+  (allocated with allocTemp) and some small buffers.
+  Folders that use BCJ2 filter are decoded to one buffer (allocMain) instead.
+  If the folder uses unsupported methods, it returns SZ_ERROR_UNSUPPORTED
+  before any allocation and callback call.
+  If the folder has CRC, it's checked after the last file was finished.
+  Files without data are not reported.
+  The model of PPMd is allocated with allocModel. It can be same as allocTemp,
+  or CPpmd7_MemPool of the calling thread, if you want to reuse the model memory
+  for next folders.
+*/
+
+SRes SzArEx_ExtractFolder(
+    const CSzArEx *db,
+    ILookInStream *inStream,
+    UInt32 folderIndex,
+    ISzExtractCallback *callback,
+    ISzAlloc *allocMain,
+    ISzAlloc *allocTemp,
+    ISzAlloc *allocModel);
+
+/*
+SzArEx_ExtractAll extracts all files of archive.
+  Folders (solid blocks) are decoded in parallel by (numStreams) threads.
+  Each thread reads the archive with its own stream inStreams[i],
+  so these streams must be independent views of same archive
+  (for example, the archive file opened several times).
+  The calling thread is one of the worker threads, and it uses inStreams[0].
+
+  Files of one folder are reported in order by one thread, but the callbacks
+  for different folders can be called at the same time from different threads.
+  Files without data (empty files and directories) get only Finish call
+  from the calling thread before the folders are decoded.
+  If extraction stops with error, some files can get no calls at all.
+
+  Each thread decodes one folder at a time with SzArEx_ExtractFolder.
+  allocMain and allocTemp must be thread-safe, if (numStreams > 1).
+  If 7zExtract.c is compiled with _7ZIP_PPMD_SUPPPORT, each thread keeps
+  the PPMd model memory in its own CPpmd7_MemPool for next folders,
+  so it's allocated from allocTemp only once per thread.
+
+Returns:
+  SZ_OK
+  SZ_ERROR_UNSUPPORTED
+  SZ_ERROR_DATA
+  SZ_ERROR_CRC
+  SZ_ERROR_MEM
+  SZ_ERROR_THREAD
+  SZ_ERROR_PARAM - numStreams == 0
+  any error code returned by ISzExtractCallback or by inStreams
+*/
+
+SRes SzArEx_ExtractAll(
+    const CSzArEx *db,
+    ILookInStream **inStreams,
+    UInt32 numStreams,
+    ISzExtractCallback *callback,
+    ISzAlloc *allocMain,
+    ISzAlloc *allocTemp);
+
+
 /*
 SzArEx_Open Errors:
 SZ_ERROR_NO_ARCHIVE
@@ -5,6 +5,7 @@
 #include "CpuArch.h"
 
 #define kCrcPoly 0xEDB88320
+#define kCrc32cPoly 0x82F63B78
 
 #ifdef MY_CPU_LE
 #define CRC_NUM_TABLES 8
@@ -12,10 +13,19 @@
 #define CRC_NUM_TABLES 1
 #endif
 
+#if defined(MY_CPU_X86_OR_AMD64) && ( \
+    (defined(__GNUC__) && (__GNUC__ >= 5) && !defined(__clang__)) || \
+    (defined(__clang__) && (__clang_major__ >= 4)) || \
+    (defined(_MSC_VER) && (_MSC_VER >= 1600)))
+#define USE_CRC_CLMUL
+#endif
+
 typedef UInt32 (MY_FAST_CALL *CRC_FUNC)(UInt32 v, const void *data, size_t size, const UInt32 *table);
 
 static CRC_FUNC g_CrcUpdate;
+static CRC_FUNC g_Crc32cUpdate;
 UInt32 g_CrcTable[256 * CRC_NUM_TABLES];
+UInt32 g_Crc32cTable[256 * CRC_NUM_TABLES];
 
 #if CRC_NUM_TABLES == 1
 
@@ -36,6 +46,103 @@ UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const U
 
 #endif
 
+#if CRC_NUM_TABLES == 1
+#define CrcUpdateTable CrcUpdateT1
+#else
+static CRC_FUNC g_CrcUpdateTable;
+#define CrcUpdateTable g_CrcUpdateTable
+#endif
+
+#ifdef USE_CRC_CLMUL
+
+/*
+PCLMULQDQ folding, same scheme as in XzCrc64.c. The polynomial has only
+33 bits, but the multipliers still are 64-bit reflected values:
+(x^(n+63) mod P) and (x^(n-1) mod P) with the reflected remainder in the
+high 32 bits. The last 16-byte block is reduced with the tables.
+*/
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ATTRIB_CLMUL __attribute__((__target__("sse2,pclmul")))
+#else
+#define ATTRIB_CLMUL
+#endif
+
+/* { lo, hi } multipliers for folding over 512 bits and over 128 bits */
+static UInt64 g_CrcFold[4];
+static UInt64 g_Crc32cFold[4];
+
+static UInt64 Crc_XPowModP(unsigned n, UInt32 poly)
+{
+  UInt32 r = (UInt32)1 << 31;
+  for (; n != 0; n--)
+    r = (r >> 1) ^ (poly & ~((r & 1) - 1));
+  return (UInt64)r << 32;
+}
+
+static void Crc_SetFold(UInt64 *fold, UInt32 poly)
+{
+  fold[0] = Crc_XPowModP(512 + 63, poly);
+  fold[1] = Crc_XPowModP(512 - 1, poly);
+  fold[2] = Crc_XPowModP(128 + 63, poly);
+  fold[3] = Crc_XPowModP(128 - 1, poly);
+}
+
+#define CLMUL_LOAD(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define CLMUL_FOLD(x, k) _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11))
+
+static UInt32 ATTRIB_CLMUL CrcUpdateFold(UInt32 v, const void *data, size_t size, const UInt32 *table, const UInt64 *fold)
+{
+  const Byte *p = (const Byte *)data;
+  __m128i x0, x1, x2, x3, k;
+  Byte temp[16];
+
+  if (size < 64 * 2)
+    return CrcUpdateTable(v, data, size, table);
+
+  x0 = _mm_xor_si128(CLMUL_LOAD(p), _mm_cvtsi32_si128((int)v));
+  x1 = CLMUL_LOAD(p + 16);
+  x2 = CLMUL_LOAD(p + 32);
+  x3 = CLMUL_LOAD(p + 48);
+  p += 64;
+  size -= 64;
+
+  k = CLMUL_LOAD(fold + 0);
+  for (; size >= 64; size -= 64, p += 64)
+  {
+    x0 = _mm_xor_si128(CLMUL_FOLD(x0, k), CLMUL_LOAD(p));
+    x1 = _mm_xor_si128(CLMUL_FOLD(x1, k), CLMUL_LOAD(p + 16));
+    x2 = _mm_xor_si128(CLMUL_FOLD(x2, k), CLMUL_LOAD(p + 32));
+    x3 = _mm_xor_si128(CLMUL_FOLD(x3, k), CLMUL_LOAD(p + 48));
+  }
+
+  k = CLMUL_LOAD(fold + 2);
+  x1 = _mm_xor_si128(CLMUL_FOLD(x0, k), x1);
+  x2 = _mm_xor_si128(CLMUL_FOLD(x1, k), x2);
+  x3 = _mm_xor_si128(CLMUL_FOLD(x2, k), x3);
+  for (; size >= 16; size -= 16, p += 16)
+    x3 = _mm_xor_si128(CLMUL_FOLD(x3, k), CLMUL_LOAD(p));
+
+  _mm_storeu_si128((__m128i *)(void *)temp, x3);
+  v = CrcUpdateTable(0, temp, 16, table);
+  return CrcUpdateTable(v, p, size, table);
+}
+
+static UInt32 MY_FAST_CALL CrcUpdateClmul(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  return CrcUpdateFold(v, data, size, table, g_CrcFold);
+}
+
+static UInt32 MY_FAST_CALL Crc32cUpdateClmul(UInt32 v, const void *data, size_t size, const UInt32 *table)
+{
+  return CrcUpdateFold(v, data, size, table, g_Crc32cFold);
+}
+
+#endif
+
 UInt32 MY_FAST_CALL CrcUpdate(UInt32 v, const void *data, size_t size)
 {
   return g_CrcUpdate(v, data, size, g_CrcTable);
@@ -46,7 +153,17 @@ UInt32 MY_FAST_CALL CrcCalc(const void *data, size_t size)
   return g_CrcUpdate(CRC_INIT_VAL, data, size, g_CrcTable) ^ CRC_INIT_VAL;
 }
 
-void MY_FAST_CALL CrcGenerateTable()
+UInt32 MY_FAST_CALL Crc32cUpdate(UInt32 v, const void *data, size_t size)
+{
+  return g_Crc32cUpdate(v, data, size, g_Crc32cTable);
+}
+
+UInt32 MY_FAST_CALL Crc32cCalc(const void *data, size_t size)
+{
+  return g_Crc32cUpdate(CRC_INIT_VAL, data, size, g_Crc32cTable) ^ CRC_INIT_VAL;
+}
+
+static void CrcGenerateTable2(UInt32 *table, UInt32 poly)
 {
   UInt32 i;
   for (i = 0; i < 256; i++)
@@ -54,21 +171,36 @@ void MY_FAST_CALL CrcGenerateTable()
     UInt32 r = i;
     unsigned j;
     for (j = 0; j < 8; j++)
-      r = (r >> 1) ^ (kCrcPoly & ~((r & 1) - 1));
-    g_CrcTable[i] = r;
+      r = (r >> 1) ^ (poly & ~((r & 1) - 1));
+    table[i] = r;
   }
-  #if CRC_NUM_TABLES == 1
-  g_CrcUpdate = CrcUpdateT1;
-  #else
   for (; i < 256 * CRC_NUM_TABLES; i++)
   {
-    UInt32 r = g_CrcTable[i - 256];
-    g_CrcTable[i] = g_CrcTable[r & 0xFF] ^ (r >> 8);
+    UInt32 r = table[i - 256];
+    table[i] = table[r & 0xFF] ^ (r >> 8);
   }
-  g_CrcUpdate = CrcUpdateT4;
+}
+
+void MY_FAST_CALL CrcGenerateTable()
+{
+  CrcGenerateTable2(g_CrcTable, kCrcPoly);
+  CrcGenerateTable2(g_Crc32cTable, kCrc32cPoly);
+  #if CRC_NUM_TABLES != 1
+  g_CrcUpdateTable = CrcUpdateT4;
   #ifdef MY_CPU_X86_OR_AMD64
   if (!CPU_Is_InOrder())
-    g_CrcUpdate = CrcUpdateT8;
+    g_CrcUpdateTable = CrcUpdateT8;
   #endif
   #endif
+  g_CrcUpdate = CrcUpdateTable;
+  g_Crc32cUpdate = CrcUpdateTable;
+  #ifdef USE_CRC_CLMUL
+  if (CPU_Is_Clmul_Supported())
+  {
+    Crc_SetFold(g_CrcFold, kCrcPoly);
+    Crc_SetFold(g_Crc32cFold, kCrc32cPoly);
+    g_CrcUpdate = CrcUpdateClmul;
+    g_Crc32cUpdate = Crc32cUpdateClmul;
+  }
+  #endif
 }
@@ -9,6 +9,7 @@
 EXTERN_C_BEGIN
 
 extern UInt32 g_CrcTable[];
+extern UInt32 g_Crc32cTable[];
 
 /* Call CrcGenerateTable one time before other CRC functions */
 void MY_FAST_CALL CrcGenerateTable(void);
@@ -20,6 +21,13 @@ void MY_FAST_CALL CrcGenerateTable(void);
 UInt32 MY_FAST_CALL CrcUpdate(UInt32 crc, const void *data, size_t size);
 UInt32 MY_FAST_CALL CrcCalc(const void *data, size_t size);
 
+/* CRC-32C (Castagnoli). It uses same CRC_INIT_VAL and CRC_GET_DIGEST. */
+
+#define CRC32C_UPDATE_BYTE(crc, b) (g_Crc32cTable[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
+
+UInt32 MY_FAST_CALL Crc32cUpdate(UInt32 crc, const void *data, size_t size);
+UInt32 MY_FAST_CALL Crc32cCalc(const void *data, size_t size);
+
 EXTERN_C_END
 
 #endif
@@ -28,7 +28,27 @@ UInt32 MY_FAST_CALL CrcUpdateT4(UInt32 v, const void *data, size_t size, const U
 
 UInt32 MY_FAST_CALL CrcUpdateT8(UInt32 v, const void *data, size_t size, const UInt32 *table)
 {
-  return CrcUpdateT4(v, data, size, table);
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 7) != 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  for (; size >= 8; size -= 8, p += 8)
+  {
+    UInt32 d;
+    v ^= ((const UInt32 *)p)[0];
+    d = ((const UInt32 *)p)[1];
+    v =
+      table[0x700 + (v & 0xFF)] ^
+      table[0x600 + ((v >> 8) & 0xFF)] ^
+      table[0x500 + ((v >> 16) & 0xFF)] ^
+      table[0x400 + ((v >> 24))] ^
+      table[0x300 + (d & 0xFF)] ^
+      table[0x200 + ((d >> 8) & 0xFF)] ^
+      table[0x100 + ((d >> 16) & 0xFF)] ^
+      table[0x000 + ((d >> 24))];
+  }
+  for (; size > 0; size--, p++)
+    v = CRC_UPDATE_BYTE_2(v, *p);
+  return v;
 }
 
 #endif
@@ -63,6 +63,36 @@ static Byte ReadByte(void *pp)
   return 0;
 }
 
+static void ByteInToLook_Init(CByteInToLook *s, ILookInStream *inStream)
+{
+  s->p.Read = ReadByte;
+  s->inStream = inStream;
+  s->begin = s->end = s->cur = NULL;
+  s->extra = False;
+  s->res = SZ_OK;
+  s->processed = 0;
+}
+
+static SRes SzPpmd_Create(CPpmd7 *ppmd, const CSzCoderInfo *coder, ISzAlloc *allocMain)
+{
+  unsigned order;
+  UInt32 memSize;
+  if (coder->Props.size != 5)
+    return SZ_ERROR_UNSUPPORTED;
+  order = coder->Props.data[0];
+  memSize = GetUi32(coder->Props.data + 1);
+  if (order < PPMD7_MIN_ORDER ||
+      order > PPMD7_MAX_ORDER ||
+      memSize < PPMD7_MIN_MEM_SIZE ||
+      memSize > PPMD7_MAX_MEM_SIZE)
+    return SZ_ERROR_UNSUPPORTED;
+  Ppmd7_Construct(ppmd);
+  if (!Ppmd7_Alloc(ppmd, memSize, allocMain))
+    return SZ_ERROR_MEM;
+  Ppmd7_Init(ppmd, order);
+  return SZ_OK;
+}
+
 static SRes SzDecodePpmd(CSzCoderInfo *coder, UInt64 inSize, ILookInStream *inStream,
     Byte *outBuffer, SizeT outSize, ISzAlloc *allocMain)
 {
@@ -70,29 +100,8 @@ static SRes SzDecodePpmd(CSzCoderInfo *coder, UInt64 inSize, ILookInStream *inSt
   CByteInToLook s;
   SRes res = SZ_OK;
 
-  s.p.Read = ReadByte;
-  s.inStream = inStream;
-  s.begin = s.end = s.cur = NULL;
-  s.extra = False;
-  s.res = SZ_OK;
-  s.processed = 0;
-
-  if (coder->Props.size != 5)
-    return SZ_ERROR_UNSUPPORTED;
-
-  {
-    unsigned order = coder->Props.data[0];
-    UInt32 memSize = GetUi32(coder->Props.data + 1);
-    if (order < PPMD7_MIN_ORDER ||
-        order > PPMD7_MAX_ORDER ||
-        memSize < PPMD7_MIN_MEM_SIZE ||
-        memSize > PPMD7_MAX_MEM_SIZE)
-      return SZ_ERROR_UNSUPPORTED;
-    Ppmd7_Construct(&ppmd);
-    if (!Ppmd7_Alloc(&ppmd, memSize, allocMain))
-      return SZ_ERROR_MEM;
-    Ppmd7_Init(&ppmd, order);
-  }
+  ByteInToLook_Init(&s, inStream);
+  RINOK(SzPpmd_Create(&ppmd, coder, allocMain));
   {
     CPpmd7z_RangeDec rc;
     Ppmd7z_RangeDec_CreateVTable(&rc);
@@ -321,6 +330,11 @@ static SRes CheckSupportedFolder(const CSzFolder *f)
   return SZ_ERROR_UNSUPPORTED;
 }
 
+SRes SzFolder_CheckSupported(const CSzFolder *folder)
+{
+  return CheckSupportedFolder(folder);
+}
+
 static UInt64 GetSum(const UInt64 *values, UInt32 index)
 {
   UInt64 sum = 0;
@@ -468,3 +482,288 @@ SRes SzFolder_Decode(const CSzFolder *folder, const UInt64 *packSizes,
     IAlloc_Free(allocMain, tempBuf[i]);
   return res;
 }
+
+
+/* ---------- Decoding to stream ---------- */
+
+#define SZ_STREAM_BUF_SIZE (1 << 16)
+
+/* CSzOutFilter applies the BCJ or ARM filter of two-coder folder to the decoded data.
+   The last bytes that can be the beginning of a branch instruction
+   are kept in buf until the next data arrives. */
+
+typedef struct
+{
+  ISeqOutStream *outStream;
+  UInt32 methodId; /* k_BCJ, k_ARM or k_Copy, if there is no filter */
+  UInt32 ip;
+  UInt32 x86State;
+  Byte *buf;
+  size_t bufSize;
+} CSzOutFilter;
+
+static SRes SzOutFilter_WriteRaw(CSzOutFilter *p, const Byte *data, size_t size)
+{
+  if (size != 0 && p->outStream->Write(p->outStream, data, size) != size)
+    return SZ_ERROR_WRITE;
+  return SZ_OK;
+}
+
+static SRes SzOutFilter_Write(CSzOutFilter *p, const Byte *data, size_t size)
+{
+  if (p->methodId == k_Copy)
+    return SzOutFilter_WriteRaw(p, data, size);
+  while (size != 0)
+  {
+    size_t curSize = SZ_STREAM_BUF_SIZE - p->bufSize;
+    SizeT processed;
+    if (curSize > size)
+      curSize = size;
+    memcpy(p->buf + p->bufSize, data, curSize);
+    p->bufSize += curSize;
+    data += curSize;
+    size -= curSize;
+    if (p->methodId == k_BCJ)
+      processed = x86_Convert(p->buf, p->bufSize, p->ip, &p->x86State, 0);
+    else
+      processed = ARM_Convert(p->buf, p->bufSize, p->ip, 0);
+    p->ip += (UInt32)processed;
+    RINOK(SzOutFilter_WriteRaw(p, p->buf, processed));
+    p->bufSize -= processed;
+    memmove(p->buf, p->buf + processed, p->bufSize);
+  }
+  return SZ_OK;
+}
+
+#ifdef _7ZIP_PPMD_SUPPPORT
+
+static SRes SzDecodePpmdToStream(CSzCoderInfo *coder, UInt64 inSize, ILookInStream *inStream,
+    UInt64 outSize, CSzOutFilter *out, ISzAlloc *allocMain, ISzAlloc *allocModel)
+{
+  CPpmd7 ppmd;
+  CByteInToLook s;
+  Byte *outBuf;
+  SRes res = SZ_OK;
+
+  ByteInToLook_Init(&s, inStream);
+  RINOK(SzPpmd_Create(&ppmd, coder, allocModel));
+  outBuf = (Byte *)IAlloc_Alloc(allocMain, SZ_STREAM_BUF_SIZE);
+  if (outBuf == 0)
+  {
+    Ppmd7_Free(&ppmd, allocModel);
+    return SZ_ERROR_MEM;
+  }
+  {
+    CPpmd7z_RangeDec rc;
+    Ppmd7z_RangeDec_CreateVTable(&rc);
+    rc.Stream = &s.p;
+    if (!Ppmd7z_RangeDec_Init(&rc))
+      res = SZ_ERROR_DATA;
+    else if (s.extra)
+      res = (s.res != SZ_OK ? s.res : SZ_ERROR_DATA);
+    else
+    {
+      while (outSize != 0)
+      {
+        size_t i, curSize = SZ_STREAM_BUF_SIZE;
+        if (curSize > outSize)
+          curSize = (size_t)outSize;
+        for (i = 0; i < curSize; i++)
+        {
+          int sym = Ppmd7_DecodeSymbol(&ppmd, &rc.p);
+          if (s.extra || sym < 0)
+            break;
+          outBuf[i] = (Byte)sym;
+        }
+        if (i != curSize)
+        {
+          res = (s.res != SZ_OK ? s.res : SZ_ERROR_DATA);
+          break;
+        }
+        res = SzOutFilter_Write(out, outBuf, curSize);
+        if (res != SZ_OK)
+          break;
+        outSize -= curSize;
+      }
+      if (res == SZ_OK)
+        if (s.processed + (s.cur - s.begin) != inSize || !Ppmd7z_RangeDec_IsFinishedOK(&rc))
+          res = SZ_ERROR_DATA;
+    }
+  }
+  IAlloc_Free(allocMain, outBuf);
+  Ppmd7_Free(&ppmd, allocModel);
+  return res;
+}
+
+#endif
+
+/* It decodes LZMA and LZMA2 through cyclic dictionary buffer,
+   and it sends the data to (out) each time the decoder stops. */
+
+static SRes SzDecodeLzmaToStream(CSzCoderInfo *coder, UInt64 inSize, ILookInStream *inStream,
+    UInt64 outSize, CSzOutFilter *out, ISzAlloc *allocMain)
+{
+  CLzma2Dec state; /* LZMA uses only state.decoder */
+  CLzmaDec *dec = &state.decoder;
+  Bool isLzma2 = (coder->MethodID == k_LZMA2);
+  SizeT dicBufSize;
+  SRes res = SZ_OK;
+
+  Lzma2Dec_Construct(&state);
+  if (isLzma2)
+  {
+    if (coder->Props.size != 1)
+      return SZ_ERROR_DATA;
+    RINOK(Lzma2Dec_AllocateProbs(&state, coder->Props.data[0], allocMain));
+  }
+  else
+  {
+    RINOK(LzmaDec_AllocateProbs(dec, coder->Props.data, (unsigned)coder->Props.size, allocMain));
+  }
+
+  /* the dictionary is never larger than the data */
+  dicBufSize = dec->prop.dicSize;
+  if (dicBufSize > outSize)
+    dicBufSize = (SizeT)outSize;
+  if (dicBufSize < ((UInt32)1 << 12))
+    dicBufSize = ((UInt32)1 << 12);
+  dec->dic = (Byte *)IAlloc_Alloc(allocMain, dicBufSize);
+  if (dec->dic == 0)
+  {
+    LzmaDec_FreeProbs(dec, allocMain);
+    return SZ_ERROR_MEM;
+  }
+  dec->dicBufSize = dicBufSize;
+  if (isLzma2)
+    Lzma2Dec_Init(&state);
+  else
+    LzmaDec_Init(dec);
+
+  for (;;)
+  {
+    Byte *inBuf = NULL;
+    size_t lookahead = (1 << 18);
+    if (lookahead > inSize)
+      lookahead = (size_t)inSize;
+    res = inStream->Look((void *)inStream, (const void **)&inBuf, &lookahead);
+    if (res != SZ_OK)
+      break;
+
+    if (dec->dicPos == dicBufSize)
+      dec->dicPos = 0;
+    {
+      SizeT inProcessed = (SizeT)lookahead, dicPos = dec->dicPos, dicLimit = dicBufSize;
+      ELzmaFinishMode finishMode = LZMA_FINISH_ANY;
+      ELzmaStatus status;
+      if (dicLimit - dicPos >= outSize)
+      {
+        dicLimit = dicPos + (SizeT)outSize;
+        finishMode = LZMA_FINISH_END;
+      }
+      if (isLzma2)
+        res = Lzma2Dec_DecodeToDic(&state, dicLimit, inBuf, &inProcessed, finishMode, &status);
+      else
+        res = LzmaDec_DecodeToDic(dec, dicLimit, inBuf, &inProcessed, finishMode, &status);
+      lookahead -= inProcessed;
+      inSize -= inProcessed;
+      if (res != SZ_OK)
+        break;
+      outSize -= dec->dicPos - dicPos;
+      res = SzOutFilter_Write(out, dec->dic + dicPos, dec->dicPos - dicPos);
+      if (res != SZ_OK)
+        break;
+      /* the end marker can be split between two Look() buffers */
+      if ((outSize == 0 && status != LZMA_STATUS_NEEDS_MORE_INPUT) ||
+          (inProcessed == 0 && dicPos == dec->dicPos))
+      {
+        if (outSize != 0 || lookahead != 0 ||
+            (status != LZMA_STATUS_FINISHED_WITH_MARK &&
+             (isLzma2 || status != LZMA_STATUS_MAYBE_FINISHED_WITHOUT_MARK)))
+          res = SZ_ERROR_DATA;
+        break;
+      }
+      res = inStream->Skip((void *)inStream, inProcessed);
+      if (res != SZ_OK)
+        break;
+    }
+  }
+
+  IAlloc_Free(allocMain, dec->dic);
+  LzmaDec_FreeProbs(dec, allocMain);
+  return res;
+}
+
+static SRes SzDecodeCopyToStream(UInt64 inSize, ILookInStream *inStream, CSzOutFilter *out)
+{
+  while (inSize > 0)
+  {
+    void *inBuf;
+    size_t curSize = (1 << 18);
+    if (curSize > inSize)
+      curSize = (size_t)inSize;
+    RINOK(inStream->Look((void *)inStream, (const void **)&inBuf, &curSize));
+    if (curSize == 0)
+      return SZ_ERROR_INPUT_EOF;
+    RINOK(SzOutFilter_Write(out, (const Byte *)inBuf, curSize));
+    inSize -= curSize;
+    RINOK(inStream->Skip((void *)inStream, curSize));
+  }
+  return SZ_OK;
+}
+
+SRes SzFolder_DecodeToStream(const CSzFolder *folder, const UInt64 *packSizes,
+    ILookInStream *inStream, UInt64 startPos,
+    ISeqOutStream *outStream, ISzAlloc *allocMain, ISzAlloc *allocModel)
+{
+  CSzCoderInfo *coder = &folder->Coders[0];
+  UInt64 unpackSize;
+  CSzOutFilter out;
+  SRes res;
+
+  RINOK(CheckSupportedFolder(folder));
+  /* BCJ2 needs the whole output of all three main coders at once */
+  if (folder->NumCoders == 4)
+    return SZ_ERROR_UNSUPPORTED;
+  unpackSize = folder->UnpackSizes[0];
+
+  out.outStream = outStream;
+  out.methodId = k_Copy;
+  out.ip = 0;
+  out.buf = NULL;
+  out.bufSize = 0;
+  if (folder->NumCoders == 2)
+  {
+    out.methodId = (UInt32)folder->Coders[1].MethodID;
+    x86_Convert_Init(out.x86State);
+    out.buf = (Byte *)IAlloc_Alloc(allocMain, SZ_STREAM_BUF_SIZE);
+    if (out.buf == 0)
+      return SZ_ERROR_MEM;
+  }
+
+  res = LookInStream_SeekTo(inStream, startPos);
+  if (res == SZ_OK)
+  {
+    if (coder->MethodID == k_Copy)
+    {
+      if (packSizes[0] != unpackSize)
+        res = SZ_ERROR_DATA;
+      else
+        res = SzDecodeCopyToStream(packSizes[0], inStream, &out);
+    }
+    else if (coder->MethodID == k_LZMA || coder->MethodID == k_LZMA2)
+      res = SzDecodeLzmaToStream(coder, packSizes[0], inStream, unpackSize, &out, allocMain);
+    else
+    {
+      #ifdef _7ZIP_PPMD_SUPPPORT
+      res = SzDecodePpmdToStream(coder, packSizes[0], inStream, unpackSize, &out, allocMain, allocModel);
+      #else
+      res = SZ_ERROR_UNSUPPORTED;
+      #endif
+    }
+  }
+  /* the filter leaves last bytes unconverted, as it does for the whole buffer */
+  if (res == SZ_OK)
+    res = SzOutFilter_WriteRaw(&out, out.buf, out.bufSize);
+  IAlloc_Free(allocMain, out.buf);
+  return res;
+}
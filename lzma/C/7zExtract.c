@@ -0,0 +1,338 @@
+/* 7zExtract.c -- Extracting all files of 7z archive
+2010-11-18 : Igor Pavlov : Public domain */
+
+#include "7z.h"
+#include "7zCrc.h"
+
+#ifdef _7ZIP_PPMD_SUPPPORT
+#include "Ppmd7.h"
+#endif
+
+#ifndef _7ZIP_ST
+#include "Threads.h"
+#endif
+
+typedef struct
+{
+  const CSzArEx *db;
+  ISzExtractCallback *callback;
+  ISzAlloc *allocMain;
+  ISzAlloc *allocTemp;
+  UInt32 nextFolder;
+  SRes res;
+  #ifndef _7ZIP_ST
+  CCriticalSection cs;
+  #endif
+} CSzExtractAll;
+
+typedef struct
+{
+  CSzExtractAll *mt;
+  ILookInStream *inStream;
+  #ifndef _7ZIP_ST
+  CThread thread;
+  #endif
+} CSzExtractThread;
+
+#ifndef _7ZIP_ST
+#define SzExtractAll_Lock(p) CriticalSection_Enter(&(p)->cs)
+#define SzExtractAll_Unlock(p) CriticalSection_Leave(&(p)->cs)
+#else
+#define SzExtractAll_Lock(p)
+#define SzExtractAll_Unlock(p)
+#endif
+
+static void SzExtractAll_SetError(CSzExtractAll *p, SRes res)
+{
+  SzExtractAll_Lock(p);
+  if (p->res == SZ_OK)
+    p->res = res;
+  SzExtractAll_Unlock(p);
+}
+
+/* CSzFileSplitter cuts the data of folder into files */
+
+typedef struct
+{
+  ISeqOutStream s;
+  const CSzArEx *db;
+  ISzExtractCallback *callback;
+  UInt32 folderIndex;
+  UInt32 fileIndex;      /* the file that gets the data now */
+  UInt32 numStreamsLeft; /* files of folder that are not finished yet, including fileIndex */
+  UInt64 rem;            /* bytes of file (fileIndex) that are not received yet */
+  UInt32 crc;
+  UInt32 folderCrc;
+  SRes res;
+} CSzFileSplitter;
+
+static void SzFileSplitter_StartFile(CSzFileSplitter *p)
+{
+  const CSzArEx *db = p->db;
+  while (p->fileIndex < db->db.NumFiles &&
+      db->FileIndexToFolderIndexMap[p->fileIndex] != p->folderIndex)
+    p->fileIndex++;
+  if (p->fileIndex == db->db.NumFiles)
+  {
+    p->numStreamsLeft = 0;
+    return;
+  }
+  p->rem = SzArEx_GetFileSize(db, p->fileIndex);
+  p->crc = CRC_INIT_VAL;
+}
+
+/* it finishes the current file and the next zero-size files, while no more data is needed for them */
+
+static SRes SzFileSplitter_Flush(CSzFileSplitter *p)
+{
+  while (p->numStreamsLeft != 0 && p->rem == 0)
+  {
+    const CSzBitUi32s *crcs = &p->db->db.CRCs;
+    SRes fileRes = SZ_OK;
+    if (SzBitWithVals_Check(crcs, p->fileIndex) && CRC_GET_DIGEST(p->crc) != crcs->Vals[p->fileIndex])
+      fileRes = SZ_ERROR_CRC;
+    RINOK(p->callback->Finish(p->callback, p->fileIndex, fileRes));
+    RINOK(fileRes);
+    if (--p->numStreamsLeft != 0)
+    {
+      p->fileIndex++;
+      SzFileSplitter_StartFile(p);
+    }
+  }
+  return SZ_OK;
+}
+
+static size_t SzFileSplitter_Write(void *pp, const void *data, size_t size)
+{
+  CSzFileSplitter *p = (CSzFileSplitter *)pp;
+  const Byte *buf = (const Byte *)data;
+  size_t pos = 0;
+  if (p->res != SZ_OK)
+    return 0;
+  p->folderCrc = CrcUpdate(p->folderCrc, data, size);
+  while (pos != size)
+  {
+    size_t curSize = size - pos;
+    if (p->numStreamsLeft == 0)
+    {
+      /* the folder is larger than its files */
+      p->res = SZ_ERROR_FAIL;
+      return pos;
+    }
+    if (curSize > p->rem)
+      curSize = (size_t)p->rem;
+    p->res = p->callback->Write(p->callback, p->fileIndex, buf + pos, curSize);
+    if (p->res != SZ_OK)
+      return pos;
+    p->crc = CrcUpdate(p->crc, buf + pos, curSize);
+    p->rem -= curSize;
+    pos += curSize;
+    p->res = SzFileSplitter_Flush(p);
+    if (p->res != SZ_OK)
+      return pos;
+  }
+  return size;
+}
+
+static SRes SzArEx_DecodeFolderToBuf(const CSzArEx *db, ILookInStream *inStream, UInt32 folderIndex,
+    ISeqOutStream *outStream, ISzAlloc *allocMain, ISzAlloc *allocTemp)
+{
+  CSzFolder *folder = db->db.Folders + folderIndex;
+  UInt64 unpackSizeSpec = SzFolder_GetUnpackSize(folder);
+  size_t unpackSize = (size_t)unpackSizeSpec;
+  UInt64 startOffset = SzArEx_GetFolderStreamPos(db, folderIndex, 0);
+  Byte *outBuffer = NULL;
+  SRes res;
+
+  if (unpackSize != unpackSizeSpec)
+    return SZ_ERROR_MEM;
+  if (unpackSize != 0)
+  {
+    outBuffer = (Byte *)IAlloc_Alloc(allocMain, unpackSize);
+    if (outBuffer == 0)
+      return SZ_ERROR_MEM;
+  }
+  res = LookInStream_SeekTo(inStream, startOffset);
+  if (res == SZ_OK)
+    res = SzFolder_Decode(folder,
+        db->db.PackSizes + db->FolderStartPackStreamIndex[folderIndex],
+        inStream, startOffset,
+        outBuffer, unpackSize, allocTemp);
+  if (res == SZ_OK && unpackSize != 0 && outStream->Write(outStream, outBuffer, unpackSize) != unpackSize)
+    res = SZ_ERROR_WRITE;
+  IAlloc_Free(allocMain, outBuffer);
+  return res;
+}
+
+SRes SzArEx_ExtractFolder(
+    const CSzArEx *db,
+    ILookInStream *inStream,
+    UInt32 folderIndex,
+    ISzExtractCallback *callback,
+    ISzAlloc *allocMain,
+    ISzAlloc *allocTemp,
+    ISzAlloc *allocModel)
+{
+  const CSzFolder *folder = db->db.Folders + folderIndex;
+  UInt64 startOffset = SzArEx_GetFolderStreamPos(db, folderIndex, 0);
+  CSzFileSplitter sp;
+  SRes res;
+
+  /* we check the methods before any allocation or callback call */
+  RINOK(SzFolder_CheckSupported(folder));
+
+  sp.s.Write = SzFileSplitter_Write;
+  sp.db = db;
+  sp.callback = callback;
+  sp.folderIndex = folderIndex;
+  sp.fileIndex = db->FolderStartFileIndex[folderIndex];
+  sp.numStreamsLeft = folder->NumUnpackStreams;
+  sp.rem = 0;
+  sp.folderCrc = CRC_INIT_VAL;
+  sp.res = SZ_OK;
+  if (sp.numStreamsLeft != 0)
+    SzFileSplitter_StartFile(&sp);
+  RINOK(SzFileSplitter_Flush(&sp));
+
+  /* BCJ2 needs the whole output of all three main coders at once */
+  if (folder->NumCoders == 4)
+    res = SzArEx_DecodeFolderToBuf(db, inStream, folderIndex, &sp.s, allocMain, allocTemp);
+  else
+    res = SzFolder_DecodeToStream(folder,
+        db->db.PackSizes + db->FolderStartPackStreamIndex[folderIndex],
+        inStream, startOffset, &sp.s, allocTemp, allocModel);
+
+  if (sp.res != SZ_OK)
+    return sp.res;
+  RINOK(res);
+  if (sp.numStreamsLeft != 0)
+    return SZ_ERROR_FAIL;
+  if (folder->UnpackCRCDefined && CRC_GET_DIGEST(sp.folderCrc) != folder->UnpackCRC)
+    return SZ_ERROR_CRC;
+  return SZ_OK;
+}
+
+static void SzExtractAll_Run(CSzExtractThread *t)
+{
+  CSzExtractAll *p = t->mt;
+  ISzAlloc *allocModel = p->allocTemp;
+  #ifdef _7ZIP_PPMD_SUPPPORT
+  /* the pool is used only by this thread and only for the PPMd model */
+  CPpmd7_MemPool pool;
+  Ppmd7_MemPool_Construct(&pool, p->allocTemp);
+  allocModel = &pool.p;
+  #endif
+  for (;;)
+  {
+    UInt32 folderIndex;
+    SRes res;
+    SzExtractAll_Lock(p);
+    folderIndex = p->nextFolder;
+    if (p->res != SZ_OK || folderIndex >= p->db->db.NumFolders)
+    {
+      SzExtractAll_Unlock(p);
+      break;
+    }
+    p->nextFolder++;
+    SzExtractAll_Unlock(p);
+
+    res = SzArEx_ExtractFolder(p->db, t->inStream, folderIndex, p->callback, p->allocMain, p->allocTemp, allocModel);
+    if (res != SZ_OK)
+    {
+      SzExtractAll_SetError(p, res);
+      break;
+    }
+  }
+  #ifdef _7ZIP_PPMD_SUPPPORT
+  Ppmd7_MemPool_Free(&pool);
+  #endif
+}
+
+#ifndef _7ZIP_ST
+static THREAD_FUNC_RET_TYPE THREAD_FUNC_CALL_TYPE SzExtractAll_ThreadFunc(void *pp)
+{
+  SzExtractAll_Run((CSzExtractThread *)pp);
+  return 0;
+}
+#endif
+
+SRes SzArEx_ExtractAll(
+    const CSzArEx *db,
+    ILookInStream **inStreams,
+    UInt32 numStreams,
+    ISzExtractCallback *callback,
+    ISzAlloc *allocMain,
+    ISzAlloc *allocTemp)
+{
+  CSzExtractAll p;
+  CSzExtractThread *threads;
+  UInt32 numThreads = numStreams;
+  UInt32 i;
+
+  if (numStreams == 0)
+    return SZ_ERROR_PARAM;
+
+  for (i = 0; i < db->db.NumFiles; i++)
+    if (db->FileIndexToFolderIndexMap[i] == (UInt32)-1)
+    {
+      RINOK(callback->Finish(callback, i, SZ_OK));
+    }
+
+  #ifdef _7ZIP_ST
+  numThreads = 1;
+  #endif
+  if (numThreads > db->db.NumFolders)
+    numThreads = db->db.NumFolders;
+  if (numThreads == 0)
+    return SZ_OK;
+
+  p.db = db;
+  p.callback = callback;
+  p.allocMain = allocMain;
+  p.allocTemp = allocTemp;
+  p.nextFolder = 0;
+  p.res = SZ_OK;
+
+  threads = (CSzExtractThread *)IAlloc_Alloc(allocMain, numThreads * sizeof(CSzExtractThread));
+  if (threads == 0)
+    return SZ_ERROR_MEM;
+  for (i = 0; i < numThreads; i++)
+  {
+    threads[i].mt = &p;
+    threads[i].inStream = inStreams[i];
+  }
+
+  #ifndef _7ZIP_ST
+  if (CriticalSection_Init(&p.cs) != 0)
+  {
+    IAlloc_Free(allocMain, threads);
+    return SZ_ERROR_THREAD;
+  }
+  for (i = 1; i < numThreads; i++)
+  {
+    Thread_Construct(&threads[i].thread);
+    if (Thread_Create(&threads[i].thread, SzExtractAll_ThreadFunc, &threads[i]) != 0)
+    {
+      SzExtractAll_SetError(&p, SZ_ERROR_THREAD);
+      break;
+    }
+  }
+  #endif
+
+  SzExtractAll_Run(&threads[0]);
+
+  #ifndef _7ZIP_ST
+  {
+    UInt32 numCreated = i;
+    for (i = 1; i < numCreated; i++)
+    {
+      Thread_Wait(&threads[i].thread);
+      Thread_Close(&threads[i].thread);
+    }
+  }
+  CriticalSection_Delete(&p.cs);
+  #endif
+
+  IAlloc_Free(allocMain, threads);
+  return p.res;
+}
@@ -1,6 +1,8 @@
 /* 7zFile.c -- File IO
 2009-11-24 : Igor Pavlov : Public domain */
 
+#include <string.h>
+
 #include "7zFile.h"
 
 #ifndef USE_WINDOWS_FILE
@@ -9,6 +11,10 @@
 #include <errno.h>
 #endif
 
+#ifdef USE_FILE_MAP
+#include <sys/mman.h>
+#endif
+
 #else
 
 /*
@@ -282,3 +288,115 @@ void FileOutStream_CreateVTable(CFileOutStream *p)
 {
   p->s.Write = FileOutStream_Write;
 }
+
+
+/* ---------- FileMap ---------- */
+
+void FileMap_Construct(CSzFileMap *p)
+{
+  p->data = NULL;
+  p->size = 0;
+}
+
+WRes FileMap_Open(CSzFileMap *p, CSzFile *file)
+{
+  #ifdef USE_FILE_MAP
+
+  UInt64 length;
+  WRes res = File_GetLength(file, &length);
+  if (res != 0)
+    return res;
+  if (length != (size_t)length)
+    return EFBIG;
+  p->size = (size_t)length;
+  if (length == 0)
+    return 0;
+  {
+    void *data = mmap(NULL, p->size, PROT_READ, MAP_SHARED, fileno(file->file), 0);
+    if (data == MAP_FAILED)
+      return errno;
+    p->data = (const Byte *)data;
+  }
+  return 0;
+
+  #else
+
+  (void)p;
+  (void)file;
+  return 1;
+
+  #endif
+}
+
+WRes FileMap_Close(CSzFileMap *p)
+{
+  #ifdef USE_FILE_MAP
+  if (p->data != NULL)
+  {
+    if (munmap((void *)p->data, p->size) != 0)
+      return errno;
+    p->data = NULL;
+  }
+  #endif
+  p->size = 0;
+  return 0;
+}
+
+
+/* ---------- FileMapInStream ---------- */
+
+static SRes FileMapInStream_Look(void *pp, const void **buf, size_t *size)
+{
+  CFileMapInStream *p = (CFileMapInStream *)pp;
+  /* (pos) can be beyond the end after Skip() or Seek(): we clamp it before
+     pointer arithmetic. (data) is NULL for empty file, so (pos) is 0 there. */
+  size_t pos = p->map->size;
+  if (p->pos < pos)
+    pos = (size_t)p->pos;
+  if (*size > p->map->size - pos)
+    *size = p->map->size - pos;
+  *buf = (pos == 0) ? p->map->data : p->map->data + pos;
+  return SZ_OK;
+}
+
+static SRes FileMapInStream_Skip(void *pp, size_t offset)
+{
+  CFileMapInStream *p = (CFileMapInStream *)pp;
+  p->pos += offset;
+  return SZ_OK;
+}
+
+static SRes FileMapInStream_Read(void *pp, void *buf, size_t *size)
+{
+  const void *data;
+  RINOK(FileMapInStream_Look(pp, &data, size));
+  if (*size != 0)
+    memcpy(buf, data, *size);
+  return FileMapInStream_Skip(pp, *size);
+}
+
+static SRes FileMapInStream_Seek(void *pp, Int64 *pos, ESzSeek origin)
+{
+  CFileMapInStream *p = (CFileMapInStream *)pp;
+  Int64 newPos = *pos;
+  switch (origin)
+  {
+    case SZ_SEEK_SET: break;
+    case SZ_SEEK_CUR: newPos += (Int64)p->pos; break;
+    case SZ_SEEK_END: newPos += (Int64)p->map->size; break;
+    default: return SZ_ERROR_PARAM;
+  }
+  if (newPos < 0)
+    return SZ_ERROR_PARAM;
+  p->pos = (UInt64)newPos;
+  *pos = newPos;
+  return SZ_OK;
+}
+
+void FileMapInStream_CreateVTable(CFileMapInStream *p)
+{
+  p->s.Look = FileMapInStream_Look;
+  p->s.Skip = FileMapInStream_Skip;
+  p->s.Read = FileMapInStream_Read;
+  p->s.Seek = FileMapInStream_Seek;
+}
@@ -14,6 +14,11 @@
 #include <stdio.h>
 #endif
 
+/* file mapping is supported only in POSIX build */
+#if !defined(USE_WINDOWS_FILE) && (defined(__unix__) || defined(__APPLE__))
+#define USE_FILE_MAP
+#endif
+
 #include "Types.h"
 
 EXTERN_C_BEGIN
@@ -78,6 +83,42 @@ typedef struct
 
 void FileOutStream_CreateVTable(CFileOutStream *p);
 
+
+/* ---------- FileMap ---------- */
+
+/* FileMap_Open maps whole file for reading.
+   It returns error, if the system doesn't support file mapping (Windows build),
+   or if the file is larger than address space. Use CLookToRead in that case.
+   The file must not be truncated while it's mapped. */
+
+typedef struct
+{
+  const Byte *data;
+  size_t size;
+} CSzFileMap;
+
+void FileMap_Construct(CSzFileMap *p);
+WRes FileMap_Open(CSzFileMap *p, CSzFile *file);
+WRes FileMap_Close(CSzFileMap *p);
+
+
+/* ---------- FileMapInStream ---------- */
+
+/* ILookInStream over mapped file. Look() returns pointer to mapped data
+   and Read() is memcpy, so there are no system calls and no buffer copies.
+   Each stream has its own position, so several streams (threads)
+   can share one CSzFileMap. */
+
+typedef struct
+{
+  ILookInStream s;
+  const CSzFileMap *map;
+  UInt64 pos;
+} CFileMapInStream;
+
+void FileMapInStream_CreateVTable(CFileMapInStream *p);
+#define FileMapInStream_Init(p) { (p)->pos = 0; }
+
 EXTERN_C_END
 
 #endif
@@ -92,13 +92,17 @@ UInt64 SzFolder_GetUnpackSize(CSzFolder *p)
   return 0;
 }
 
-void SzFile_Init(CSzFileItem *p)
+static void SzBitUi32s_Init(CSzBitUi32s *p)
 {
-  p->HasStream = 1;
-  p->IsDir = 0;
-  p->IsAnti = 0;
-  p->CrcDefined = 0;
-  p->MTimeDefined = 0;
+  p->Defs = 0;
+  p->Vals = 0;
+}
+
+static void SzBitUi32s_Free(CSzBitUi32s *p, ISzAlloc *alloc)
+{
+  IAlloc_Free(alloc, p->Defs);
+  IAlloc_Free(alloc, p->Vals);
+  SzBitUi32s_Init(p);
 }
 
 void SzAr_Init(CSzAr *p)
@@ -107,10 +111,15 @@ void SzAr_Init(CSzAr *p)
   p->PackCRCsDefined = 0;
   p->PackCRCs = 0;
   p->Folders = 0;
-  p->Files = 0;
   p->NumPackStreams = 0;
   p->NumFolders = 0;
   p->NumFiles = 0;
+  p->UnpackPositions = 0;
+  p->IsDirs = 0;
+  SzBitUi32s_Init(&p->CRCs);
+  SzBitUi32s_Init(&p->Attribs);
+  p->MTimes.Defs = 0;
+  p->MTimes.Vals = 0;
 }
 
 void SzAr_Free(CSzAr *p, ISzAlloc *alloc)
@@ -124,7 +133,12 @@ void SzAr_Free(CSzAr *p, ISzAlloc *alloc)
   IAlloc_Free(alloc, p->PackCRCsDefined);
   IAlloc_Free(alloc, p->PackCRCs);
   IAlloc_Free(alloc, p->Folders);
-  IAlloc_Free(alloc, p->Files);
+  IAlloc_Free(alloc, p->UnpackPositions);
+  IAlloc_Free(alloc, p->IsDirs);
+  SzBitUi32s_Free(&p->CRCs, alloc);
+  SzBitUi32s_Free(&p->Attribs, alloc);
+  IAlloc_Free(alloc, p->MTimes.Defs);
+  IAlloc_Free(alloc, p->MTimes.Vals);
   SzAr_Init(p);
 }
 
@@ -138,6 +152,8 @@ void SzArEx_Init(CSzArEx *p)
   p->FileIndexToFolderIndexMap = 0;
   p->FileNameOffsets = 0;
   Buf_Init(&p->FileNames);
+  p->NameHash = 0;
+  p->NameHashMask = 0;
 }
 
 void SzArEx_Free(CSzArEx *p, ISzAlloc *alloc)
@@ -149,6 +165,7 @@ void SzArEx_Free(CSzArEx *p, ISzAlloc *alloc)
 
   IAlloc_Free(alloc, p->FileNameOffsets);
   Buf_Free(&p->FileNames, alloc);
+  IAlloc_Free(alloc, p->NameHash);
 
   SzAr_Free(&p->db, alloc);
   SzArEx_Init(p);
@@ -176,7 +193,7 @@ UInt64 GetFilePackSize(int fileIndex) const
 #define MY_ALLOC(T, p, size, alloc) { if ((size) == 0) p = 0; else \
   if ((p = (T *)IAlloc_Alloc(alloc, (size) * sizeof(T))) == 0) return SZ_ERROR_MEM; }
 
-static SRes SzArEx_Fill(CSzArEx *p, ISzAlloc *alloc)
+static SRes SzArEx_Fill(CSzArEx *p, const Byte *emptyStreams, ISzAlloc *alloc)
 {
   UInt32 startPos = 0;
   UInt64 startPosSize = 0;
@@ -203,9 +220,8 @@ static SRes SzArEx_Fill(CSzArEx *p, ISzAlloc *alloc)
 
   for (i = 0; i < p->db.NumFiles; i++)
   {
-    CSzFileItem *file = p->db.Files + i;
-    int emptyStream = !file->HasStream;
-    if (emptyStream && indexInFolder == 0)
+    int emptyStream = (emptyStreams != 0 && SzBitArray_Check(emptyStreams, i));
+    if (emptyStream)
     {
       p->FileIndexToFolderIndexMap[i] = (UInt32)-1;
       continue;
@@ -227,8 +243,6 @@ static SRes SzArEx_Fill(CSzArEx *p, ISzAlloc *alloc)
       }
     }
     p->FileIndexToFolderIndexMap[i] = folderIndex;
-    if (emptyStream)
-      continue;
     indexInFolder++;
     if (indexInFolder >= p->db.Folders[folderIndex].NumUnpackStreams)
     {
@@ -460,6 +474,41 @@ static SRes SzReadBoolVector2(CSzData *sd, size_t numItems, Byte **v, ISzAlloc *
   return SZ_OK;
 }
 
+static SRes SzReadBitVector(CSzData *sd, size_t numItems, Byte **v, ISzAlloc *alloc)
+{
+  size_t numBytes = (numItems + 7) >> 3;
+  IAlloc_Free(alloc, *v);
+  MY_ALLOC(Byte, *v, numBytes, alloc);
+  if (numBytes > sd->Size)
+    return SZ_ERROR_ARCHIVE;
+  memcpy(*v, sd->Data, numBytes);
+  sd->Data += numBytes;
+  sd->Size -= numBytes;
+  return SZ_OK;
+}
+
+static SRes SzReadBitVector2(CSzData *sd, size_t numItems, Byte **v, ISzAlloc *alloc)
+{
+  Byte allAreDefined;
+  RINOK(SzReadByte(sd, &allAreDefined));
+  if (allAreDefined == 0)
+    return SzReadBitVector(sd, numItems, v, alloc);
+  IAlloc_Free(alloc, *v);
+  MY_ALLOC(Byte, *v, (numItems + 7) >> 3, alloc);
+  memset(*v, 0xFF, (numItems + 7) >> 3);
+  return SZ_OK;
+}
+
+static UInt32 SzBitArray_CountOnes(const Byte *v, size_t numItems)
+{
+  UInt32 num = 0;
+  size_t i;
+  for (i = 0; i < numItems; i++)
+    if (SzBitArray_Check(v, i))
+      num++;
+  return num;
+}
+
 static SRes SzReadHashDigests(
     CSzData *sd,
     size_t numItems,
@@ -909,32 +958,111 @@ size_t SzArEx_GetFileNameUtf16(const CSzArEx *p, size_t fileIndex, UInt16 *dest)
   if (dest != 0)
   {
     size_t i;
-    const Byte *src = p->FileNames.data + (p->FileNameOffsets[fileIndex] * 2);
+    const Byte *src = p->FileNames.data + ((size_t)p->FileNameOffsets[fileIndex] * 2);
     for (i = 0; i < len; i++)
       dest[i] = GetUi16(src + i * 2);
   }
   return len;
 }
 
-static SRes SzReadFileNames(const Byte *p, size_t size, UInt32 numFiles, size_t *sizes)
+#define kNameHashInit 0x811C9DC5
+#define NAME_HASH_UPDATE(h, c) (((h) ^ (c)) * 0x01000193)
+
+static UInt32 SzArEx_GetNameHash(const CSzArEx *p, UInt32 fileIndex)
+{
+  const Byte *src = p->FileNames.data + (size_t)p->FileNameOffsets[fileIndex] * 2;
+  const Byte *lim = p->FileNames.data + (size_t)p->FileNameOffsets[fileIndex + 1] * 2 - 2;
+  UInt32 h = kNameHashInit;
+  for (; src != lim; src += 2)
+    h = NAME_HASH_UPDATE(h, GetUi16(src));
+  return h;
+}
+
+static int SzArEx_CompareName(const CSzArEx *p, UInt32 fileIndex, const UInt16 *name, size_t len)
+{
+  size_t i;
+  const Byte *src = p->FileNames.data + (size_t)p->FileNameOffsets[fileIndex] * 2;
+  if (p->FileNameOffsets[fileIndex + 1] - p->FileNameOffsets[fileIndex] != len)
+    return 0;
+  for (i = 0; i < len; i++)
+    if (GetUi16(src + i * 2) != name[i])
+      return 0;
+  return 1;
+}
+
+SRes SzArEx_CreateNameIndex(CSzArEx *p, ISzAlloc *alloc)
 {
+  UInt32 numFiles = p->db.NumFiles;
+  UInt32 size = 1;
   UInt32 i;
-  size_t pos = 0;
+  IAlloc_Free(alloc, p->NameHash);
+  p->NameHash = 0;
+  p->NameHashMask = 0;
+  if (numFiles == 0 || p->FileNameOffsets == 0)
+    return SZ_OK;
+  if (numFiles >= ((UInt32)1 << 30))
+    return SZ_ERROR_MEM;
+  /* the load factor of table is 1/3 ... 2/3 */
+  while (size < numFiles + (numFiles >> 1))
+    size <<= 1;
+  MY_ALLOC(UInt32, p->NameHash, size, alloc);
+  memset(p->NameHash, 0, (size_t)size * sizeof(UInt32));
+  p->NameHashMask = size - 1;
   for (i = 0; i < numFiles; i++)
   {
-    sizes[i] = pos;
-    for (;;)
-    {
-      if (pos >= size)
-        return SZ_ERROR_ARCHIVE;
-      if (p[pos * 2] == 0 && p[pos * 2 + 1] == 0)
-        break;
-      pos++;
-    }
-    pos++;
+    UInt32 h = SzArEx_GetNameHash(p, i) & p->NameHashMask;
+    while (p->NameHash[h] != 0)
+      h = (h + 1) & p->NameHashMask;
+    p->NameHash[h] = i + 1;
   }
-  sizes[i] = pos;
-  return (pos == size) ? SZ_OK : SZ_ERROR_ARCHIVE;
+  return SZ_OK;
+}
+
+UInt32 SzArEx_FindFile(const CSzArEx *p, const UInt16 *name)
+{
+  size_t len;
+  UInt32 i;
+  if (p->FileNameOffsets == 0)
+    return (UInt32)(Int32)-1;
+  for (len = 0; name[len] != 0; len++);
+  len++;
+  if (p->NameHash != 0)
+  {
+    UInt32 h = kNameHashInit;
+    for (i = 0; i + 1 < len; i++)
+      h = NAME_HASH_UPDATE(h, name[i]);
+    for (h &= p->NameHashMask; p->NameHash[h] != 0; h = (h + 1) & p->NameHashMask)
+      if (SzArEx_CompareName(p, p->NameHash[h] - 1, name, len))
+        return p->NameHash[h] - 1;
+    return (UInt32)(Int32)-1;
+  }
+  for (i = 0; i < p->db.NumFiles; i++)
+    if (SzArEx_CompareName(p, i, name, len))
+      return i;
+  return (UInt32)(Int32)-1;
+}
+
+static SRes SzReadFileNames(const Byte *p, size_t size, UInt32 numFiles, UInt32 *sizes)
+{
+  UInt32 i;
+  const Byte *cur = p;
+  const Byte *lim = p + size * 2;
+  if ((UInt32)size != size)
+    return SZ_ERROR_UNSUPPORTED;
+  /* the last name must be terminated, so the inner loop doesn't need size check */
+  if (numFiles != 0 && (size == 0 || GetUi16(lim - 2) != 0))
+    return SZ_ERROR_ARCHIVE;
+  for (i = 0; i < numFiles; i++)
+  {
+    if (cur == lim)
+      return SZ_ERROR_ARCHIVE;
+    sizes[i] = (UInt32)((size_t)(cur - p) >> 1);
+    while (GetUi16(cur) != 0)
+      cur += 2;
+    cur += 2;
+  }
+  sizes[i] = (UInt32)size;
+  return (cur == lim) ? SZ_OK : SZ_ERROR_ARCHIVE;
 }
 
 static SRes SzReadHeader2(
@@ -943,18 +1071,18 @@ static SRes SzReadHeader2(
     UInt64 **unpackSizes,  /* allocTemp */
     Byte **digestsDefined,    /* allocTemp */
     UInt32 **digests,         /* allocTemp */
-    Byte **emptyStreamVector, /* allocTemp */
-    Byte **emptyFileVector,   /* allocTemp */
-    Byte **lwtVector,         /* allocTemp */
+    Byte **emptyStreams,      /* allocTemp, bit array */
+    Byte **emptyFiles,        /* allocTemp, bit array */
     ISzAlloc *allocMain,
     ISzAlloc *allocTemp)
 {
   UInt64 type;
   UInt32 numUnpackStreams = 0;
   UInt32 numFiles = 0;
-  CSzFileItem *files = 0;
   UInt32 numEmptyStreams = 0;
+  UInt32 numEmptyFileBits = 0;
   UInt32 i;
+  CSzAr *db = &p->db;
 
   RINOK(SzReadID(sd, &type));
 
@@ -984,13 +1112,7 @@ static SRes SzReadHeader2(
     return SZ_ERROR_ARCHIVE;
   
   RINOK(SzReadNumber32(sd, &numFiles));
-  p->db.NumFiles = numFiles;
-
-  MY_ALLOC(CSzFileItem, files, (size_t)numFiles, allocMain);
-
-  p->db.Files = files;
-  for (i = 0; i < numFiles; i++)
-    SzFile_Init(files + i);
+  db->NumFiles = numFiles;
 
   for (;;)
   {
@@ -1018,7 +1140,7 @@ static SRes SzReadHeader2(
           return SZ_ERROR_ARCHIVE;
         if (!Buf_Create(&p->FileNames, namesSize, allocMain))
           return SZ_ERROR_MEM;
-        MY_ALLOC(size_t, p->FileNameOffsets, numFiles + 1, allocMain);
+        MY_ALLOC(UInt32, p->FileNameOffsets, numFiles + 1, allocMain);
         memcpy(p->FileNames.data, sd->Data, namesSize);
         RINOK(SzReadFileNames(sd->Data, namesSize >> 1, numFiles, p->FileNameOffsets))
         RINOK(SzSkeepDataSize(sd, namesSize));
@@ -1026,55 +1148,50 @@ static SRes SzReadHeader2(
       }
       case k7zIdEmptyStream:
       {
-        RINOK(SzReadBoolVector(sd, numFiles, emptyStreamVector, allocTemp));
-        numEmptyStreams = 0;
-        for (i = 0; i < numFiles; i++)
-          if ((*emptyStreamVector)[i])
-            numEmptyStreams++;
+        RINOK(SzReadBitVector(sd, numFiles, emptyStreams, allocTemp));
+        numEmptyStreams = SzBitArray_CountOnes(*emptyStreams, numFiles);
         break;
       }
       case k7zIdEmptyFile:
       {
-        RINOK(SzReadBoolVector(sd, numEmptyStreams, emptyFileVector, allocTemp));
+        RINOK(SzReadBitVector(sd, numEmptyStreams, emptyFiles, allocTemp));
+        numEmptyFileBits = numEmptyStreams;
         break;
       }
       case k7zIdWinAttributes:
       {
-        RINOK(SzReadBoolVector2(sd, numFiles, lwtVector, allocTemp));
+        CSzBitUi32s *attribs = &db->Attribs;
+        RINOK(SzReadBitVector2(sd, numFiles, &attribs->Defs, allocMain));
         RINOK(SzReadSwitch(sd));
+        IAlloc_Free(allocMain, attribs->Vals);
+        MY_ALLOC(UInt32, attribs->Vals, numFiles, allocMain);
         for (i = 0; i < numFiles; i++)
         {
-          CSzFileItem *f = &files[i];
-          Byte defined = (*lwtVector)[i];
-          f->AttribDefined = defined;
-          f->Attrib = 0;
-          if (defined)
+          attribs->Vals[i] = 0;
+          if (SzBitArray_Check(attribs->Defs, i))
           {
-            RINOK(SzReadUInt32(sd, &f->Attrib));
+            RINOK(SzReadUInt32(sd, &attribs->Vals[i]));
           }
         }
-        IAlloc_Free(allocTemp, *lwtVector);
-        *lwtVector = NULL;
         break;
       }
       case k7zIdMTime:
       {
-        RINOK(SzReadBoolVector2(sd, numFiles, lwtVector, allocTemp));
+        CSzBitNtfsTimes *times = &db->MTimes;
+        RINOK(SzReadBitVector2(sd, numFiles, &times->Defs, allocMain));
         RINOK(SzReadSwitch(sd));
+        IAlloc_Free(allocMain, times->Vals);
+        MY_ALLOC(CNtfsFileTime, times->Vals, numFiles, allocMain);
         for (i = 0; i < numFiles; i++)
         {
-          CSzFileItem *f = &files[i];
-          Byte defined = (*lwtVector)[i];
-          f->MTimeDefined = defined;
-          f->MTime.Low = f->MTime.High = 0;
-          if (defined)
+          CNtfsFileTime *t = &times->Vals[i];
+          t->Low = t->High = 0;
+          if (SzBitArray_Check(times->Defs, i))
           {
-            RINOK(SzReadUInt32(sd, &f->MTime.Low));
-            RINOK(SzReadUInt32(sd, &f->MTime.High));
+            RINOK(SzReadUInt32(sd, &t->Low));
+            RINOK(SzReadUInt32(sd, &t->High));
           }
         }
-        IAlloc_Free(allocTemp, *lwtVector);
-        *lwtVector = NULL;
         break;
       }
       default:
@@ -1087,36 +1204,65 @@ static SRes SzReadHeader2(
   {
     UInt32 emptyFileIndex = 0;
     UInt32 sizeIndex = 0;
+    UInt32 numDirs = 0;
+    UInt32 numCRCs = 0;
+    UInt64 pos = 0;
+    size_t numBytes = ((size_t)numFiles + 7) >> 3;
+
+    for (i = 0; i < numUnpackStreams; i++)
+      if ((*digestsDefined)[i])
+        numCRCs++;
+
+    MY_ALLOC(UInt64, db->UnpackPositions, (size_t)numFiles + 1, allocMain);
+    if (numEmptyStreams != 0)
+    {
+      MY_ALLOC(Byte, db->IsDirs, numBytes, allocMain);
+      memset(db->IsDirs, 0, numBytes);
+    }
+    if (numCRCs != 0)
+    {
+      MY_ALLOC(Byte, db->CRCs.Defs, numBytes, allocMain);
+      MY_ALLOC(UInt32, db->CRCs.Vals, numFiles, allocMain);
+      memset(db->CRCs.Defs, 0, numBytes);
+    }
+
     for (i = 0; i < numFiles; i++)
     {
-      CSzFileItem *file = files + i;
-      file->IsAnti = 0;
-      if (*emptyStreamVector == 0)
-        file->HasStream = 1;
-      else
-        file->HasStream = (Byte)((*emptyStreamVector)[i] ? 0 : 1);
-      if (file->HasStream)
+      db->UnpackPositions[i] = pos;
+      if (*emptyStreams == 0 || !SzBitArray_Check(*emptyStreams, i))
       {
-        file->IsDir = 0;
-        file->Size = (*unpackSizes)[sizeIndex];
-        file->Crc = (*digests)[sizeIndex];
-        file->CrcDefined = (Byte)(*digestsDefined)[sizeIndex];
+        if (sizeIndex >= numUnpackStreams)
+          return SZ_ERROR_ARCHIVE;
+        pos += (*unpackSizes)[sizeIndex];
+        if (numCRCs != 0)
+        {
+          db->CRCs.Vals[i] = (*digests)[sizeIndex];
+          if ((*digestsDefined)[sizeIndex])
+            db->CRCs.Defs[i >> 3] |= (Byte)(0x80 >> (i & 7));
+        }
         sizeIndex++;
       }
       else
       {
-        if (*emptyFileVector == 0)
-          file->IsDir = 1;
-        else
-          file->IsDir = (Byte)((*emptyFileVector)[emptyFileIndex] ? 0 : 1);
+        if (emptyFileIndex >= numEmptyFileBits || !SzBitArray_Check(*emptyFiles, emptyFileIndex))
+        {
+          db->IsDirs[i >> 3] |= (Byte)(0x80 >> (i & 7));
+          numDirs++;
+        }
         emptyFileIndex++;
-        file->Size = 0;
-        file->Crc = 0;
-        file->CrcDefined = 0;
+        if (numCRCs != 0)
+          db->CRCs.Vals[i] = 0;
       }
     }
+    db->UnpackPositions[i] = pos;
+
+    if (numDirs == 0)
+    {
+      IAlloc_Free(allocMain, db->IsDirs);
+      db->IsDirs = 0;
+    }
   }
-  return SzArEx_Fill(p, allocMain);
+  return SzArEx_Fill(p, *emptyStreams, allocMain);
 }
 
 static SRes SzReadHeader(
@@ -1128,19 +1274,17 @@ static SRes SzReadHeader(
   UInt64 *unpackSizes = 0;
   Byte *digestsDefined = 0;
   UInt32 *digests = 0;
-  Byte *emptyStreamVector = 0;
-  Byte *emptyFileVector = 0;
-  Byte *lwtVector = 0;
+  Byte *emptyStreams = 0;
+  Byte *emptyFiles = 0;
   SRes res = SzReadHeader2(p, sd,
       &unpackSizes, &digestsDefined, &digests,
-      &emptyStreamVector, &emptyFileVector, &lwtVector,
+      &emptyStreams, &emptyFiles,
       allocMain, allocTemp);
   IAlloc_Free(allocTemp, unpackSizes);
   IAlloc_Free(allocTemp, digestsDefined);
   IAlloc_Free(allocTemp, digests);
-  IAlloc_Free(allocTemp, emptyStreamVector);
-  IAlloc_Free(allocTemp, emptyFileVector);
-  IAlloc_Free(allocTemp, lwtVector);
+  IAlloc_Free(allocTemp, emptyStreams);
+  IAlloc_Free(allocTemp, emptyFiles);
   return res;
 }
 
@@ -1387,15 +1531,13 @@ SRes SzArEx_Extract(
   }
   if (res == SZ_OK)
   {
-    UInt32 i;
-    CSzFileItem *fileItem = p->db.Files + fileIndex;
-    *offset = 0;
-    for (i = p->FolderStartFileIndex[folderIndex]; i < fileIndex; i++)
-      *offset += (UInt32)p->db.Files[i].Size;
-    *outSizeProcessed = (size_t)fileItem->Size;
+    UInt64 folderStart = p->db.UnpackPositions[p->FolderStartFileIndex[folderIndex]];
+    *offset = (size_t)(p->db.UnpackPositions[fileIndex] - folderStart);
+    *outSizeProcessed = (size_t)SzArEx_GetFileSize(p, fileIndex);
     if (*offset + *outSizeProcessed > *outBufferSize)
       return SZ_ERROR_FAIL;
-    if (fileItem->CrcDefined && CrcCalc(*outBuffer + *offset, *outSizeProcessed) != fileItem->Crc)
+    if (SzBitWithVals_Check(&p->db.CRCs, fileIndex) &&
+        CrcCalc(*outBuffer + *offset, *outSizeProcessed) != p->db.CRCs.Vals[fileIndex])
       res = SZ_ERROR_CRC;
   }
   return res;
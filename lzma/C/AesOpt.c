@@ -0,0 +1,176 @@
+/* AesOpt.c -- Intel's AES
+2010-11-18 : Igor Pavlov : Public domain */
+
+#include "CpuArch.h"
+
+#if defined(MY_CPU_X86_OR_AMD64) && ( \
+    (defined(__GNUC__) && (__GNUC__ >= 5) && !defined(__clang__)) || \
+    (defined(__clang__) && (__clang_major__ >= 4)) || \
+    (defined(_MSC_VER) && (_MSC_VER >= 1600)))
+#define USE_INTEL_AES
+#endif
+
+#ifdef USE_INTEL_AES
+
+/*
+Same interface and key layout as Asm/x86/AesOpt.asm:
+  ivAes[0 ... 3]   - iv (CBC) or counter (CTR)
+  ivAes[4]         - numRounds / 2
+  ivAes[8 ... ]    - round keys
+Decoding keys are already transformed for AESDEC by Aes_SetKey_Dec().
+CBC encoding is serial. CBC decoding and CTR code NUM_WAYS blocks
+at once to hide the latency of AESDEC / AESENC.
+*/
+
+#include <wmmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ATTRIB_AES __attribute__((__target__("sse2,aes")))
+#else
+#define ATTRIB_AES
+#endif
+
+#ifdef MY_CPU_AMD64
+#define NUM_WAYS 8
+#define OP_W(op) op(0) op(1) op(2) op(3) op(4) op(5) op(6) op(7)
+#else
+#define NUM_WAYS 4
+#define OP_W(op) op(0) op(1) op(2) op(3)
+#endif
+
+#define AES_LOAD(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define AES_STORE(p, v) _mm_storeu_si128((__m128i *)(void *)(p), v)
+
+void MY_FAST_CALL ATTRIB_AES AesCbc_Encode_Intel(UInt32 *p, Byte *data, size_t numBlocks)
+{
+  __m128i m = *(const __m128i *)p;
+  const __m128i *wStart = (const __m128i *)p + 2;
+  UInt32 numRounds2 = p[4];
+  for (; numBlocks != 0; numBlocks--, data += 16)
+  {
+    const __m128i *w = wStart;
+    UInt32 r = numRounds2 - 1;
+    m = _mm_xor_si128(m, _mm_xor_si128(AES_LOAD(data), w[0]));
+    do
+    {
+      m = _mm_aesenc_si128(m, w[1]);
+      m = _mm_aesenc_si128(m, w[2]);
+      w += 2;
+    }
+    while (--r);
+    m = _mm_aesenc_si128(m, w[1]);
+    m = _mm_aesenclast_si128(m, w[2]);
+    AES_STORE(data, m);
+  }
+  *(__m128i *)p = m;
+}
+
+#define DEC_LOAD(i) __m128i m##i = _mm_xor_si128(AES_LOAD(data + (i) * 16), w[0]);
+#define DEC_ROUND(i) m##i = _mm_aesdec_si128(m##i, w[0]);
+#define DEC_LAST(i) m##i = _mm_aesdeclast_si128(m##i, w[0]);
+#define DEC_XOR(i) { __m128i c = AES_LOAD(data + (i) * 16); AES_STORE(data + (i) * 16, _mm_xor_si128(m##i, iv)); iv = c; }
+
+void MY_FAST_CALL ATTRIB_AES AesCbc_Decode_Intel(UInt32 *p, Byte *data, size_t numBlocks)
+{
+  __m128i iv = *(const __m128i *)p;
+  const __m128i *wStart = (const __m128i *)p + 2;
+  const __m128i *wEnd = wStart + p[4] * 2;
+
+  for (; numBlocks >= NUM_WAYS; numBlocks -= NUM_WAYS, data += NUM_WAYS * 16)
+  {
+    const __m128i *w = wEnd;
+    OP_W(DEC_LOAD)
+    do
+    {
+      w--;
+      OP_W(DEC_ROUND)
+    }
+    while (w != wStart + 1);
+    w--;
+    OP_W(DEC_LAST)
+    OP_W(DEC_XOR)
+  }
+
+  for (; numBlocks != 0; numBlocks--, data += 16)
+  {
+    const __m128i *w = wEnd;
+    DEC_LOAD(0)
+    do
+    {
+      w--;
+      DEC_ROUND(0)
+    }
+    while (w != wStart + 1);
+    w--;
+    DEC_LAST(0)
+    DEC_XOR(0)
+  }
+  *(__m128i *)p = iv;
+}
+
+#define CTR_START(i) __m128i m##i = _mm_xor_si128(ctr = _mm_add_epi64(ctr, one), w[0]);
+#define CTR_ROUND(i) m##i = _mm_aesenc_si128(m##i, w[0]);
+#define CTR_LAST(i) m##i = _mm_aesenclast_si128(m##i, w[0]);
+#define CTR_XOR(i) AES_STORE(data + (i) * 16, _mm_xor_si128(m##i, AES_LOAD(data + (i) * 16)));
+
+void MY_FAST_CALL ATTRIB_AES AesCtr_Code_Intel(UInt32 *p, Byte *data, size_t numBlocks)
+{
+  __m128i ctr = *(const __m128i *)p;
+  __m128i one = _mm_cvtsi32_si128(1);
+  const __m128i *wStart = (const __m128i *)p + 2;
+  const __m128i *wEnd = wStart + p[4] * 2;
+
+  for (; numBlocks >= NUM_WAYS; numBlocks -= NUM_WAYS, data += NUM_WAYS * 16)
+  {
+    const __m128i *w = wStart;
+    OP_W(CTR_START)
+    do
+    {
+      w++;
+      OP_W(CTR_ROUND)
+    }
+    while (w != wEnd - 1);
+    w++;
+    OP_W(CTR_LAST)
+    OP_W(CTR_XOR)
+  }
+
+  for (; numBlocks != 0; numBlocks--, data += 16)
+  {
+    const __m128i *w = wStart;
+    CTR_START(0)
+    do
+    {
+      w++;
+      CTR_ROUND(0)
+    }
+    while (w != wEnd - 1);
+    w++;
+    CTR_LAST(0)
+    CTR_XOR(0)
+  }
+  *(__m128i *)p = ctr;
+}
+
+#elif defined(MY_CPU_X86_OR_AMD64)
+
+void MY_FAST_CALL AesCbc_Encode(UInt32 *ivAes, Byte *data, size_t numBlocks);
+void MY_FAST_CALL AesCbc_Decode(UInt32 *ivAes, Byte *data, size_t numBlocks);
+void MY_FAST_CALL AesCtr_Code(UInt32 *ivAes, Byte *data, size_t numBlocks);
+
+void MY_FAST_CALL AesCbc_Encode_Intel(UInt32 *p, Byte *data, size_t numBlocks)
+{
+  AesCbc_Encode(p, data, numBlocks);
+}
+
+void MY_FAST_CALL AesCbc_Decode_Intel(UInt32 *p, Byte *data, size_t numBlocks)
+{
+  AesCbc_Decode(p, data, numBlocks);
+}
+
+void MY_FAST_CALL AesCtr_Code_Intel(UInt32 *p, Byte *data, size_t numBlocks)
+{
+  AesCtr_Code(p, data, numBlocks);
+}
+
+#endif
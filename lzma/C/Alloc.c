@@ -6,6 +6,15 @@ Public domain */
 #ifdef _WIN32
 #include <windows.h>
 #endif
+#ifdef __linux__
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef _7ZIP_NUMA
+#include <string.h>
+#include <sys/syscall.h>
+#endif
+#endif
 #include <stdlib.h>
 
 #include "Alloc.h"
@@ -125,3 +134,186 @@ void BigFree(void *address)
 }
 
 #endif
+
+#ifdef __linux__
+
+/*
+  BigAlloc for Linux:
+    blocks of (1 << 18) bytes or more are mapped with mmap(). The returned address is
+    aligned to the 2 MiB huge page size and the range is marked with madvise(MADV_HUGEPAGE),
+    so transparent huge pages can back the dictionary and match finder arrays.
+    With _7ZIP_LARGE_PAGES, after SetLargePageSize() it tries explicit MAP_HUGETLB pages first.
+    With _7ZIP_NUMA, pages are preferably placed on the NUMA node of the allocating thread.
+  The header with the mapping size (0 for malloc() blocks) is stored just before the
+  returned address. For mapped blocks it's at the end of one additional normal page that
+  is mapped before the aligned data, so the data starts at huge page boundary.
+*/
+
+#define BIG_ALLOC_HEADER_SIZE 64
+#define BIG_ALLOC_MMAP_MIN ((size_t)1 << 18)
+#define BIG_ALLOC_THP_SIZE ((size_t)1 << 21)
+
+#ifdef _7ZIP_LARGE_PAGES
+#ifndef MAP_HUGETLB
+#undef _7ZIP_LARGE_PAGES
+#endif
+#endif
+
+#ifdef _7ZIP_LARGE_PAGES
+size_t g_LargePageSize = 0;
+#endif
+
+void SetLargePageSize()
+{
+  #ifdef _7ZIP_LARGE_PAGES
+  FILE *f = fopen("/proc/meminfo", "r");
+  if (f)
+  {
+    char line[128];
+    unsigned long size;
+    while (fgets(line, sizeof(line), f))
+      if (sscanf(line, "Hugepagesize: %lu kB", &size) == 1)
+      {
+        size <<= 10;
+        if (size != 0 && (size & (size - 1)) == 0)
+          g_LargePageSize = size;
+        break;
+      }
+    fclose(f);
+  }
+  #endif
+}
+
+#ifdef _7ZIP_NUMA
+
+#define MY_MPOL_PREFERRED 1
+
+static void BindToLocalNode(void *address, size_t size)
+{
+  unsigned cpu, node;
+  unsigned long mask[4];
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= sizeof(mask) * 8)
+    return;
+  memset(mask, 0, sizeof(mask));
+  mask[node / (sizeof(mask[0]) * 8)] = (unsigned long)1 << (node % (sizeof(mask[0]) * 8));
+  syscall(SYS_mbind, address, size, MY_MPOL_PREFERRED, mask, (unsigned long)sizeof(mask) * 8, 0);
+}
+
+#endif
+
+/* MapAligned maps (size) bytes at (alignment) boundary and one page before them.
+   With (hugeTlb) the aligned part is mapped with MAP_HUGETLB. */
+
+static unsigned char *MapAligned(size_t size, size_t alignment, size_t pageSize, int hugeTlb)
+{
+  size_t allocSize = pageSize + size + alignment;
+  size_t extra;
+  unsigned char *p;
+  if (allocSize < size)
+    return NULL;
+  p = (unsigned char *)mmap(NULL, allocSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == (unsigned char *)MAP_FAILED)
+    return NULL;
+  extra = (size_t)((0 - (size_t)(p + pageSize)) & (alignment - 1));
+  if (extra != 0)
+    munmap(p, extra);
+  if (alignment - extra != 0)
+    munmap(p + pageSize + extra + size, alignment - extra);
+  p += pageSize + extra;
+  #ifdef _7ZIP_LARGE_PAGES
+  if (hugeTlb)
+  {
+    /* it replaces the part of our own mapping */
+    if (mmap(p, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0) == MAP_FAILED)
+    {
+      munmap(p - pageSize, pageSize + size);
+      return NULL;
+    }
+  }
+  #else
+  (void)hugeTlb;
+  #endif
+  return p;
+}
+
+void *BigAlloc(size_t size)
+{
+  unsigned char *p = NULL;
+  size_t mapSize;
+  size_t pageSize;
+  if (size == 0)
+    return 0;
+  #ifdef _SZ_ALLOC_DEBUG
+  fprintf(stderr, "\nAlloc_Big %10d bytes;  count = %10d", size, g_allocCountBig++);
+  #endif
+
+  if (size > ((size_t)0 - BIG_ALLOC_THP_SIZE * 4))
+    return 0;
+
+  if (size < BIG_ALLOC_MMAP_MIN)
+  {
+    p = (unsigned char *)malloc(size + BIG_ALLOC_HEADER_SIZE);
+    if (p == 0)
+      return 0;
+    *(size_t *)p = 0;
+    return p + BIG_ALLOC_HEADER_SIZE;
+  }
+
+  pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  if (pageSize < BIG_ALLOC_HEADER_SIZE || (pageSize & (pageSize - 1)) != 0)
+    pageSize = 1 << 12;
+
+  #ifdef _7ZIP_LARGE_PAGES
+  if (g_LargePageSize != 0 && g_LargePageSize <= ((size_t)1 << 30))
+  {
+    mapSize = (size + g_LargePageSize - 1) & (~(g_LargePageSize - 1));
+    if (mapSize >= size)
+      p = MapAligned(mapSize, g_LargePageSize, pageSize, 1);
+  }
+  #endif
+
+  if (p == NULL)
+  {
+    mapSize = (size + BIG_ALLOC_THP_SIZE - 1) & (~(BIG_ALLOC_THP_SIZE - 1));
+    p = MapAligned(mapSize, BIG_ALLOC_THP_SIZE, pageSize, 0);
+    if (p == NULL)
+      return 0;
+    #ifdef MADV_HUGEPAGE
+    madvise(p, mapSize, MADV_HUGEPAGE);
+    #endif
+  }
+
+  #ifdef _7ZIP_NUMA
+  BindToLocalNode(p, mapSize);
+  #endif
+
+  ((size_t *)(p - BIG_ALLOC_HEADER_SIZE))[0] = mapSize;
+  ((size_t *)(p - BIG_ALLOC_HEADER_SIZE))[1] = pageSize;
+  return p;
+}
+
+void BigFree(void *address)
+{
+  unsigned char *p;
+  size_t mapSize;
+  #ifdef _SZ_ALLOC_DEBUG
+  if (address != 0)
+    fprintf(stderr, "\nFree_Big; count = %10d", --g_allocCountBig);
+  #endif
+
+  if (address == 0)
+    return;
+  p = (unsigned char *)address;
+  mapSize = ((const size_t *)(p - BIG_ALLOC_HEADER_SIZE))[0];
+  if (mapSize == 0)
+    free(p - BIG_ALLOC_HEADER_SIZE);
+  else
+  {
+    size_t pageSize = ((const size_t *)(p - BIG_ALLOC_HEADER_SIZE))[1];
+    /* the data can be MAP_HUGETLB mapping: it's unmapped separately from the header page */
+    munmap(p, mapSize);
+    munmap(p - pageSize, pageSize);
+  }
+}
+
+#endif
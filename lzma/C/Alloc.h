@@ -26,11 +26,23 @@ void BigFree(void *address);
 
 #define MidAlloc(size) MyAlloc(size)
 #define MidFree(address) MyFree(address)
+
+#ifdef __linux__
+
+void SetLargePageSize();
+
+void *BigAlloc(size_t size);
+void BigFree(void *address);
+
+#else
+
 #define BigAlloc(size) MyAlloc(size)
 #define BigFree(address) MyFree(address)
 
 #endif
 
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,6 +2,12 @@
 2008-10-04 : Igor Pavlov : Public domain */
 
 #include "Bra.h"
+#include "CpuArch.h"
+
+#if defined(MY_CPU_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define USE_SSE2_SCAN
+#include <emmintrin.h>
+#endif
 
 #define Test86MSByte(b) ((b) == 0 || (b) == 0xFF)
 
@@ -21,6 +27,17 @@ SizeT x86_Convert(Byte *data, SizeT size, UInt32 ip, UInt32 *state, int encoding
   {
     Byte *p = data + bufferPos;
     Byte *limit = data + size - 4;
+    #ifdef USE_SSE2_SCAN
+    {
+      /* skip 16-byte blocks without E8 / E9 */
+      const __m128i mask = _mm_set1_epi8((char)0xFE);
+      const __m128i e8 = _mm_set1_epi8((char)0xE8);
+      for (; limit - p >= 16; p += 16)
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(
+            _mm_loadu_si128((const __m128i *)(const void *)p), mask), e8)) != 0)
+          break;
+    }
+    #endif
     for (; p < limit; p++)
       if ((*p & 0xFE) == 0xE8)
         break;
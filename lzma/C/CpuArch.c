@@ -9,6 +9,10 @@
 #define USE_ASM
 #endif
 
+#if !defined(USE_ASM) && defined(_MSC_VER) && (_MSC_VER >= 1600)
+#include <immintrin.h>
+#endif
+
 #if defined(USE_ASM) && !defined(MY_CPU_AMD64)
 static UInt32 CheckFlag(UInt32 flag)
 {
@@ -78,14 +82,14 @@ static void MyCPUID(UInt32 function, UInt32 *a, UInt32 *b, UInt32 *c, UInt32 *d)
       "=b" (*b) ,
       "=c" (*c) ,
       "=d" (*d)
-    : "0" (function)) ;
+    : "0" (function), "2" (0)) ;
 
   #endif
   
   #else
 
   int CPUInfo[4];
-  __cpuid(CPUInfo, function);
+  __cpuidex(CPUInfo, function, 0);
   *a = CPUInfo[0];
   *b = CPUInfo[1];
   *c = CPUInfo[2];
@@ -94,6 +98,45 @@ static void MyCPUID(UInt32 function, UInt32 *a, UInt32 *b, UInt32 *c, UInt32 *d)
   #endif
 }
 
+/* reads XCR0 to check that OS saves AVX registers. Call it only if OSXSAVE bit is set */
+
+static UInt32 MyXGETBV0()
+{
+  #ifdef USE_ASM
+
+  #ifdef _MSC_VER
+
+  UInt32 a2;
+  __asm xor ECX, ECX;
+  __asm _emit 0x0F;
+  __asm _emit 0x01;
+  __asm _emit 0xD0;
+  __asm mov a2, EAX;
+  return a2;
+
+  #else
+
+  UInt32 a, d;
+  __asm__ __volatile__ (
+    ".byte 0x0f, 0x01, 0xd0"
+    : "=a" (a) ,
+      "=d" (d)
+    : "c" (0)) ;
+  return a;
+
+  #endif
+
+  #elif defined(_MSC_VER) && (_MSC_VER >= 1600)
+
+  return (UInt32)_xgetbv(0);
+
+  #else
+
+  return 0;
+
+  #endif
+}
+
 Bool x86cpuid_CheckAndRead(Cx86cpuid *p)
 {
   CHECK_CPUID_IS_SUPPORTED
@@ -165,4 +208,44 @@ Bool CPU_Is_Aes_Supported()
   return (p.c >> 25) & 1;
 }
 
+Bool CPU_Is_Clmul_Supported()
+{
+  Cx86cpuid p;
+  CHECK_SYS_SSE_SUPPORT
+  if (!x86cpuid_CheckAndRead(&p))
+    return False;
+  /* PCLMULQDQ and SSE2 */
+  return ((p.c >> 1) & 1) && ((p.d >> 26) & 1);
+}
+
+Bool CPU_Is_Sha_Supported()
+{
+  Cx86cpuid p;
+  UInt32 a, b, c, d;
+  CHECK_SYS_SSE_SUPPORT
+  if (!x86cpuid_CheckAndRead(&p))
+    return False;
+  /* SHA code also uses SSSE3 and SSE4.1 */
+  if (p.maxFunc < 7 || ((p.c >> 9) & 1) == 0 || ((p.c >> 19) & 1) == 0)
+    return False;
+  MyCPUID(7, &a, &b, &c, &d);
+  return (b >> 29) & 1;
+}
+
+Bool CPU_Is_Avx2_Supported()
+{
+  Cx86cpuid p;
+  UInt32 a, b, c, d;
+  CHECK_SYS_SSE_SUPPORT
+  if (!x86cpuid_CheckAndRead(&p))
+    return False;
+  /* AVX and OSXSAVE, and OS must save XMM and YMM state */
+  if (p.maxFunc < 7 || ((p.c >> 27) & 1) == 0 || ((p.c >> 28) & 1) == 0)
+    return False;
+  if ((MyXGETBV0() & 6) != 6)
+    return False;
+  MyCPUID(7, &a, &b, &c, &d);
+  return (b >> 5) & 1;
+}
+
 #endif
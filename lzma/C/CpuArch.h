@@ -147,6 +147,9 @@ int x86cpuid_GetFirm(const Cx86cpuid *p);
 
 Bool CPU_Is_InOrder();
 Bool CPU_Is_Aes_Supported();
+Bool CPU_Is_Clmul_Supported();
+Bool CPU_Is_Sha_Supported();
+Bool CPU_Is_Avx2_Supported();
 
 #endif
 
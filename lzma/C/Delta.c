@@ -2,6 +2,14 @@
 2009-05-26 : Igor Pavlov : Public domain */
 
 #include "Delta.h"
+#include "CpuArch.h"
+
+#if defined(MY_CPU_AMD64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define USE_SSE2
+#include <emmintrin.h>
+#define LOAD_128(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define STORE_128(p, v) _mm_storeu_si128((__m128i *)(void *)(p), v)
+#endif
 
 void Delta_Init(Byte *state)
 {
@@ -17,7 +25,9 @@ static void MyMemCpy(Byte *dest, const Byte *src, unsigned size)
     dest[i] = src[i];
 }
 
-void Delta_Encode(Byte *state, unsigned delta, Byte *data, SizeT size)
+/* Delta_Encode_Small and Delta_Decode_Small are used for (size < delta) */
+
+static void Delta_Encode_Small(Byte *state, unsigned delta, Byte *data, SizeT size)
 {
   Byte buf[DELTA_STATE_SIZE];
   unsigned j = 0;
@@ -40,7 +50,7 @@ void Delta_Encode(Byte *state, unsigned delta, Byte *data, SizeT size)
   MyMemCpy(state + delta - j, buf, j);
 }
 
-void Delta_Decode(Byte *state, unsigned delta, Byte *data, SizeT size)
+static void Delta_Decode_Small(Byte *state, unsigned delta, Byte *data, SizeT size)
 {
   Byte buf[DELTA_STATE_SIZE];
   unsigned j = 0;
@@ -60,3 +70,109 @@ void Delta_Decode(Byte *state, unsigned delta, Byte *data, SizeT size)
   MyMemCpy(state, buf + j, delta - j);
   MyMemCpy(state + delta - j, buf, j);
 }
+
+/*
+state[j] is the byte at position (j - delta) relative to data.
+Encoding goes from the end of buffer to the start, so each byte
+is subtracted from the original byte (delta) positions before it.
+*/
+
+void Delta_Encode(Byte *state, unsigned delta, Byte *data, SizeT size)
+{
+  Byte buf[DELTA_STATE_SIZE];
+  SizeT i;
+  if (size < delta)
+  {
+    Delta_Encode_Small(state, delta, data, size);
+    return;
+  }
+  MyMemCpy(buf, data + size - delta, delta);
+  i = size;
+  #ifdef USE_SSE2
+  for (; i - delta >= 16;)
+  {
+    i -= 16;
+    STORE_128(data + i, _mm_sub_epi8(LOAD_128(data + i), LOAD_128(data + i - delta)));
+  }
+  #endif
+  for (; i > delta;)
+  {
+    i--;
+    data[i] = (Byte)(data[i] - data[i - delta]);
+  }
+  for (i = 0; i < delta; i++)
+    data[i] = (Byte)(data[i] - state[i]);
+  MyMemCpy(state, buf, delta);
+}
+
+#ifdef USE_SSE2
+
+/*
+Decoding is prefix sum with step (delta). For delta = 1, 2, 4, 8 we sum
+16-byte vector with its shifted copies, and then we add the last (delta)
+bytes of previous vector (carry) that are broadcasted to all positions.
+*/
+
+#define DELTA_ADD_SHIFTED(n) v = _mm_add_epi8(v, _mm_slli_si128(v, n));
+
+#define DELTA_DEC_LOOP(prefixSum, broadcast) \
+  for (; size - i >= 16; i += 16) { \
+    __m128i v = LOAD_128(data + i); \
+    prefixSum \
+    v = _mm_add_epi8(v, carry); \
+    STORE_128(data + i, v); \
+    carry = broadcast; }
+
+static SizeT Delta_Decode_Sse2(unsigned delta, Byte *data, SizeT i, SizeT size)
+{
+  __m128i carry;
+  switch (delta)
+  {
+    case 1:
+      carry = _mm_set1_epi8((char)data[i - 1]);
+      DELTA_DEC_LOOP(DELTA_ADD_SHIFTED(1) DELTA_ADD_SHIFTED(2) DELTA_ADD_SHIFTED(4) DELTA_ADD_SHIFTED(8),
+          _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_unpackhi_epi8(v, v), 0xFF), 0xFF))
+      break;
+    case 2:
+      carry = _mm_set1_epi16((short)GetUi16(data + i - 2));
+      DELTA_DEC_LOOP(DELTA_ADD_SHIFTED(2) DELTA_ADD_SHIFTED(4) DELTA_ADD_SHIFTED(8),
+          _mm_shuffle_epi32(_mm_shufflehi_epi16(v, 0xFF), 0xFF))
+      break;
+    case 4:
+      carry = _mm_set1_epi32((int)GetUi32(data + i - 4));
+      DELTA_DEC_LOOP(DELTA_ADD_SHIFTED(4) DELTA_ADD_SHIFTED(8),
+          _mm_shuffle_epi32(v, 0xFF))
+      break;
+    case 8:
+      carry = _mm_loadl_epi64((const __m128i *)(const void *)(data + i - 8));
+      carry = _mm_unpacklo_epi64(carry, carry);
+      DELTA_DEC_LOOP(DELTA_ADD_SHIFTED(8),
+          _mm_unpackhi_epi64(v, v))
+      break;
+    default:
+      if (delta >= 16)
+        for (; size - i >= 16; i += 16)
+          STORE_128(data + i, _mm_add_epi8(LOAD_128(data + i), LOAD_128(data + i - delta)));
+  }
+  return i;
+}
+
+#endif
+
+void Delta_Decode(Byte *state, unsigned delta, Byte *data, SizeT size)
+{
+  SizeT i;
+  if (size < delta)
+  {
+    Delta_Decode_Small(state, delta, data, size);
+    return;
+  }
+  for (i = 0; i < delta; i++)
+    data[i] = (Byte)(data[i] + state[i]);
+  #ifdef USE_SSE2
+  i = Delta_Decode_Sse2(delta, data, i, size);
+  #endif
+  for (; i < size; i++)
+    data[i] = (Byte)(data[i] + data[i - delta]);
+  MyMemCpy(state, data + size - delta, delta);
+}
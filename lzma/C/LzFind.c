@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+#include "CpuArch.h"
 #include "LzFind.h"
 #include "LzHash.h"
 
@@ -124,18 +125,25 @@ static void MatchFinder_SetDefaultSettings(CMatchFinder *p)
 {
   p->cutValue = 32;
   p->btMode = 1;
+  p->hashOnly = 0;
+  p->wordCompare = 1;
   p->numHashBytes = 4;
   p->bigHash = 0;
 }
 
 #define kCrcPoly 0xEDB88320
 
+static void SkipMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *cur, CLzRef *son,
+    UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 cutValue);
+
 void MatchFinder_Construct(CMatchFinder *p)
 {
   UInt32 i;
   p->bufferBase = 0;
   p->directInput = 0;
   p->hash = 0;
+  p->GetMatchesSpec = GetMatchesSpec1;
+  p->SkipMatchesSpec = SkipMatchesSpec;
   MatchFinder_SetDefaultSettings(p);
 
   for (i = 0; i < 256; i++)
@@ -214,9 +222,12 @@ int MatchFinder_Create(CMatchFinder *p, UInt32 historySize,
       }
       p->hashMask = hs;
       hs++;
-      if (p->numHashBytes > 2) p->fixedHashSize += kHash2Size;
-      if (p->numHashBytes > 3) p->fixedHashSize += kHash3Size;
-      if (p->numHashBytes > 4) p->fixedHashSize += kHash4Size;
+      if (!p->hashOnly)
+      {
+        if (p->numHashBytes > 2) p->fixedHashSize += kHash2Size;
+        if (p->numHashBytes > 3) p->fixedHashSize += kHash3Size;
+        if (p->numHashBytes > 4) p->fixedHashSize += kHash4Size;
+      }
       hs += p->fixedHashSize;
     }
 
@@ -226,7 +237,7 @@ int MatchFinder_Create(CMatchFinder *p, UInt32 historySize,
       p->historySize = historySize;
       p->hashSizeSum = hs;
       p->cyclicBufferSize = newCyclicBufferSize;
-      p->numSons = (p->btMode ? newCyclicBufferSize * 2 : newCyclicBufferSize);
+      p->numSons = (p->hashOnly ? 0 : p->btMode ? newCyclicBufferSize * 2 : newCyclicBufferSize);
       newSize = p->hashSizeSum + p->numSons;
       if (p->hash != 0 && prevSize == newSize)
         return 1;
@@ -455,6 +466,188 @@ static void SkipMatchesSpec(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const
   }
 }
 
+#ifdef MY_CPU_LE_UNALIGN
+
+/*
+GetMatchesSpec1W() and SkipMatchesSpecW() build the same binary tree and
+return the same matches as GetMatchesSpec1() and SkipMatchesSpec().
+But they compare the bytes by words: the first mismatch is the lowest
+non-zero byte of (a ^ b). Words are read only below lenLimit.
+Both child nodes of the current node are prefetched before the compare,
+since the next node is one of them.
+*/
+
+#ifdef MY_CPU_64BIT
+  #define MF_WORD_SIZE 8
+  #define MF_GET_WORD(p) GetUi64(p)
+  typedef UInt64 CMfWord;
+#else
+  #define MF_WORD_SIZE 4
+  #define MF_GET_WORD(p) GetUi32(p)
+  typedef UInt32 CMfWord;
+#endif
+
+#if (defined(__GNUC__) && (__GNUC__ >= 4)) || defined(__clang__)
+  #ifdef MY_CPU_64BIT
+    #define MF_GET_BYTE_POS(v) ((UInt32)__builtin_ctzll(v) >> 3)
+  #else
+    #define MF_GET_BYTE_POS(v) ((UInt32)__builtin_ctz(v) >> 3)
+  #endif
+  #define MF_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (_MSC_VER >= 1400) && defined(MY_CPU_X86_OR_AMD64)
+  #include <intrin.h>
+  static UInt32 MfGetBytePos(CMfWord v)
+  {
+    unsigned long i;
+    #ifdef MY_CPU_64BIT
+    _BitScanForward64(&i, v);
+    #else
+    _BitScanForward(&i, v);
+    #endif
+    return (UInt32)i >> 3;
+  }
+  #define MF_GET_BYTE_POS(v) MfGetBytePos(v)
+  #define MF_PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+  static UInt32 MfGetBytePos(CMfWord v)
+  {
+    UInt32 i = 0;
+    for (; ((Byte)v) == 0; v >>= 8)
+      i++;
+    return i;
+  }
+  #define MF_GET_BYTE_POS(v) MfGetBytePos(v)
+#endif
+
+/* returns the position of first mismatch of (pb) and (cur) in [len, lenLimit] */
+static UInt32 MfGetMatchLen(const Byte *pb, const Byte *cur, UInt32 len, UInt32 lenLimit)
+{
+  for (; len + MF_WORD_SIZE <= lenLimit; len += MF_WORD_SIZE)
+  {
+    CMfWord diff = MF_GET_WORD(pb + len) ^ MF_GET_WORD(cur + len);
+    if (diff != 0)
+      return len + MF_GET_BYTE_POS(diff);
+  }
+  for (; len != lenLimit; len++)
+    if (pb[len] != cur[len])
+      break;
+  return len;
+}
+
+/* the child is prefetched only, if it's in window: else (son + index) is out of array */
+
+#ifdef MF_PREFETCH
+#define MF_PREFETCH_CHILD(curMatch) \
+  { UInt32 d = pos - (curMatch); if (d < _cyclicBufferSize) \
+    MF_PREFETCH(son + ((_cyclicBufferPos - d + ((d > _cyclicBufferPos) ? _cyclicBufferSize : 0)) << 1)); }
+#else
+#define MF_PREFETCH_CHILD(curMatch)
+#endif
+
+static UInt32 * GetMatchesSpec1W(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *cur, CLzRef *son,
+    UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 cutValue,
+    UInt32 *distances, UInt32 maxLen)
+{
+  CLzRef *ptr0 = son + (_cyclicBufferPos << 1) + 1;
+  CLzRef *ptr1 = son + (_cyclicBufferPos << 1);
+  UInt32 len0 = 0, len1 = 0;
+  for (;;)
+  {
+    UInt32 delta = pos - curMatch;
+    if (cutValue-- == 0 || delta >= _cyclicBufferSize)
+    {
+      *ptr0 = *ptr1 = kEmptyHashValue;
+      return distances;
+    }
+    {
+      CLzRef *pair = son + ((_cyclicBufferPos - delta + ((delta > _cyclicBufferPos) ? _cyclicBufferSize : 0)) << 1);
+      const Byte *pb = cur - delta;
+      UInt32 len = (len0 < len1 ? len0 : len1);
+      MF_PREFETCH_CHILD(pair[0])
+      MF_PREFETCH_CHILD(pair[1])
+      if (pb[len] == cur[len])
+      {
+        len = MfGetMatchLen(pb, cur, len + 1, lenLimit);
+        if (maxLen < len)
+        {
+          *distances++ = maxLen = len;
+          *distances++ = delta - 1;
+          if (len == lenLimit)
+          {
+            *ptr1 = pair[0];
+            *ptr0 = pair[1];
+            return distances;
+          }
+        }
+      }
+      if (pb[len] < cur[len])
+      {
+        *ptr1 = curMatch;
+        ptr1 = pair + 1;
+        curMatch = *ptr1;
+        len1 = len;
+      }
+      else
+      {
+        *ptr0 = curMatch;
+        ptr0 = pair;
+        curMatch = *ptr0;
+        len0 = len;
+      }
+    }
+  }
+}
+
+static void SkipMatchesSpecW(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *cur, CLzRef *son,
+    UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 cutValue)
+{
+  CLzRef *ptr0 = son + (_cyclicBufferPos << 1) + 1;
+  CLzRef *ptr1 = son + (_cyclicBufferPos << 1);
+  UInt32 len0 = 0, len1 = 0;
+  for (;;)
+  {
+    UInt32 delta = pos - curMatch;
+    if (cutValue-- == 0 || delta >= _cyclicBufferSize)
+    {
+      *ptr0 = *ptr1 = kEmptyHashValue;
+      return;
+    }
+    {
+      CLzRef *pair = son + ((_cyclicBufferPos - delta + ((delta > _cyclicBufferPos) ? _cyclicBufferSize : 0)) << 1);
+      const Byte *pb = cur - delta;
+      UInt32 len = (len0 < len1 ? len0 : len1);
+      MF_PREFETCH_CHILD(pair[0])
+      MF_PREFETCH_CHILD(pair[1])
+      if (pb[len] == cur[len])
+      {
+        len = MfGetMatchLen(pb, cur, len + 1, lenLimit);
+        if (len == lenLimit)
+        {
+          *ptr1 = pair[0];
+          *ptr0 = pair[1];
+          return;
+        }
+      }
+      if (pb[len] < cur[len])
+      {
+        *ptr1 = curMatch;
+        ptr1 = pair + 1;
+        curMatch = *ptr1;
+        len1 = len;
+      }
+      else
+      {
+        *ptr0 = curMatch;
+        ptr0 = pair;
+        curMatch = *ptr0;
+        len0 = len;
+      }
+    }
+  }
+}
+
+#endif
+
 #define MOVE_POS \
   ++p->cyclicBufferPos; \
   p->buffer++; \
@@ -475,11 +668,11 @@ static void MatchFinder_MovePos(CMatchFinder *p) { MOVE_POS; }
 #define MF_PARAMS(p) p->pos, p->buffer, p->son, p->cyclicBufferPos, p->cyclicBufferSize, p->cutValue
 
 #define GET_MATCHES_FOOTER(offset, maxLen) \
-  offset = (UInt32)(GetMatchesSpec1(lenLimit, curMatch, MF_PARAMS(p), \
+  offset = (UInt32)(p->GetMatchesSpec(lenLimit, curMatch, MF_PARAMS(p), \
   distances + offset, maxLen) - distances); MOVE_POS_RET;
 
 #define SKIP_FOOTER \
-  SkipMatchesSpec(lenLimit, curMatch, MF_PARAMS(p)); MOVE_POS;
+  p->SkipMatchesSpec(lenLimit, curMatch, MF_PARAMS(p)); MOVE_POS;
 
 static UInt32 Bt2_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
 {
@@ -529,7 +722,7 @@ static UInt32 Bt3_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
     offset = 2;
     if (maxLen == lenLimit)
     {
-      SkipMatchesSpec(lenLimit, curMatch, MF_PARAMS(p));
+      p->SkipMatchesSpec(lenLimit, curMatch, MF_PARAMS(p));
       MOVE_POS_RET;
     }
   }
@@ -574,7 +767,7 @@ static UInt32 Bt4_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
     distances[offset - 2] = maxLen;
     if (maxLen == lenLimit)
     {
-      SkipMatchesSpec(lenLimit, curMatch, MF_PARAMS(p));
+      p->SkipMatchesSpec(lenLimit, curMatch, MF_PARAMS(p));
       MOVE_POS_RET;
     }
   }
@@ -632,6 +825,37 @@ static UInt32 Hc4_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
   MOVE_POS_RET
 }
 
+/* Hs4 keeps only the last position for each hash value.
+   It returns one match (at least 4 bytes) or no matches. */
+
+static UInt32 Hs4_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
+{
+  UInt32 delta, maxLen;
+  const Byte *cur2;
+  GET_MATCHES_HEADER(4)
+
+  HASH4_ONLY_CALC;
+
+  curMatch = p->hash[hashValue];
+  p->hash[hashValue] = p->pos;
+
+  delta = p->pos - curMatch;
+  if (delta < p->cyclicBufferSize)
+  {
+    cur2 = cur - (ptrdiff_t)delta;
+    if (cur2[0] == cur[0] && cur2[1] == cur[1] && cur2[2] == cur[2] && cur2[3] == cur[3])
+    {
+      for (maxLen = 4; maxLen != lenLimit && cur2[maxLen] == cur[maxLen]; maxLen++);
+      distances[0] = maxLen;
+      distances[1] = delta - 1;
+      MOVE_POS
+      return 2;
+    }
+  }
+  MOVE_POS
+  return 0;
+}
+
 UInt32 Hc3Zip_MatchFinder_GetMatches(CMatchFinder *p, UInt32 *distances)
 {
   UInt32 offset;
@@ -718,6 +942,25 @@ static void Hc4_MatchFinder_Skip(CMatchFinder *p, UInt32 num)
   while (--num != 0);
 }
 
+static void Hs4_MatchFinder_Skip(CMatchFinder *p, UInt32 num)
+{
+  do
+  {
+    UInt32 hashValue;
+    const Byte *cur;
+    if (p->lenLimit < 4)
+    {
+      MatchFinder_MovePos(p);
+      continue;
+    }
+    cur = p->buffer;
+    HASH4_ONLY_CALC;
+    p->hash[hashValue] = p->pos;
+    MOVE_POS
+  }
+  while (--num != 0);
+}
+
 void Hc3Zip_MatchFinder_Skip(CMatchFinder *p, UInt32 num)
 {
   do
@@ -738,7 +981,21 @@ void MatchFinder_CreateVTable(CMatchFinder *p, IMatchFinder *vTable)
   vTable->GetIndexByte = (Mf_GetIndexByte_Func)MatchFinder_GetIndexByte;
   vTable->GetNumAvailableBytes = (Mf_GetNumAvailableBytes_Func)MatchFinder_GetNumAvailableBytes;
   vTable->GetPointerToCurrentPos = (Mf_GetPointerToCurrentPos_Func)MatchFinder_GetPointerToCurrentPos;
-  if (!p->btMode)
+  p->GetMatchesSpec = GetMatchesSpec1;
+  p->SkipMatchesSpec = SkipMatchesSpec;
+  #ifdef MY_CPU_LE_UNALIGN
+  if (p->wordCompare)
+  {
+    p->GetMatchesSpec = GetMatchesSpec1W;
+    p->SkipMatchesSpec = SkipMatchesSpecW;
+  }
+  #endif
+  if (p->hashOnly)
+  {
+    vTable->GetMatches = (Mf_GetMatches_Func)Hs4_MatchFinder_GetMatches;
+    vTable->Skip = (Mf_Skip_Func)Hs4_MatchFinder_Skip;
+  }
+  else if (!p->btMode)
   {
     vTable->GetMatches = (Mf_GetMatches_Func)Hc4_MatchFinder_GetMatches;
     vTable->Skip = (Mf_Skip_Func)Hc4_MatchFinder_Skip;
@@ -12,6 +12,12 @@ extern "C" {
 
 typedef UInt32 CLzRef;
 
+typedef UInt32 * (*Mf_GetMatchesSpec_Func)(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *buffer, CLzRef *son,
+    UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 _cutValue,
+    UInt32 *distances, UInt32 maxLen);
+typedef void (*Mf_SkipMatchesSpec_Func)(UInt32 lenLimit, UInt32 curMatch, UInt32 pos, const Byte *buffer, CLzRef *son,
+    UInt32 _cyclicBufferPos, UInt32 _cyclicBufferSize, UInt32 _cutValue);
+
 typedef struct _CMatchFinder
 {
   Byte *buffer;
@@ -41,12 +47,16 @@ typedef struct _CMatchFinder
   int directInput;
   size_t directInputRem;
   int btMode;
+  int hashOnly; /* one hash table without chains: Hs4 (single probe) */
+  int wordCompare; /* BT: compare match bytes by words, if CPU supports unaligned access */
   int bigHash;
   UInt32 historySize;
   UInt32 fixedHashSize;
   UInt32 hashSizeSum;
   UInt32 numSons;
   SRes result;
+  Mf_GetMatchesSpec_Func GetMatchesSpec; /* set by MatchFinder_CreateVTable() */
+  Mf_SkipMatchesSpec_Func SkipMatchesSpec;
   UInt32 crc[256];
 } CMatchFinder;
 
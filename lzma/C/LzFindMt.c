@@ -345,7 +345,7 @@ void BtGetMatches(CMatchFinderMt *p, UInt32 *distances)
       while (curPos < limit && size-- != 0)
       {
         UInt32 *startDistances = distances + curPos;
-        UInt32 num = (UInt32)(GetMatchesSpec1(lenLimit, pos - p->hashBuf[p->hashBufPos++],
+        UInt32 num = (UInt32)(p->GetMatchesSpec(lenLimit, pos - p->hashBuf[p->hashBufPos++],
           pos, p->buffer, p->son, cyclicBufferPos, p->cyclicBufferSize, p->cutValue,
           startDistances + 1, p->numHashBytes - 1) - startDistances);
         *startDistances = num - 1;
@@ -454,10 +454,11 @@ void MatchFinderMt_Destruct(CMatchFinderMt *p, ISzAlloc *alloc)
 static unsigned MY_STD_CALL HashThreadFunc2(void *p) { HashThreadFunc((CMatchFinderMt *)p);  return 0; }
 static unsigned MY_STD_CALL BtThreadFunc2(void *p)
 {
-  Byte allocaDummy[0x180];
+  volatile Byte allocaDummy[0x180];
   int i = 0;
   for (i = 0; i < 16; i++)
     allocaDummy[i] = (Byte)i;
+  (void)allocaDummy;
   BtThreadFunc((CMatchFinderMt *)p);
   return 0;
 }
@@ -509,6 +510,7 @@ void MatchFinderMt_Init(CMatchFinderMt *p)
   p->cyclicBufferPos = mf->cyclicBufferPos;
   p->cyclicBufferSize = mf->cyclicBufferSize;
   p->cutValue = mf->cutValue;
+  p->GetMatchesSpec = mf->GetMatchesSpec;
 }
 
 /* ReleaseStream is required to finish multithreading */
@@ -762,6 +764,11 @@ void MatchFinderMt_CreateVTable(CMatchFinderMt *p, IMatchFinder *vTable)
   vTable->GetNumAvailableBytes = (Mf_GetNumAvailableBytes_Func)MatchFinderMt_GetNumAvailableBytes;
   vTable->GetPointerToCurrentPos = (Mf_GetPointerToCurrentPos_Func)MatchFinderMt_GetPointerToCurrentPos;
   vTable->GetMatches = (Mf_GetMatches_Func)MatchFinderMt_GetMatches;
+  {
+    /* it selects GetMatchesSpec of MatchFinder for BT thread */
+    IMatchFinder mfVTable;
+    MatchFinder_CreateVTable(p->MatchFinder, &mfVTable);
+  }
   switch(p->MatchFinder->numHashBytes)
   {
     case 2:
@@ -81,6 +81,7 @@ typedef struct _CMatchFinderMt
   UInt32 cyclicBufferPos;
   UInt32 cyclicBufferSize; /* it must be historySize + 1 */
   UInt32 cutValue;
+  Mf_GetMatchesSpec_Func GetMatchesSpec;
 
   /* BT + Hash */
   CMtSync hashSync;
@@ -25,6 +25,9 @@
   hash3Value = (temp ^ ((UInt32)cur[2] << 8)) & (kHash3Size - 1); \
   hashValue = (temp ^ ((UInt32)cur[2] << 8) ^ (p->crc[cur[3]] << 5)) & p->hashMask; }
 
+#define HASH4_ONLY_CALC \
+  hashValue = (p->crc[cur[0]] ^ cur[1] ^ ((UInt32)cur[2] << 8) ^ (p->crc[cur[3]] << 5)) & p->hashMask;
+
 #define HASH5_CALC { \
   UInt32 temp = p->crc[cur[0]] ^ cur[1]; \
   hash2Value = temp & (kHash2Size - 1); \
@@ -64,6 +64,7 @@ SRes LzmaEnc_MemPrepare(CLzmaEncHandle pp, const Byte *src, SizeT srcLen,
 SRes LzmaEnc_CodeOneMemBlock(CLzmaEncHandle pp, Bool reInit,
     Byte *dest, size_t *destLen, UInt32 desiredPackSize, UInt32 *unpackSize);
 const Byte *LzmaEnc_GetCurBuf(CLzmaEncHandle pp);
+void LzmaEnc_SkipPrefix(CLzmaEncHandle pp, UInt32 prefixSize, UInt64 nowPos);
 void LzmaEnc_Finish(CLzmaEncHandle pp);
 void LzmaEnc_SaveState(CLzmaEncHandle pp);
 void LzmaEnc_RestoreState(CLzmaEncHandle pp);
@@ -171,6 +172,7 @@ void Lzma2EncProps_Init(CLzma2EncProps *p)
   p->numTotalThreads = -1;
   p->numBlockThreads = -1;
   p->blockSize = 0;
+  p->overlapSize = 0;
 }
 
 void Lzma2EncProps_Normalize(CLzma2EncProps *p)
@@ -231,6 +233,11 @@ void Lzma2EncProps_Normalize(CLzma2EncProps *p)
     if (blockSize < dictSize) blockSize = dictSize;
     p->blockSize = (size_t)blockSize;
   }
+
+  if (p->overlapSize > p->lzmaProps.dictSize)
+    p->overlapSize = p->lzmaProps.dictSize;
+  if (p->overlapSize > p->blockSize)
+    p->overlapSize = p->blockSize;
 }
 
 static SRes Progress(ICompressProgress *p, UInt64 inSize, UInt64 outSize)
@@ -307,8 +314,14 @@ typedef struct
   CLzma2Enc *lzma2Enc;
 } CMtCallbackImp;
 
+/*
+  If (overlapSize != 0), all blocks form one LZMA2 stream with one dictionary:
+  the block that starts at (srcPos != 0) doesn't reset dictionary, it resets
+  state and props, and its encoder is primed with (prefixSize) bytes of preceding data.
+*/
+
 static SRes MtCallbackImp_Code(void *pp, unsigned index, Byte *dest, size_t *destSize,
-      const Byte *src, size_t srcSize, int finished)
+      const Byte *src, size_t srcSize, size_t prefixSize, UInt64 srcPos, int finished)
 {
   CMtCallbackImp *imp = (CMtCallbackImp *)pp;
   CLzma2Enc *mainEncoder = imp->lzma2Enc;
@@ -321,12 +334,20 @@ static SRes MtCallbackImp_Code(void *pp, unsigned index, Byte *dest, size_t *des
 
     if (srcSize != 0)
     {
+      UInt64 startPos;
       RINOK(Lzma2EncInt_Init(p, &mainEncoder->props));
      
-      RINOK(LzmaEnc_MemPrepare(p->enc, src, srcSize, LZMA2_KEEP_WINDOW_SIZE,
+      RINOK(LzmaEnc_MemPrepare(p->enc, src - prefixSize, prefixSize + srcSize, LZMA2_KEEP_WINDOW_SIZE,
           mainEncoder->alloc, mainEncoder->allocBig));
+
+      if (mainEncoder->props.overlapSize != 0)
+      {
+        LzmaEnc_SkipPrefix(p->enc, (UInt32)prefixSize, srcPos);
+        p->srcPos = srcPos;
+      }
+      startPos = p->srcPos;
      
-      while (p->srcPos < srcSize)
+      while (p->srcPos - startPos < srcSize)
       {
         size_t packSize = destLim - *destSize;
         res = Lzma2EncInt_EncodeSubblock(p, dest + *destSize, &packSize, NULL);
@@ -340,7 +361,7 @@ static SRes MtCallbackImp_Code(void *pp, unsigned index, Byte *dest, size_t *des
           break;
         }
 
-        if (MtProgress_Set(&mainEncoder->mtCoder.mtProgress, index, p->srcPos, *destSize) != SZ_OK)
+        if (MtProgress_Set(&mainEncoder->mtCoder.mtProgress, index, p->srcPos - startPos, *destSize) != SZ_OK)
         {
           res = SZ_ERROR_PROGRESS;
           break;
@@ -469,6 +490,7 @@ SRes Lzma2Enc_Encode(CLzma2EncHandle pp,
 
     p->mtCoder.blockSize = p->props.blockSize;
     p->mtCoder.destBlockSize = p->props.blockSize + (p->props.blockSize >> 10) + 16;
+    p->mtCoder.overlapSize = p->props.overlapSize;
     p->mtCoder.numThreads = p->props.numBlockThreads;
     
     return MtCoder_Code(&p->mtCoder);
@@ -14,6 +14,10 @@ typedef struct
 {
   CLzmaEncProps lzmaProps;
   size_t blockSize;
+  size_t overlapSize; /* 0 - independent blocks (default),
+                         else blocks continue one dictionary, and each block's encoder
+                         is primed with up to (overlapSize) bytes of preceding data.
+                         It's limited by dictSize and blockSize. */
   int numBlockThreads;
   int numTotalThreads;
 } CLzma2EncProps;
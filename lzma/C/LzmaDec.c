@@ -19,11 +19,42 @@
 #define IF_BIT_0(p) ttt = *(p); NORMALIZE; bound = (range >> kNumBitModelTotalBits) * ttt; if (code < bound)
 #define UPDATE_0(p) range = bound; *(p) = (CLzmaProb)(ttt + ((kBitModelTotal - ttt) >> kNumMoveBits));
 #define UPDATE_1(p) range -= bound; code -= bound; *(p) = (CLzmaProb)(ttt - (ttt >> kNumMoveBits));
+
+/* #define _LZMA_DEC_BRANCHLESS */
+/* _LZMA_DEC_BRANCHLESS decodes the bits of literals, lengths and distances
+   without conditional jumps: the decoded bit is turned into a mask that
+   selects the new range, code and probability. It is faster on x86-64 CPUs,
+   where the compiler emits cmov/setcc for it, since these bits are
+   mispredicted about half of the time. */
+
+#ifdef _LZMA_DEC_BRANCHLESS
+
+#define GET_BIT2_MASK(p, i, m) ttt = *(p); NORMALIZE; bound = (range >> kNumBitModelTotalBits) * ttt; \
+  m = 0 - (UInt32)(code >= bound); \
+  range = bound + ((range - bound - bound) & m); \
+  code -= bound & m; \
+  *(p) = (CLzmaProb)(ttt + (((kBitModelTotal - ttt) >> kNumMoveBits) & ~m) - ((ttt >> kNumMoveBits) & m)); \
+  i = (i + i) + (unsigned)(m & 1);
+#define GET_BIT(p, i) { UInt32 bitMask; GET_BIT2_MASK(p, i, bitMask) }
+
+#define LIT_GET_BIT(probs, i) GET_BIT((probs + i), i)
+
+/* offs drops to 0 at the first bit that differs from matchByte,
+   so the remaining bits are decoded with the plain literal probs */
+#define MATCHED_LIT_GET_BIT(probs, i) \
+  { UInt32 bitMask; unsigned bit; matchByte <<= 1; bit = (matchByte & offs); \
+  GET_BIT2_MASK(probs + offs + bit + i, i, bitMask) \
+  offs &= ~(bit ^ (unsigned)bitMask); }
+
+#else
+
 #define GET_BIT2(p, i, A0, A1) IF_BIT_0(p) \
   { UPDATE_0(p); i = (i + i); A0; } else \
   { UPDATE_1(p); i = (i + i) + 1; A1; }
 #define GET_BIT(p, i) GET_BIT2(p, i, ; , ;)
 
+#endif
+
 #define TREE_GET_BIT(probs, i) { GET_BIT((probs + i), i); }
 #define TREE_DECODE(probs, limit, i) \
   { i = 1; do { TREE_GET_BIT(probs, i); } while (i < limit); i -= limit; }
@@ -171,7 +202,14 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
       {
         state -= (state < 4) ? state : 3;
         symbol = 1;
+        #ifdef _LZMA_DEC_BRANCHLESS
+        LIT_GET_BIT(prob, symbol); LIT_GET_BIT(prob, symbol);
+        LIT_GET_BIT(prob, symbol); LIT_GET_BIT(prob, symbol);
+        LIT_GET_BIT(prob, symbol); LIT_GET_BIT(prob, symbol);
+        LIT_GET_BIT(prob, symbol); LIT_GET_BIT(prob, symbol);
+        #else
         do { GET_BIT(prob + symbol, symbol) } while (symbol < 0x100);
+        #endif
       }
       else
       {
@@ -179,6 +217,12 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
         unsigned offs = 0x100;
         state -= (state < 10) ? 3 : 6;
         symbol = 1;
+        #ifdef _LZMA_DEC_BRANCHLESS
+        MATCHED_LIT_GET_BIT(prob, symbol); MATCHED_LIT_GET_BIT(prob, symbol);
+        MATCHED_LIT_GET_BIT(prob, symbol); MATCHED_LIT_GET_BIT(prob, symbol);
+        MATCHED_LIT_GET_BIT(prob, symbol); MATCHED_LIT_GET_BIT(prob, symbol);
+        MATCHED_LIT_GET_BIT(prob, symbol); MATCHED_LIT_GET_BIT(prob, symbol);
+        #else
         do
         {
           unsigned bit;
@@ -189,6 +233,7 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
           GET_BIT2(probLit, symbol, offs &= ~bit, offs &= bit)
         }
         while (symbol < 0x100);
+        #endif
       }
       dic[dicPos++] = (Byte)symbol;
       processedPos++;
@@ -311,7 +356,13 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
               unsigned i = 1;
               do
               {
+                #ifdef _LZMA_DEC_BRANCHLESS
+                UInt32 bitMask;
+                GET_BIT2_MASK(prob + i, i, bitMask);
+                distance |= mask & bitMask;
+                #else
                 GET_BIT2(prob + i, i, ; , distance |= mask);
+                #endif
                 mask <<= 1;
               }
               while (--numDirectBits != 0);
@@ -346,10 +397,19 @@ static int MY_FAST_CALL LzmaDec_DecodeReal(CLzmaDec *p, SizeT limit, const Byte
             distance <<= kNumAlignBits;
             {
               unsigned i = 1;
+              #ifdef _LZMA_DEC_BRANCHLESS
+              TREE_GET_BIT(prob, i);
+              TREE_GET_BIT(prob, i);
+              TREE_GET_BIT(prob, i);
+              TREE_GET_BIT(prob, i);
+              /* the align bits are coded in reverse order */
+              distance |= ((i & 1) << 3) | ((i & 2) << 1) | ((i & 4) >> 1) | ((i & 8) >> 3);
+              #else
               GET_BIT2(prob + i, i, ; , distance |= 1);
               GET_BIT2(prob + i, i, ; , distance |= 2);
               GET_BIT2(prob + i, i, ; , distance |= 4);
               GET_BIT2(prob + i, i, ; , distance |= 8);
+              #endif
             }
             if (distance == (UInt32)0xFFFFFFFF)
             {
@@ -318,6 +318,7 @@ typedef struct
   unsigned lclp;
 
   Bool fastMode;
+  Bool greedyMode;
   
   CRangeEnc rc;
 
@@ -410,11 +411,14 @@ SRes LzmaEnc_SetProps(CLzmaEncHandle pp, const CLzmaEncProps *props2)
   p->lc = props.lc;
   p->lp = props.lp;
   p->pb = props.pb;
-  p->fastMode = (props.algo == 0);
-  p->matchFinderBase.btMode = props.btMode;
+  p->greedyMode = (props.algo == 2);
+  p->fastMode = (props.algo == 0 || p->greedyMode);
+  /* greedy mode always uses the single-probe Hs4 finder */
+  p->matchFinderBase.btMode = (p->greedyMode ? 0 : props.btMode);
+  p->matchFinderBase.hashOnly = p->greedyMode;
   {
     UInt32 numHashBytes = 4;
-    if (props.btMode)
+    if (p->matchFinderBase.btMode)
     {
       if (props.numHashBytes < 2)
         numHashBytes = 2;
@@ -1594,6 +1598,83 @@ static UInt32 GetOptimumFast(CLzmaEnc *p, UInt32 *backRes)
   return mainLen;
 }
 
+/*
+Greedy parser for algo = 2: the longest of rep / main match at the current
+position is taken without looking ahead and without any prices.
+Positions without a match are collected into one literal run
+(*backRes = -1, return value = number of literals), so the caller codes
+them in one loop. The position that stops the run is already read from
+the match finder, and its matches are kept for the next call.
+*/
+
+static UInt32 GetOptimumGreedy(CLzmaEnc *p, UInt32 *backRes)
+{
+  UInt32 numLits = 0;
+  *backRes = (UInt32)-1;
+  for (;;)
+  {
+    UInt32 numAvail, mainLen, numPairs, repIndex, repLen, i;
+    const Byte *data;
+
+    if (p->additionalOffset == numLits)
+      mainLen = ReadMatchDistances(p, &numPairs);
+    else
+    {
+      mainLen = p->longestMatchLength;
+      numPairs = p->numPairs;
+    }
+
+    numAvail = p->numAvail;
+    if (numAvail < 2)
+      return numLits + 1;
+    if (numAvail > LZMA_MATCH_LEN_MAX)
+      numAvail = LZMA_MATCH_LEN_MAX;
+    data = p->matchFinder.GetPointerToCurrentPos(p->matchFinderObj) - 1;
+
+    repLen = repIndex = 0;
+    for (i = 0; i < LZMA_NUM_REPS; i++)
+    {
+      UInt32 len;
+      const Byte *data2 = data - (p->reps[i] + 1);
+      if (data[0] != data2[0] || data[1] != data2[1])
+        continue;
+      for (len = 2; len < numAvail && data[len] == data2[len]; len++);
+      if (len > repLen)
+      {
+        repIndex = i;
+        repLen = len;
+      }
+    }
+
+    if (mainLen == 2 && p->matches[numPairs - 1] >= 0x80)
+      mainLen = 1;
+    else if (mainLen == 4 && p->matches[numPairs - 1] >= (1 << 14))
+      mainLen = 1;
+
+    if (repLen >= 2 || mainLen >= 2)
+    {
+      if (numLits != 0)
+      {
+        p->longestMatchLength = mainLen;
+        p->numPairs = numPairs;
+        return numLits;
+      }
+      if (repLen + 1 >= mainLen)
+      {
+        *backRes = repIndex;
+        MovePos(p, repLen - 1);
+        return repLen;
+      }
+      *backRes = p->matches[numPairs - 1] + LZMA_NUM_REPS;
+      MovePos(p, mainLen - 1);
+      return mainLen;
+    }
+
+    if (++numLits == LZMA_MATCH_LEN_MAX)
+      return numLits;
+  }
+}
+
 static void WriteEndMarker(CLzmaEnc *p, UInt32 posState)
 {
   UInt32 len;
@@ -1766,7 +1847,9 @@ static SRes LzmaEnc_CodeOneBlock(CLzmaEnc *p, Bool useLimits, UInt32 maxPackSize
   {
     UInt32 pos, len, posState;
 
-    if (p->fastMode)
+    if (p->greedyMode)
+      len = GetOptimumGreedy(p, &pos);
+    else if (p->fastMode)
       len = GetOptimumFast(p, &pos);
     else
       len = GetOptimum(p, nowPos32, &pos);
@@ -1776,21 +1859,24 @@ static SRes LzmaEnc_CodeOneBlock(CLzmaEnc *p, Bool useLimits, UInt32 maxPackSize
     #endif
 
     posState = nowPos32 & p->pbMask;
-    if (len == 1 && pos == (UInt32)-1)
+    if (pos == (UInt32)-1)
     {
-      Byte curByte;
-      CLzmaProb *probs;
-      const Byte *data;
-
-      RangeEnc_EncodeBit(&p->rc, &p->isMatch[p->state][posState], 0);
-      data = p->matchFinder.GetPointerToCurrentPos(p->matchFinderObj) - p->additionalOffset;
-      curByte = *data;
-      probs = LIT_PROBS(nowPos32, *(data - 1));
-      if (IsCharState(p->state))
-        LitEnc_Encode(&p->rc, probs, curByte);
-      else
-        LitEnc_EncodeMatched(&p->rc, probs, curByte, *(data - p->reps[0] - 1));
-      p->state = kLiteralNextStates[p->state];
+      /* (len) literals. Only GetOptimumGreedy() returns (len > 1) */
+      const Byte *data = p->matchFinder.GetPointerToCurrentPos(p->matchFinderObj) - p->additionalOffset;
+      UInt32 i = 0;
+      do
+      {
+        CLzmaProb *probs;
+        posState = (nowPos32 + i) & p->pbMask;
+        RangeEnc_EncodeBit(&p->rc, &p->isMatch[p->state][posState], 0);
+        probs = LIT_PROBS(nowPos32 + i, data[(ptrdiff_t)i - 1]);
+        if (IsCharState(p->state))
+          LitEnc_Encode(&p->rc, probs, data[i]);
+        else
+          LitEnc_EncodeMatched(&p->rc, probs, data[i], data[(ptrdiff_t)i - (ptrdiff_t)p->reps[0] - 1]);
+        p->state = kLiteralNextStates[p->state];
+      }
+      while (++i != len);
     }
     else
     {
@@ -2004,15 +2090,16 @@ void LzmaEnc_Init(CLzmaEnc *p)
 
 void LzmaEnc_InitPrices(CLzmaEnc *p)
 {
-  if (!p->fastMode)
-  {
-    FillDistancesPrices(p);
-    FillAlignPrices(p);
-  }
-
   p->lenEnc.tableSize =
   p->repLenEnc.tableSize =
       p->numFastBytes + 1 - LZMA_MATCH_LEN_MIN;
+
+  /* fast modes don't use prices */
+  if (p->fastMode)
+    return;
+
+  FillDistancesPrices(p);
+  FillAlignPrices(p);
   LenPriceEnc_UpdateTables(&p->lenEnc, 1 << p->pb, p->ProbPrices);
   LenPriceEnc_UpdateTables(&p->repLenEnc, 1 << p->pb, p->ProbPrices);
 }
@@ -2071,6 +2158,21 @@ SRes LzmaEnc_MemPrepare(CLzmaEncHandle pp, const Byte *src, SizeT srcLen,
   return LzmaEnc_AllocAndInit(p, keepWindowSize, alloc, allocBig);
 }
 
+/* Moves the match finder over the first (prefixSize) bytes of input without coding them,
+   so later matches can refer to them. (nowPos) is the stream position of the first coded byte. */
+void LzmaEnc_SkipPrefix(CLzmaEncHandle pp, UInt32 prefixSize, UInt64 nowPos)
+{
+  CLzmaEnc *p = (CLzmaEnc *)pp;
+  if (p->needInit)
+  {
+    p->matchFinder.Init(p->matchFinderObj);
+    p->needInit = 0;
+  }
+  if (prefixSize != 0)
+    p->matchFinder.Skip(p->matchFinderObj, prefixSize);
+  p->nowPos64 = nowPos;
+}
+
 void LzmaEnc_Finish(CLzmaEncHandle pp)
 {
   #ifndef _7ZIP_ST
@@ -2156,10 +2258,11 @@ static SRes LzmaEnc_Encode2(CLzmaEnc *p, ICompressProgress *progress)
   SRes res = SZ_OK;
 
   #ifndef _7ZIP_ST
-  Byte allocaDummy[0x300];
+  volatile Byte allocaDummy[0x300];
   int i = 0;
   for (i = 0; i < 16; i++)
     allocaDummy[i] = (Byte)i;
+  (void)allocaDummy;
   #endif
 
   for (;;)
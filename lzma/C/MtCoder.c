@@ -2,6 +2,7 @@
 2010-09-24 : Igor Pavlov : Public domain */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "MtCoder.h"
 
@@ -153,7 +154,7 @@ static void CMtThread_Destruct(CMtThread *p)
 
 static SRes CMtThread_Prepare(CMtThread *p)
 {
-  MY_BUF_ALLOC(p->inBuf, p->inBufSize, p->mtCoder->blockSize)
+  MY_BUF_ALLOC(p->inBuf, p->inBufSize, p->mtCoder->overlapSize + p->mtCoder->blockSize)
   MY_BUF_ALLOC(p->outBuf, p->outBufSize, p->mtCoder->destBlockSize)
 
   p->stopReading = False;
@@ -183,6 +184,7 @@ static SRes FullRead(ISeqInStream *stream, Byte *data, size_t *processedSize)
 }
 
 #define GET_NEXT_THREAD(p) &p->mtCoder->threads[p->index == p->mtCoder->numThreads  - 1 ? 0 : p->index + 1]
+#define GET_PREV_THREAD(p) &p->mtCoder->threads[p->index == 0 ? p->mtCoder->numThreads - 1 : p->index - 1]
 
 static SRes MtThread_Process(CMtThread *p, Bool *stop)
 {
@@ -202,14 +204,26 @@ static SRes MtThread_Process(CMtThread *p, Bool *stop)
   {
     size_t size = p->mtCoder->blockSize;
     size_t destSize = p->outBufSize;
+    size_t overlapSize = p->mtCoder->overlapSize;
+    size_t prefixSize = 0;
+    UInt64 srcPos = p->mtCoder->inPos;
 
-    RINOK(FullRead(p->mtCoder->inStream, p->inBuf, &size));
+    /* previous block was full, and its buffer is not reused until we pass canRead on */
+    if (overlapSize != 0 && srcPos != 0)
+    {
+      const CMtThread *prev = GET_PREV_THREAD(p);
+      memcpy(p->inBuf, prev->inBuf + p->mtCoder->blockSize, overlapSize);
+      prefixSize = overlapSize;
+    }
+
+    RINOK(FullRead(p->mtCoder->inStream, p->inBuf + overlapSize, &size));
+    p->mtCoder->inPos += size;
     next->stopReading = *stop = (size != p->mtCoder->blockSize);
     if (Event_Set(&next->canRead) != 0)
       return SZ_ERROR_THREAD;
 
     RINOK(p->mtCoder->mtCallback->Code(p->mtCoder->mtCallback, p->index,
-        p->outBuf, &destSize, p->inBuf, size, *stop));
+        p->outBuf, &destSize, p->inBuf + overlapSize, size, prefixSize, srcPos, *stop));
 
     MtProgress_Reinit(&p->mtCoder->mtProgress, p->index);
 
@@ -250,6 +264,7 @@ void MtCoder_Construct(CMtCoder* p)
 {
   unsigned i;
   p->alloc = 0;
+  p->overlapSize = 0;
   for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
   {
     CMtThread *t = &p->threads[i];
@@ -274,6 +289,7 @@ SRes MtCoder_Code(CMtCoder *p)
   unsigned i, numThreads = p->numThreads;
   SRes res = SZ_OK;
   p->res = SZ_OK;
+  p->inPos = 0;
 
   MtProgress_Init(&p->mtProgress, p->progress);
 
@@ -64,17 +64,24 @@ typedef struct
   CAutoResetEvent canWrite;
 } CMtThread;
 
+/* Code callback:
+     src[0 .. srcSize) is the block to code, which starts at offset srcPos in the stream.
+     src[-(ptrdiff_t)prefixSize .. 0) is the input preceding the block,
+     prefixSize is 0 for first block or if overlapSize is 0. */
+
 typedef struct
 {
   SRes (*Code)(void *p, unsigned index, Byte *dest, size_t *destSize,
-      const Byte *src, size_t srcSize, int finished);
+      const Byte *src, size_t srcSize, size_t prefixSize, UInt64 srcPos, int finished);
 } IMtCoderCallback;
 
 typedef struct _CMtCoder
 {
   size_t blockSize;
   size_t destBlockSize;
+  size_t overlapSize; /* (overlapSize <= blockSize) : bytes of previous block passed before each block */
   unsigned numThreads;
+  UInt64 inPos;
   
   ISeqInStream *inStream;
   ISeqOutStream *outStream;
@@ -60,6 +60,7 @@ void Ppmd7_Construct(CPpmd7 *p)
   unsigned i, k, m;
 
   p->Base = 0;
+  p->AllocSize = 0;
 
   for (i = 0, k = 0; i < PPMD_NUM_INDEXES; i++)
   {
@@ -90,6 +91,7 @@ void Ppmd7_Free(CPpmd7 *p, ISzAlloc *alloc)
 {
   alloc->Free(alloc, p->Base);
   p->Size = 0;
+  p->AllocSize = 0;
   p->Base = 0;
 }
 
@@ -97,24 +99,97 @@ Bool Ppmd7_Alloc(CPpmd7 *p, UInt32 size, ISzAlloc *alloc)
 {
   if (p->Base == 0 || p->Size != size)
   {
-    Ppmd7_Free(p, alloc);
-    p->AlignOffset =
+    UInt32 alignOffset =
       #ifdef PPMD_32BIT
         (4 - size) & 3;
       #else
         4 - (size & 3);
       #endif
-    if ((p->Base = (Byte *)alloc->Alloc(alloc, p->AlignOffset + size
+    UInt32 allocSize = alignOffset + size
         #ifndef PPMD_32BIT
         + UNIT_SIZE
         #endif
-        )) == 0)
-      return False;
+        ;
+    if (p->Base == 0 || p->AllocSize < allocSize)
+    {
+      Ppmd7_Free(p, alloc);
+      if ((p->Base = (Byte *)alloc->Alloc(alloc, allocSize)) == 0)
+        return False;
+      p->AllocSize = allocSize;
+    }
+    p->AlignOffset = alignOffset;
     p->Size = size;
   }
   return True;
 }
 
+static void *MemPool_Alloc(void *pp, size_t size)
+{
+  CPpmd7_MemPool *p = (CPpmd7_MemPool *)pp;
+  unsigned i, best = PPMD7_POOL_NUM_BLOCKS, unused = PPMD7_POOL_NUM_BLOCKS;
+  void *address;
+  for (i = 0; i < p->NumBlocks; i++)
+    if (!p->Used[i])
+    {
+      if (p->Sizes[i] >= size && (best == PPMD7_POOL_NUM_BLOCKS || p->Sizes[i] < p->Sizes[best]))
+        best = i;
+      unused = i;
+    }
+  if (best != PPMD7_POOL_NUM_BLOCKS)
+  {
+    p->Used[best] = True;
+    return p->Blocks[best];
+  }
+  address = p->Alloc->Alloc(p->Alloc, size);
+  if (address == 0)
+    return 0;
+  if (unused != PPMD7_POOL_NUM_BLOCKS)
+  {
+    /* all unused blocks are too small: replace one of them */
+    p->Alloc->Free(p->Alloc, p->Blocks[unused]);
+    i = unused;
+  }
+  else if (p->NumBlocks != PPMD7_POOL_NUM_BLOCKS)
+    i = p->NumBlocks++;
+  else
+    return address;
+  p->Blocks[i] = address;
+  p->Sizes[i] = size;
+  p->Used[i] = True;
+  return address;
+}
+
+static void MemPool_Free(void *pp, void *address)
+{
+  CPpmd7_MemPool *p = (CPpmd7_MemPool *)pp;
+  unsigned i;
+  if (address == 0)
+    return;
+  for (i = 0; i < p->NumBlocks; i++)
+    if (p->Blocks[i] == address)
+    {
+      p->Used[i] = False;
+      return;
+    }
+  p->Alloc->Free(p->Alloc, address);
+}
+
+void Ppmd7_MemPool_Construct(CPpmd7_MemPool *p, ISzAlloc *alloc)
+{
+  p->p.Alloc = MemPool_Alloc;
+  p->p.Free = MemPool_Free;
+  p->Alloc = alloc;
+  p->NumBlocks = 0;
+}
+
+void Ppmd7_MemPool_Free(CPpmd7_MemPool *p)
+{
+  unsigned i;
+  for (i = 0; i < p->NumBlocks; i++)
+    p->Alloc->Free(p->Alloc, p->Blocks[i]);
+  p->NumBlocks = 0;
+}
+
 static void InsertNode(CPpmd7 *p, void *node, unsigned indx)
 {
   *((CPpmd_Void_Ref *)node) = p->FreeList[indx];
@@ -338,6 +413,14 @@ void Ppmd7_Init(CPpmd7 *p, unsigned maxOrder)
   p->DummySee.Count = 64; /* unused */
 }
 
+Bool Ppmd7_Reset(CPpmd7 *p, UInt32 size, unsigned maxOrder, ISzAlloc *alloc)
+{
+  if (!Ppmd7_Alloc(p, size, alloc))
+    return False;
+  Ppmd7_Init(p, maxOrder);
+  return True;
+}
+
 static CTX_PTR CreateSuccessors(CPpmd7 *p, Bool skip)
 {
   CPpmd_State upState;
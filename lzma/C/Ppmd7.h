@@ -47,6 +47,7 @@ typedef struct
   Int32 RunLength, InitRL; /* must be 32-bit at least */
 
   UInt32 Size;
+  UInt32 AllocSize; /* size of the block at Base. It can be larger than the block for (Size) */
   UInt32 GlueCount;
   Byte *Base, *LoUnit, *HiUnit, *Text, *UnitsStart;
   UInt32 AlignOffset;
@@ -60,12 +61,50 @@ typedef struct
 } CPpmd7;
 
 void Ppmd7_Construct(CPpmd7 *p);
+
+/* Ppmd7_Alloc keeps the current block, if it's large enough for new (size). */
 Bool Ppmd7_Alloc(CPpmd7 *p, UInt32 size, ISzAlloc *alloc);
 void Ppmd7_Free(CPpmd7 *p, ISzAlloc *alloc);
 void Ppmd7_Init(CPpmd7 *p, unsigned maxOrder);
+
+/* Ppmd7_Reset prepares CPpmd7 for new stream. Use it instead of new CPpmd7
+   for each stream: the tables of Ppmd7_Construct() and the block are reused,
+   (alloc) is called only if the block is smaller than (size), and only
+   the model is reset (the block is not cleared).
+   It returns False, if allocation fails. */
+Bool Ppmd7_Reset(CPpmd7 *p, UInt32 size, unsigned maxOrder, ISzAlloc *alloc);
 #define Ppmd7_WasAllocated(p) ((p)->Base != NULL)
 
 
+/* ---------- Model Memory Pool ---------- */
+
+/* CPpmd7_MemPool is ISzAlloc that keeps the blocks released by Free() and
+   returns them for next Alloc() calls of same or smaller size. Pass (&pool.p)
+   to Ppmd7_Alloc / Ppmd7_Free, if you create new CPpmd7 for each stream:
+   the model memory is allocated (and its pages are faulted in) only once.
+   The pool keeps up to PPMD7_POOL_NUM_BLOCKS blocks. Other blocks are passed to (Alloc).
+   Use it only for the model memory: it's not a general allocator, since it keeps
+   the blocks until Ppmd7_MemPool_Free() and it can return a large block for small request.
+   CPpmd7_MemPool is NOT thread-safe (it has no locks): each thread must use its own pool. */
+
+#define PPMD7_POOL_NUM_BLOCKS 4
+
+typedef struct
+{
+  ISzAlloc p;
+  ISzAlloc *Alloc;
+  unsigned NumBlocks;
+  void *Blocks[PPMD7_POOL_NUM_BLOCKS];
+  size_t Sizes[PPMD7_POOL_NUM_BLOCKS];
+  Bool Used[PPMD7_POOL_NUM_BLOCKS];
+} CPpmd7_MemPool;
+
+void Ppmd7_MemPool_Construct(CPpmd7_MemPool *p, ISzAlloc *alloc);
+
+/* Ppmd7_MemPool_Free releases all blocks. Call it after Free() for all blocks */
+void Ppmd7_MemPool_Free(CPpmd7_MemPool *p);
+
+
 /* ---------- Internal Functions ---------- */
 
 extern const Byte PPMD7_kExpEscape[16];
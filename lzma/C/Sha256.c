@@ -2,14 +2,25 @@
 2010-06-11 : Igor Pavlov : Public domain
 This code is based on public domain code from Wei Dai's Crypto++ library. */
 
+#include <string.h>
+
+#include "CpuArch.h"
 #include "RotateDefs.h"
 #include "Sha256.h"
 
+#if defined(MY_CPU_X86_OR_AMD64) && ( \
+    (defined(__GNUC__) && (__GNUC__ >= 5) && !defined(__clang__)) || \
+    (defined(__clang__) && (__clang_major__ >= 4)) || \
+    (defined(_MSC_VER) && (_MSC_VER >= 1900)))
+#define USE_HW_SHA
+#define USE_AVX2_SHA
+#endif
+
 /* define it for speed optimization */
 /* #define _SHA256_UNROLL */
 /* #define _SHA256_UNROLL2 */
 
-void Sha256_Init(CSha256 *p)
+static void Sha256_InitState(CSha256 *p)
 {
   p->state[0] = 0x6a09e667;
   p->state[1] = 0xbb67ae85;
@@ -144,54 +155,276 @@ static void Sha256_Transform(UInt32 *state, const UInt32 *data)
 #undef s0
 #undef s1
 
-static void Sha256_WriteByteBlock(CSha256 *p)
+static void MY_FAST_CALL Sha256_UpdateBlocks(UInt32 state[8], const Byte *data, size_t numBlocks)
 {
   UInt32 data32[16];
+  for (; numBlocks != 0; numBlocks--, data += 64)
+  {
+    unsigned i;
+    for (i = 0; i < 16; i++)
+      data32[i] = GetBe32(data + i * 4);
+    Sha256_Transform(state, data32);
+  }
+}
+
+#if defined(USE_HW_SHA) || defined(USE_AVX2_SHA)
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ATTRIB_SHA __attribute__((__target__("sha,ssse3,sse4.1")))
+#define ATTRIB_AVX2 __attribute__((__target__("avx2")))
+#else
+#define ATTRIB_SHA
+#define ATTRIB_AVX2
+#endif
+
+#endif
+
+#ifdef USE_HW_SHA
+
+/* x86 SHA extensions: sha256rnds2 needs the state as ABEF and CDGH words */
+
+#define SHA_LOAD_K(k) _mm_loadu_si128((const __m128i *)(const void *)(K + (k) * 4))
+#define SHA_LOAD_W(m, k) m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(const void *)(data + (k) * 16)), mask);
+
+#define SM1(mp, mc) mp = _mm_sha256msg1_epu32(mp, mc);
+#define SM2(mn, mc, mp) mn = _mm_sha256msg2_epu32(_mm_add_epi32(mn, _mm_alignr_epi8(mc, mp, 4)), mc);
+#define SM_NONE
+
+#define SHA_R4(k, m, op2, op1) \
+  msg = _mm_add_epi32(m, SHA_LOAD_K(k)); \
+  state1 = _mm_sha256rnds2_epu32(state1, state0, msg); \
+  op2 \
+  msg = _mm_shuffle_epi32(msg, 0x0E); \
+  state0 = _mm_sha256rnds2_epu32(state0, state1, msg); \
+  op1
+
+static void MY_FAST_CALL ATTRIB_SHA Sha256_UpdateBlocks_HW(UInt32 state[8], const Byte *data, size_t numBlocks)
+{
+  const __m128i mask = _mm_set_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203);
+  __m128i state0, state1, tmp;
+
+  if (numBlocks == 0)
+    return;
+
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(const void *)&state[0]), 0xB1); /* CDAB */
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)(const void *)&state[4]), 0x1B); /* EFGH */
+  state0 = _mm_alignr_epi8(tmp, state1, 8); /* ABEF */
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0); /* CDGH */
+
+  for (; numBlocks != 0; numBlocks--, data += 64)
+  {
+    const __m128i save0 = state0;
+    const __m128i save1 = state1;
+    __m128i m0, m1, m2, m3, msg;
+
+    SHA_LOAD_W(m0, 0)
+    SHA_LOAD_W(m1, 1)
+    SHA_LOAD_W(m2, 2)
+    SHA_LOAD_W(m3, 3)
+
+    SHA_R4( 0, m0, SM_NONE, SM_NONE)
+    SHA_R4( 1, m1, SM_NONE, SM1(m0, m1))
+    SHA_R4( 2, m2, SM_NONE, SM1(m1, m2))
+    SHA_R4( 3, m3, SM2(m0, m3, m2), SM1(m2, m3))
+    SHA_R4( 4, m0, SM2(m1, m0, m3), SM1(m3, m0))
+    SHA_R4( 5, m1, SM2(m2, m1, m0), SM1(m0, m1))
+    SHA_R4( 6, m2, SM2(m3, m2, m1), SM1(m1, m2))
+    SHA_R4( 7, m3, SM2(m0, m3, m2), SM1(m2, m3))
+    SHA_R4( 8, m0, SM2(m1, m0, m3), SM1(m3, m0))
+    SHA_R4( 9, m1, SM2(m2, m1, m0), SM1(m0, m1))
+    SHA_R4(10, m2, SM2(m3, m2, m1), SM1(m1, m2))
+    SHA_R4(11, m3, SM2(m0, m3, m2), SM1(m2, m3))
+    SHA_R4(12, m0, SM2(m1, m0, m3), SM1(m3, m0))
+    SHA_R4(13, m1, SM2(m2, m1, m0), SM_NONE)
+    SHA_R4(14, m2, SM2(m3, m2, m1), SM_NONE)
+    SHA_R4(15, m3, SM_NONE, SM_NONE)
+
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B); /* FEBA */
+  state1 = _mm_shuffle_epi32(state1, 0xB1); /* DCHG */
+  _mm_storeu_si128((__m128i *)(void *)&state[0], _mm_blend_epi16(tmp, state1, 0xF0)); /* DCBA */
+  _mm_storeu_si128((__m128i *)(void *)&state[4], _mm_alignr_epi8(state1, tmp, 8)); /* HGFE */
+}
+
+#endif
+
+#ifdef USE_AVX2_SHA
+
+/* AVX2 multi-buffer code: lane i of each vector belongs to the stream data[i] */
+
+#define V8_ADD(x, y) _mm256_add_epi32(x, y)
+#define V8_XOR3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define V8_ROR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+#define V8_S0(x) V8_XOR3(V8_ROR(x, 2), V8_ROR(x, 13), V8_ROR(x, 22))
+#define V8_S1(x) V8_XOR3(V8_ROR(x, 6), V8_ROR(x, 11), V8_ROR(x, 25))
+#define V8_s0(x) V8_XOR3(V8_ROR(x, 7), V8_ROR(x, 18), _mm256_srli_epi32(x, 3))
+#define V8_s1(x) V8_XOR3(V8_ROR(x, 17), V8_ROR(x, 19), _mm256_srli_epi32(x, 10))
+
+#define V8_Ch(x, y, z) _mm256_xor_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+#define V8_Maj(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+
+#define V8_LOAD_W(t) _mm256_shuffle_epi8(_mm256_set_epi32( \
+    (int)GetUi32(data[7] + pos + (t) * 4), (int)GetUi32(data[6] + pos + (t) * 4), \
+    (int)GetUi32(data[5] + pos + (t) * 4), (int)GetUi32(data[4] + pos + (t) * 4), \
+    (int)GetUi32(data[3] + pos + (t) * 4), (int)GetUi32(data[2] + pos + (t) * 4), \
+    (int)GetUi32(data[1] + pos + (t) * 4), (int)GetUi32(data[0] + pos + (t) * 4)), mask)
+
+#define V8_ROUND(t) \
+  t1 = V8_ADD(V8_ADD(V8_ADD(vh, V8_S1(ve)), V8_ADD(V8_Ch(ve, vf, vg), _mm256_set1_epi32((int)K[t]))), W[(t) & 15]); \
+  t2 = V8_ADD(V8_S0(va), V8_Maj(va, vb, vc)); \
+  vh = vg; vg = vf; vf = ve; ve = V8_ADD(vd, t1); \
+  vd = vc; vc = vb; vb = va; va = V8_ADD(t1, t2);
+
+static void ATTRIB_AVX2 Sha256_UpdateBlocks_Avx2(UInt32 * const *states, const Byte * const *data, size_t numBlocks)
+{
+  const __m256i mask = _mm256_set_epi32(
+      0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203,
+      0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203);
+  __m256i v[8];
+  __m256i W[16];
+  size_t pos;
   unsigned i;
-  for (i = 0; i < 16; i++)
-    data32[i] =
-      ((UInt32)(p->buffer[i * 4    ]) << 24) +
-      ((UInt32)(p->buffer[i * 4 + 1]) << 16) +
-      ((UInt32)(p->buffer[i * 4 + 2]) <<  8) +
-      ((UInt32)(p->buffer[i * 4 + 3]));
-  Sha256_Transform(p->state, data32);
+
+  for (i = 0; i < 8; i++)
+    v[i] = _mm256_set_epi32(
+        (int)states[7][i], (int)states[6][i], (int)states[5][i], (int)states[4][i],
+        (int)states[3][i], (int)states[2][i], (int)states[1][i], (int)states[0][i]);
+
+  for (pos = 0; numBlocks != 0; numBlocks--, pos += 64)
+  {
+    __m256i va = v[0], vb = v[1], vc = v[2], vd = v[3];
+    __m256i ve = v[4], vf = v[5], vg = v[6], vh = v[7];
+    __m256i t1, t2;
+    unsigned t;
+    for (t = 0; t < 16; t++)
+    {
+      W[t] = V8_LOAD_W(t);
+      V8_ROUND(t)
+    }
+    for (; t < 64; t++)
+    {
+      W[t & 15] = V8_ADD(V8_ADD(W[t & 15], V8_s0(W[(t - 15) & 15])),
+          V8_ADD(W[(t - 7) & 15], V8_s1(W[(t - 2) & 15])));
+      V8_ROUND(t)
+    }
+    v[0] = V8_ADD(v[0], va); v[1] = V8_ADD(v[1], vb);
+    v[2] = V8_ADD(v[2], vc); v[3] = V8_ADD(v[3], vd);
+    v[4] = V8_ADD(v[4], ve); v[5] = V8_ADD(v[5], vf);
+    v[6] = V8_ADD(v[6], vg); v[7] = V8_ADD(v[7], vh);
+  }
+
+  for (i = 0; i < 8; i++)
+  {
+    UInt32 temp[8];
+    unsigned j;
+    _mm256_storeu_si256((__m256i *)(void *)temp, v[i]);
+    for (j = 0; j < 8; j++)
+      states[j][i] = temp[j];
+  }
+}
+
+#endif
+
+static SHA256_FUNC_UPDATE_BLOCKS g_FUNC_UPDATE_BLOCKS = Sha256_UpdateBlocks;
+static SHA256_FUNC_UPDATE_BLOCKS g_FUNC_UPDATE_BLOCKS_HW;
+static unsigned g_Sha256_NumLanes = 1;
+
+void Sha256Prepare(void)
+{
+  SHA256_FUNC_UPDATE_BLOCKS f = Sha256_UpdateBlocks;
+  SHA256_FUNC_UPDATE_BLOCKS f_hw = NULL;
+  unsigned numLanes = 1;
+  #ifdef USE_HW_SHA
+  if (CPU_Is_Sha_Supported())
+    f = f_hw = Sha256_UpdateBlocks_HW;
+  #endif
+  #ifdef USE_AVX2_SHA
+  if (CPU_Is_Avx2_Supported())
+    numLanes = SHA256_NUM_LANES_MAX;
+  #endif
+  g_FUNC_UPDATE_BLOCKS = f;
+  g_FUNC_UPDATE_BLOCKS_HW = f_hw;
+  g_Sha256_NumLanes = numLanes;
+}
+
+void Sha256_Init(CSha256 *p)
+{
+  p->func_UpdateBlocks = g_FUNC_UPDATE_BLOCKS;
+  Sha256_InitState(p);
+}
+
+Bool Sha256_SetFunction(CSha256 *p, unsigned algo)
+{
+  SHA256_FUNC_UPDATE_BLOCKS func = g_FUNC_UPDATE_BLOCKS;
+  if (algo == SHA256_ALGO_SW)
+    func = Sha256_UpdateBlocks;
+  else if (algo == SHA256_ALGO_HW)
+    func = g_FUNC_UPDATE_BLOCKS_HW;
+  else if (algo != SHA256_ALGO_DEFAULT)
+    func = NULL;
+  if (!func)
+    return False;
+  p->func_UpdateBlocks = func;
+  return True;
 }
 
 void Sha256_Update(CSha256 *p, const Byte *data, size_t size)
 {
-  UInt32 curBufferPos = (UInt32)p->count & 0x3F;
-  while (size > 0)
+  unsigned pos;
+  size_t numBlocks;
+  if (size == 0)
+    return;
+  pos = (unsigned)p->count & 0x3F;
+  p->count += size;
+  if (pos != 0)
   {
-    p->buffer[curBufferPos++] = *data++;
-    p->count++;
-    size--;
-    if (curBufferPos == 64)
+    unsigned rem = 64 - pos;
+    if (size < rem)
     {
-      curBufferPos = 0;
-      Sha256_WriteByteBlock(p);
+      memcpy(p->buffer + pos, data, size);
+      return;
     }
+    memcpy(p->buffer + pos, data, rem);
+    data += rem;
+    size -= rem;
+    p->func_UpdateBlocks(p->state, p->buffer, 1);
   }
+  numBlocks = size >> 6;
+  if (numBlocks != 0)
+  {
+    p->func_UpdateBlocks(p->state, data, numBlocks);
+    data += numBlocks << 6;
+    size &= 0x3F;
+  }
+  if (size != 0)
+    memcpy(p->buffer, data, size);
 }
 
 void Sha256_Final(CSha256 *p, Byte *digest)
 {
   UInt64 lenInBits = (p->count << 3);
-  UInt32 curBufferPos = (UInt32)p->count & 0x3F;
+  unsigned pos = (unsigned)p->count & 0x3F;
   unsigned i;
-  p->buffer[curBufferPos++] = 0x80;
-  while (curBufferPos != (64 - 8))
+  p->buffer[pos++] = 0x80;
+  if (pos > 64 - 8)
   {
-    curBufferPos &= 0x3F;
-    if (curBufferPos == 0)
-      Sha256_WriteByteBlock(p);
-    p->buffer[curBufferPos++] = 0;
+    memset(p->buffer + pos, 0, 64 - pos);
+    p->func_UpdateBlocks(p->state, p->buffer, 1);
+    pos = 0;
   }
+  memset(p->buffer + pos, 0, 64 - 8 - pos);
   for (i = 0; i < 8; i++)
   {
-    p->buffer[curBufferPos++] = (Byte)(lenInBits >> 56);
-    lenInBits <<= 8;
+    p->buffer[64 - 1 - i] = (Byte)lenInBits;
+    lenInBits >>= 8;
   }
-  Sha256_WriteByteBlock(p);
+  p->func_UpdateBlocks(p->state, p->buffer, 1);
 
   for (i = 0; i < 8; i++)
   {
@@ -200,5 +433,106 @@ void Sha256_Final(CSha256 *p, Byte *digest)
     *digest++ = (Byte)(p->state[i] >> 8);
     *digest++ = (Byte)(p->state[i]);
   }
-  Sha256_Init(p);
+  Sha256_InitState(p);
+}
+
+unsigned Sha256_GetNumLanes(void)
+{
+  return g_Sha256_NumLanes;
+}
+
+#ifdef USE_AVX2_SHA
+
+/* (n) hashes that use Sha256_UpdateBlocks get (size) bytes each.
+   The buffered bytes and the tails are processed by Sha256_Update(),
+   the blocks that all streams have in common are processed by AVX2 code. */
+
+static void Sha256_UpdateLanes(CSha256 * const *lanes, const Byte * const *data, size_t size, unsigned n)
+{
+  UInt32 *states[SHA256_NUM_LANES_MAX];
+  const Byte *blocks[SHA256_NUM_LANES_MAX];
+  size_t offsets[SHA256_NUM_LANES_MAX];
+  UInt32 dummyState[8];
+  size_t numBlocks = size >> 6;
+  unsigned i;
+
+  if (n < 2)
+  {
+    if (n != 0)
+      Sha256_Update(lanes[0], data[0], size);
+    return;
+  }
+
+  for (i = 0; i < n; i++)
+  {
+    CSha256 *p = lanes[i];
+    size_t rem = (64 - ((unsigned)p->count & 0x3F)) & 0x3F;
+    if (rem > size)
+      rem = size;
+    Sha256_Update(p, data[i], rem);
+    offsets[i] = rem;
+    if (numBlocks > ((size - rem) >> 6))
+      numBlocks = (size - rem) >> 6;
+  }
+
+  if (numBlocks != 0)
+  {
+    memcpy(dummyState, lanes[0]->state, sizeof(dummyState));
+    for (i = 0; i < SHA256_NUM_LANES_MAX; i++)
+    {
+      if (i < n)
+      {
+        states[i] = lanes[i]->state;
+        blocks[i] = data[i] + offsets[i];
+      }
+      else
+      {
+        states[i] = dummyState;
+        blocks[i] = blocks[0];
+      }
+    }
+    Sha256_UpdateBlocks_Avx2(states, blocks, numBlocks);
+    for (i = 0; i < n; i++)
+    {
+      lanes[i]->count += (UInt64)numBlocks << 6;
+      offsets[i] += numBlocks << 6;
+    }
+  }
+
+  for (i = 0; i < n; i++)
+    Sha256_Update(lanes[i], data[i] + offsets[i], size - offsets[i]);
+}
+
+#endif
+
+void Sha256_UpdateN(CSha256 * const *p, const Byte * const *data, size_t size, unsigned num)
+{
+  unsigned i;
+  #ifdef USE_AVX2_SHA
+  if (g_Sha256_NumLanes > 1)
+  {
+    CSha256 *lanes[SHA256_NUM_LANES_MAX];
+    const Byte *laneData[SHA256_NUM_LANES_MAX];
+    unsigned n = 0;
+    for (i = 0; i < num; i++)
+    {
+      if (p[i]->func_UpdateBlocks != Sha256_UpdateBlocks)
+      {
+        Sha256_Update(p[i], data[i], size);
+        continue;
+      }
+      lanes[n] = p[i];
+      laneData[n] = data[i];
+      if (++n == SHA256_NUM_LANES_MAX)
+      {
+        Sha256_UpdateLanes(lanes, laneData, size, n);
+        n = 0;
+      }
+    }
+    Sha256_UpdateLanes(lanes, laneData, size, n);
+    return;
+  }
+  #endif
+  for (i = 0; i < num; i++)
+    Sha256_Update(p[i], data[i], size);
 }
@@ -10,17 +10,45 @@ EXTERN_C_BEGIN
 
 #define SHA256_DIGEST_SIZE 32
 
+#define SHA256_ALGO_DEFAULT 0
+#define SHA256_ALGO_SW      1
+#define SHA256_ALGO_HW      2
+
+#define SHA256_NUM_LANES_MAX 8
+
+typedef void (MY_FAST_CALL *SHA256_FUNC_UPDATE_BLOCKS)(UInt32 state[8], const Byte *data, size_t numBlocks);
+
 typedef struct
 {
+  SHA256_FUNC_UPDATE_BLOCKS func_UpdateBlocks;
   UInt32 state[8];
   UInt64 count;
   Byte buffer[64];
 } CSha256;
 
+/* Sha256Prepare() checks the CPU and selects the fastest code for SHA256_ALGO_DEFAULT.
+   Call it once at startup (like CrcGenerateTable()). Without it the portable code is used. */
+
+void Sha256Prepare(void);
+
+/* Sha256_Init() also selects SHA256_ALGO_DEFAULT code for (p).
+   Sha256_SetFunction() returns False, if (algo) is not supported by CPU or compiler.
+   Call it after Sha256_Init() to force another code. */
+
 void Sha256_Init(CSha256 *p);
+Bool Sha256_SetFunction(CSha256 *p, unsigned algo);
 void Sha256_Update(CSha256 *p, const Byte *data, size_t size);
 void Sha256_Final(CSha256 *p, Byte *digest);
 
+/* Sha256_UpdateN() is same as Sha256_Update() for each of (num) hashes, where
+   hash p[i] gets (size) bytes from data[i].
+   The hashes that use portable code are processed in groups of
+   Sha256_GetNumLanes() with AVX2 multi-buffer code.
+   Sha256_GetNumLanes() returns 1, if AVX2 is not supported. */
+
+unsigned Sha256_GetNumLanes(void);
+void Sha256_UpdateN(CSha256 * const *p, const Byte * const *data, size_t size, unsigned num);
+
 EXTERN_C_END
 
 #endif
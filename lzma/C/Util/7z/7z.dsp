@@ -125,6 +125,11 @@ SOURCE=..\..\7zDec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\7zExtract.c
+# ADD CPP /D "_7ZIP_PPMD_SUPPPORT"
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\7zFile.c
 # End Source File
 # Begin Source File
@@ -203,6 +208,15 @@ SOURCE=..\..\Ppmd7Dec.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\Threads.c
+# SUBTRACT CPP /YX
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\Threads.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\Types.h
 # End Source File
 # End Group
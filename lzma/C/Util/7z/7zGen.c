@@ -0,0 +1,287 @@
+/* 7zGen.c -- Generator of 7z archives with big number of small files
+2010-11-18 : Igor Pavlov : Public domain */
+
+/*
+  It creates test archives for "7zDec b" (benchmark of archive opening):
+  (numFiles) files "dNNN/fileNNNNNNN.txt" in one solid block (Copy method).
+  With "-h" switch the header is packed with LZMA, as 7-Zip writes it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../7z.h"
+#include "../../7zAlloc.h"
+#include "../../7zCrc.h"
+#include "../../7zFile.h"
+#include "../../LzmaEnc.h"
+
+static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+
+static const Byte kSignature[k7zSignatureSize] = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
+
+#define kNumFilesMax (1 << 26)
+
+static void SetUi32(Byte *p, UInt32 v)
+{
+  unsigned i;
+  for (i = 0; i < 4; i++, v >>= 8)
+    p[i] = (Byte)v;
+}
+
+static void SetUi64(Byte *p, UInt64 v)
+{
+  unsigned i;
+  for (i = 0; i < 8; i++, v >>= 8)
+    p[i] = (Byte)v;
+}
+
+static int WriteBytes(CDynBuf *buf, const Byte *data, size_t size)
+{
+  return DynBuf_Write(buf, data, size, &g_Alloc);
+}
+
+static int WriteByte(CDynBuf *buf, Byte b)
+{
+  return WriteBytes(buf, &b, 1);
+}
+
+/* 7z number: the number of high 1 bits in first byte is the number of next bytes */
+
+static int WriteNumber(CDynBuf *buf, UInt64 v)
+{
+  Byte temp[9];
+  unsigned i, k;
+  for (i = 0; i < 8; i++)
+    if (v < ((UInt64)1 << (7 * (i + 1))))
+      break;
+  temp[0] = (Byte)(i == 8 ? 0xFF : (((0xFF << (8 - i)) & 0xFF) | (unsigned)(v >> (8 * i))));
+  for (k = 0; k < i; k++)
+    temp[1 + k] = (Byte)(v >> (8 * k));
+  return WriteBytes(buf, temp, 1 + i);
+}
+
+static int WriteCrc(CDynBuf *buf, UInt32 crc)
+{
+  Byte temp[4];
+  SetUi32(temp, crc);
+  return WriteBytes(buf, temp, 4);
+}
+
+static unsigned GetFileName(UInt32 index, char *name)
+{
+  sprintf(name, "d%u/file%07u.txt", (unsigned)(index / 1000), (unsigned)index);
+  return (unsigned)strlen(name);
+}
+
+static unsigned GetFileData(UInt32 index, char *data)
+{
+  sprintf(data, "%u\n", (unsigned)index);
+  return (unsigned)strlen(data);
+}
+
+static SRes WriteToFile(CSzFile *file, const void *data, size_t size)
+{
+  size_t processed = size;
+  if (File_Write(file, data, &processed) != 0 || processed != size)
+    return SZ_ERROR_WRITE;
+  return SZ_OK;
+}
+
+static SRes CreateHeader(CDynBuf *header, CDynBuf *data, UInt32 numFiles)
+{
+  UInt32 i;
+  char s[64];
+
+  for (i = 0; i < numFiles; i++)
+    if (!WriteBytes(data, (const Byte *)s, GetFileData(i, s)))
+      return SZ_ERROR_MEM;
+
+  if (!WriteByte(header, k7zIdHeader) ||
+      !WriteByte(header, k7zIdMainStreamsInfo) ||
+
+      !WriteByte(header, k7zIdPackInfo) ||
+      !WriteNumber(header, 0) ||
+      !WriteNumber(header, 1) ||
+      !WriteByte(header, k7zIdSize) ||
+      !WriteNumber(header, data->pos) ||
+      !WriteByte(header, k7zIdEnd) ||
+
+      !WriteByte(header, k7zIdUnpackInfo) ||
+      !WriteByte(header, k7zIdFolder) ||
+      !WriteNumber(header, 1) ||
+      !WriteByte(header, 0) ||
+      !WriteNumber(header, 1) || /* one coder: Copy */
+      !WriteByte(header, 1) ||
+      !WriteByte(header, 0) ||
+      !WriteByte(header, k7zIdCodersUnpackSize) ||
+      !WriteNumber(header, data->pos) ||
+      !WriteByte(header, k7zIdEnd) ||
+
+      !WriteByte(header, k7zIdSubStreamsInfo) ||
+      !WriteByte(header, k7zIdNumUnpackStream) ||
+      !WriteNumber(header, numFiles) ||
+      !WriteByte(header, k7zIdSize))
+    return SZ_ERROR_MEM;
+  for (i = 0; i + 1 < numFiles; i++)
+    if (!WriteNumber(header, GetFileData(i, s)))
+      return SZ_ERROR_MEM;
+  if (!WriteByte(header, k7zIdCRC) ||
+      !WriteByte(header, 1))
+    return SZ_ERROR_MEM;
+  for (i = 0; i < numFiles; i++)
+    if (!WriteCrc(header, CrcCalc(s, GetFileData(i, s))))
+      return SZ_ERROR_MEM;
+  if (!WriteByte(header, k7zIdEnd) ||
+      !WriteByte(header, k7zIdEnd) ||
+
+      !WriteByte(header, k7zIdFilesInfo) ||
+      !WriteNumber(header, numFiles))
+    return SZ_ERROR_MEM;
+  {
+    UInt64 namesSize = 1;
+    for (i = 0; i < numFiles; i++)
+      namesSize += (GetFileName(i, s) + 1) * 2;
+    if (!WriteByte(header, k7zIdName) ||
+        !WriteNumber(header, namesSize) ||
+        !WriteByte(header, 0))
+      return SZ_ERROR_MEM;
+  }
+  for (i = 0; i < numFiles; i++)
+  {
+    Byte name[64 * 2];
+    unsigned len = GetFileName(i, s) + 1;
+    unsigned k;
+    for (k = 0; k < len; k++)
+    {
+      name[k * 2] = (Byte)s[k];
+      name[k * 2 + 1] = 0;
+    }
+    if (!WriteBytes(header, name, len * 2))
+      return SZ_ERROR_MEM;
+  }
+  if (!WriteByte(header, k7zIdEnd) ||
+      !WriteByte(header, k7zIdEnd))
+    return SZ_ERROR_MEM;
+  return SZ_OK;
+}
+
+/* it packs (header) with LZMA to the end of (data) and replaces (header) with encoded header */
+
+static SRes PackHeader(CDynBuf *header, CDynBuf *data)
+{
+  CLzmaEncProps props;
+  Byte propsEncoded[LZMA_PROPS_SIZE];
+  SizeT propsSize = LZMA_PROPS_SIZE;
+  SizeT destLen = header->pos + header->pos / 3 + (1 << 16);
+  UInt64 packPos = data->pos;
+  UInt32 headerCrc = CrcCalc(header->data, header->pos);
+  UInt64 headerSize = header->pos;
+  Byte *dest;
+  SRes res;
+
+  dest = (Byte *)IAlloc_Alloc(&g_Alloc, destLen);
+  if (dest == 0)
+    return SZ_ERROR_MEM;
+  LzmaEncProps_Init(&props);
+  props.dictSize = 1 << 24;
+  res = LzmaEncode(dest, &destLen, header->data, header->pos, &props,
+      propsEncoded, &propsSize, 0, NULL, &g_Alloc, &g_Alloc);
+  if (res == SZ_OK && !WriteBytes(data, dest, destLen))
+    res = SZ_ERROR_MEM;
+  IAlloc_Free(&g_Alloc, dest);
+  RINOK(res);
+
+  DynBuf_SeekToBeg(header);
+  if (!WriteByte(header, k7zIdEncodedHeader) ||
+      !WriteByte(header, k7zIdPackInfo) ||
+      !WriteNumber(header, packPos) ||
+      !WriteNumber(header, 1) ||
+      !WriteByte(header, k7zIdSize) ||
+      !WriteNumber(header, destLen) ||
+      !WriteByte(header, k7zIdEnd) ||
+
+      !WriteByte(header, k7zIdUnpackInfo) ||
+      !WriteByte(header, k7zIdFolder) ||
+      !WriteNumber(header, 1) ||
+      !WriteByte(header, 0) ||
+      !WriteNumber(header, 1) || /* one coder: LZMA with properties */
+      !WriteByte(header, 0x23) ||
+      !WriteByte(header, 3) || !WriteByte(header, 1) || !WriteByte(header, 1) ||
+      !WriteNumber(header, propsSize) ||
+      !WriteBytes(header, propsEncoded, propsSize) ||
+      !WriteByte(header, k7zIdCodersUnpackSize) ||
+      !WriteNumber(header, headerSize) ||
+      !WriteByte(header, k7zIdCRC) ||
+      !WriteByte(header, 1) ||
+      !WriteCrc(header, headerCrc) ||
+      !WriteByte(header, k7zIdEnd) ||
+      !WriteByte(header, k7zIdEnd))
+    return SZ_ERROR_MEM;
+  return SZ_OK;
+}
+
+static SRes WriteArchive(const char *name, const CDynBuf *header, const CDynBuf *data)
+{
+  Byte startHeader[k7zStartHeaderSize];
+  CSzFile file;
+  SRes res;
+
+  memcpy(startHeader, kSignature, k7zSignatureSize);
+  startHeader[6] = k7zMajorVersion;
+  startHeader[7] = 4;
+  SetUi64(startHeader + 12, data->pos);
+  SetUi64(startHeader + 20, header->pos);
+  SetUi32(startHeader + 28, CrcCalc(header->data, header->pos));
+  SetUi32(startHeader + 8, CrcCalc(startHeader + 12, 20));
+
+  if (OutFile_Open(&file, name) != 0)
+    return SZ_ERROR_WRITE;
+  res = WriteToFile(&file, startHeader, k7zStartHeaderSize);
+  if (res == SZ_OK)
+    res = WriteToFile(&file, data->data, data->pos);
+  if (res == SZ_OK)
+    res = WriteToFile(&file, header->data, header->pos);
+  if (File_Close(&file) != 0 && res == SZ_OK)
+    res = SZ_ERROR_WRITE;
+  return res;
+}
+
+int MY_CDECL main(int numargs, char *args[])
+{
+  CDynBuf header, data;
+  unsigned long numFiles;
+  char *end;
+  SRes res;
+
+  if (numargs < 3 || numargs > 4 || (numargs == 4 && strcmp(args[3], "-h") != 0))
+  {
+    printf("\nUsage: 7zGen <archive_name> <number_of_files> [-h]\n"
+        "  -h: pack header with LZMA\n");
+    return 1;
+  }
+  numFiles = strtoul(args[2], &end, 10);
+  if (*end != 0 || numFiles == 0 || numFiles > kNumFilesMax)
+  {
+    printf("\nERROR: incorrect number of files\n");
+    return 1;
+  }
+
+  CrcGenerateTable();
+  DynBuf_Construct(&header);
+  DynBuf_Construct(&data);
+  res = CreateHeader(&header, &data, (UInt32)numFiles);
+  if (res == SZ_OK && numargs == 4)
+    res = PackHeader(&header, &data);
+  if (res == SZ_OK)
+    res = WriteArchive(args[1], &header, &data);
+  DynBuf_Free(&header, &g_Alloc);
+  DynBuf_Free(&data, &g_Alloc);
+  if (res != SZ_OK)
+  {
+    printf("\nERROR #%d\n", res);
+    return 1;
+  }
+  return 0;
+}
@@ -2,7 +2,9 @@
 2010-10-28 : Igor Pavlov : Public domain */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "../../7z.h"
 #include "../../7zAlloc.h"
@@ -10,6 +12,10 @@
 #include "../../7zFile.h"
 #include "../../7zVersion.h"
 
+#ifndef _7ZIP_ST
+#include "../../Threads.h"
+#endif
+
 #ifndef USE_WINDOWS_FILE
 /* for mkdir */
 #ifdef _WIN32
@@ -95,6 +101,61 @@ static SRes Utf16_To_Utf8Buf(CBuf *dest, const UInt16 *src, size_t srcLen)
   dest->data[destLen] = 0;
   return res ? SZ_OK : SZ_ERROR_FAIL;
 }
+
+static Bool Utf8_To_Utf16(UInt16 *dest, size_t *destLen, const Byte *src)
+{
+  size_t destPos = 0;
+  for (;;)
+  {
+    unsigned numAdds;
+    UInt32 value;
+    Byte c = *src++;
+    if (c == 0)
+    {
+      *destLen = destPos;
+      return True;
+    }
+    if (c < 0x80)
+    {
+      if (dest)
+        dest[destPos] = c;
+      destPos++;
+      continue;
+    }
+    if (c < 0xC0)
+      break;
+    for (numAdds = 1; numAdds < 5; numAdds++)
+      if (c < kUtf8Limits[numAdds])
+        break;
+    value = c - kUtf8Limits[numAdds - 1];
+    do
+    {
+      Byte c2 = *src;
+      if (c2 < 0x80 || c2 >= 0xC0)
+        break;
+      src++;
+      value = (value << 6) | (c2 - 0x80);
+    }
+    while (--numAdds != 0);
+    if (numAdds != 0 || value > 0x10FFFF)
+      break;
+    if (value >= 0x10000)
+    {
+      if (dest)
+      {
+        dest[destPos] = (UInt16)(0xD800 + ((value - 0x10000) >> 10));
+        dest[destPos + 1] = (UInt16)(0xDC00 + (value & 0x3FF));
+      }
+      destPos += 2;
+      continue;
+    }
+    if (dest)
+      dest[destPos] = (UInt16)value;
+    destPos++;
+  }
+  *destLen = destPos;
+  return False;
+}
 #endif
 
 static SRes Utf16_To_Char(CBuf *buf, const UInt16 *s, int fileMode)
@@ -131,6 +192,29 @@ static SRes Utf16_To_Char(CBuf *buf, const UInt16 *s, int fileMode)
   #endif
 }
 
+/* it converts the name from command line to null-terminated UTF-16 string in (buf) */
+
+static SRes Char_To_Utf16(CBuf *buf, const char *s)
+{
+  size_t len;
+  #ifdef _WIN32
+  len = strlen(s) + 1;
+  if (!Buf_EnsureSize(buf, len * sizeof(UInt16)))
+    return SZ_ERROR_MEM;
+  if (MultiByteToWideChar(AreFileApisANSI() ? CP_ACP : CP_OEMCP, 0, s, -1, (UInt16 *)buf->data, (int)len) == 0)
+    return SZ_ERROR_FAIL;
+  return SZ_OK;
+  #else
+  if (!Utf8_To_Utf16(NULL, &len, (const Byte *)s))
+    return SZ_ERROR_FAIL;
+  if (!Buf_EnsureSize(buf, (len + 1) * sizeof(UInt16)))
+    return SZ_ERROR_MEM;
+  Utf8_To_Utf16((UInt16 *)buf->data, &len, (const Byte *)s);
+  ((UInt16 *)buf->data)[len] = 0;
+  return SZ_OK;
+  #endif
+}
+
 static WRes MyCreateDir(const UInt16 *name)
 {
   #ifdef USE_WINDOWS_FILE
@@ -281,30 +365,339 @@ static void GetAttribString(UInt32, Bool, char *s)
 }
 #endif
 
+/* FindFiles looks up each name with linear search, then with the name index,
+   and it prints the index of file or "-", if there is no such file.
+   The name index is allocated with allocMain, since SzArEx_Free() frees it. */
+
+static SRes FindFiles(CSzArEx *db, ISzAlloc *allocMain, char **names, int numNames)
+{
+  CBuf buf;
+  UInt32 *indices;
+  SRes res = SZ_OK;
+  int pass, i;
+  if (numNames == 0)
+    return SZ_OK;
+  indices = (UInt32 *)SzAlloc(NULL, numNames * sizeof(UInt32));
+  if (indices == 0)
+    return SZ_ERROR_MEM;
+  Buf_Init(&buf);
+  for (pass = 0; pass < 2 && res == SZ_OK; pass++)
+  {
+    if (pass == 1)
+      res = SzArEx_CreateNameIndex(db, allocMain);
+    for (i = 0; i < numNames && res == SZ_OK; i++)
+    {
+      UInt32 index;
+      res = Char_To_Utf16(&buf, names[i]);
+      if (res != SZ_OK)
+        break;
+      index = SzArEx_FindFile(db, (const UInt16 *)buf.data);
+      if (pass == 0)
+        indices[i] = index;
+      else if (index != indices[i])
+      {
+        PrintError("name index error");
+        res = SZ_ERROR_FAIL;
+      }
+    }
+  }
+  for (i = 0; i < numNames && res == SZ_OK; i++)
+  {
+    char s[32];
+    if (indices[i] == (UInt32)(Int32)-1)
+      strcpy(s, "-");
+    else
+      UInt64ToStr(indices[i], s);
+    printf("%10s  %s\n", s, names[i]);
+  }
+  Buf_Free(&buf, &g_Alloc);
+  SzFree(NULL, indices);
+  return res;
+}
+
+#define kNumOpenBenchPasses 5
+
+/* it returns the best time of SzArEx_Open() in clock() ticks */
+static SRes BenchOpen(ILookInStream *stream, ISzAlloc *allocMain, ISzAlloc *allocTemp, clock_t *best)
+{
+  unsigned i;
+  *best = 0;
+  for (i = 0; i < kNumOpenBenchPasses; i++)
+  {
+    CSzArEx db;
+    Int64 pos = 0;
+    SRes res;
+    clock_t t;
+    RINOK(stream->Seek(stream, &pos, SZ_SEEK_SET));
+    SzArEx_Init(&db);
+    t = clock();
+    res = SzArEx_Open(&db, stream, allocMain, allocTemp);
+    t = clock() - t;
+    SzArEx_Free(&db, allocMain);
+    RINOK(res);
+    if (i == 0 || t < *best)
+      *best = t;
+  }
+  return SZ_OK;
+}
+
+static void PrintOpenTime(const char *name, clock_t t)
+{
+  printf("%-12s %8u ms\n", name, (unsigned)((UInt64)t * 1000 / CLOCKS_PER_SEC));
+}
+
+/* CExtractCallback writes the files that SzArEx_ExtractAll() reports.
+   The output file is opened with the first call for that file.
+   The threads of SzArEx_ExtractAll() can write several files at the same time,
+   so each file that is written now has its own CExtractFile slot. */
+
+typedef struct
+{
+  UInt32 fileIndex; /* the file that uses this slot or (UInt32)-1 */
+  int skip;
+  int isOpen;
+  CSzFile outFile;
+  UInt16 *name;
+  size_t nameSize;
+  const UInt16 *destPath;
+} CExtractFile;
+
+typedef struct
+{
+  ISzExtractCallback vt;
+  const CSzArEx *db;
+  int testMode;
+  int fullPaths;
+  CExtractFile *files;
+  UInt32 numFiles;
+  #ifndef _7ZIP_ST
+  CCriticalSection cs;
+  #endif
+} CExtractCallback;
+
+#ifndef _7ZIP_ST
+#define ExtractCallback_Lock(p) CriticalSection_Enter(&(p)->cs)
+#define ExtractCallback_Unlock(p) CriticalSection_Leave(&(p)->cs)
+#else
+#define ExtractCallback_Lock(p)
+#define ExtractCallback_Unlock(p)
+#endif
+
+static SRes ExtractCallback_StartFile(CExtractCallback *p, CExtractFile *f, UInt32 fileIndex)
+{
+  const CSzArEx *db = p->db;
+  int isDir = SzArEx_IsDir(db, fileIndex);
+  size_t len;
+  size_t j;
+  UInt16 *name;
+
+  f->fileIndex = fileIndex;
+  f->isOpen = 0;
+  f->skip = (isDir && !p->fullPaths);
+  if (f->skip)
+    return SZ_OK;
+
+  len = SzArEx_GetFileNameUtf16(db, fileIndex, NULL);
+  if (len > f->nameSize)
+  {
+    SzFree(NULL, f->name);
+    f->nameSize = len;
+    f->name = (UInt16 *)SzAlloc(NULL, f->nameSize * sizeof(f->name[0]));
+    if (f->name == 0)
+    {
+      f->nameSize = 0;
+      return SZ_ERROR_MEM;
+    }
+  }
+  name = f->name;
+  SzArEx_GetFileNameUtf16(db, fileIndex, name);
+
+  fputs(p->testMode ?
+      "Testing    ":
+      "Extracting ",
+      stdout);
+  RINOK(PrintString(name));
+  if (isDir)
+    printf("/");
+  /* the line is finished here, since other files can be started before this file is finished */
+  printf("\n");
+  if (p->testMode)
+    return SZ_OK;
+
+  f->destPath = name;
+  for (j = 0; name[j] != 0; j++)
+    if (name[j] == '/')
+    {
+      if (p->fullPaths)
+      {
+        name[j] = 0;
+        MyCreateDir(name);
+        name[j] = CHAR_PATH_SEPARATOR;
+      }
+      else
+        f->destPath = name + j + 1;
+    }
+
+  if (isDir)
+  {
+    MyCreateDir(f->destPath);
+    return SZ_OK;
+  }
+  if (OutFile_OpenUtf16(&f->outFile, f->destPath))
+  {
+    PrintError("can not open output file");
+    return SZ_ERROR_FAIL;
+  }
+  f->isOpen = 1;
+  return SZ_OK;
+}
+
+/* it returns the slot of file (fileIndex). If the file has no slot, it starts the file in free slot */
+
+static SRes ExtractCallback_GetFile(CExtractCallback *p, UInt32 fileIndex, CExtractFile **file)
+{
+  CExtractFile *f = NULL;
+  SRes res = SZ_OK;
+  UInt32 i;
+  ExtractCallback_Lock(p);
+  for (i = 0; i < p->numFiles; i++)
+    if (p->files[i].fileIndex == fileIndex)
+    {
+      f = &p->files[i];
+      break;
+    }
+  if (f == NULL)
+  {
+    for (i = 0; i < p->numFiles; i++)
+      if (p->files[i].fileIndex == (UInt32)-1)
+      {
+        f = &p->files[i];
+        break;
+      }
+    if (f == NULL)
+      res = SZ_ERROR_FAIL;
+    else
+      res = ExtractCallback_StartFile(p, f, fileIndex);
+  }
+  ExtractCallback_Unlock(p);
+  *file = f;
+  return res;
+}
+
+static SRes ExtractCallback_Write(void *pp, UInt32 fileIndex, const void *buf, size_t size)
+{
+  CExtractCallback *p = (CExtractCallback *)pp;
+  CExtractFile *f;
+  size_t processedSize = size;
+  RINOK(ExtractCallback_GetFile(p, fileIndex, &f));
+  if (!f->isOpen)
+    return SZ_OK;
+  if (File_Write(&f->outFile, buf, &processedSize) != 0 || processedSize != size)
+  {
+    PrintError("can not write output file");
+    return SZ_ERROR_FAIL;
+  }
+  return SZ_OK;
+}
+
+static SRes ExtractCallback_Finish(void *pp, UInt32 fileIndex, SRes res)
+{
+  CExtractCallback *p = (CExtractCallback *)pp;
+  CExtractFile *f;
+  SRes closeRes = SZ_OK;
+  RINOK(ExtractCallback_GetFile(p, fileIndex, &f));
+  if (f->isOpen)
+  {
+    f->isOpen = 0;
+    if (File_Close(&f->outFile))
+    {
+      PrintError("can not close output file");
+      closeRes = SZ_ERROR_FAIL;
+    }
+    #ifdef USE_WINDOWS_FILE
+    else if (res == SZ_OK && SzBitWithVals_Check(&p->db->db.Attribs, fileIndex))
+      SetFileAttributesW(f->destPath, p->db->db.Attribs.Vals[fileIndex]);
+    #endif
+  }
+  ExtractCallback_Lock(p);
+  f->fileIndex = (UInt32)-1;
+  ExtractCallback_Unlock(p);
+  return closeRes;
+}
+
+#ifndef _7ZIP_ST
+
+#define kNumThreadsMax 64
+
+/* the archive stream for each additional thread of SzArEx_ExtractAll() */
+
+typedef struct
+{
+  CFileInStream archiveStream;
+  CLookToRead lookStream;
+  CFileMapInStream mapStream;
+} CThreadInStream;
+
+#endif
+
 int MY_CDECL main(int numargs, char *args[])
 {
   CFileInStream archiveStream;
   CLookToRead lookStream;
+  CSzFileMap map;
+  CFileMapInStream mapStream;
+  ILookInStream *inStream;
   CSzArEx db;
   SRes res;
   ISzAlloc allocImp;
   ISzAlloc allocTempImp;
   UInt16 *temp = NULL;
   size_t tempSize = 0;
+  UInt32 numThreads = 1;
+  int numNames = 0;
+  #ifndef _7ZIP_ST
+  ILookInStream *inStreams[kNumThreadsMax];
+  CThreadInStream *threadStreams = NULL;
+  UInt32 numThreadStreams = 0;
+  #endif
 
   printf("\n7z ANSI-C Decoder " MY_VERSION_COPYRIGHT_DATE "\n\n");
   if (numargs == 1)
   {
     printf(
-      "Usage: 7zDec <command> <archive_name>\n\n"
+      "Usage: 7zDec <command> <archive_name>"
+      #ifndef _7ZIP_ST
+      " [-mmtN]"
+      #endif
+      "\n\n"
       "<Commands>\n"
+      "  b: Benchmark opening of archive\n"
       "  e: Extract files from archive (without using directory names)\n"
+      "  f: Find files by names: 7zDec f <archive_name> <file_names>...\n"
       "  l: List contents of archive\n"
       "  t: Test integrity of archive\n"
-      "  x: eXtract files with full paths\n");
+      "  x: eXtract files with full paths\n"
+      #ifndef _7ZIP_ST
+      "\n<Switches>\n"
+      "  -mmtN: extract up to N solid blocks at the same time (default 1)\n"
+      #endif
+      );
     return 0;
   }
-  if (numargs < 3)
+  if (numargs > 3 && strcmp(args[1], "f") == 0)
+    numNames = numargs - 3;
+  #ifndef _7ZIP_ST
+  else if (numargs == 4 && strncmp(args[3], "-mmt", 4) == 0)
+  {
+    char *end;
+    numThreads = (UInt32)strtoul(args[3] + 4, &end, 10);
+    if (*end != 0 || numThreads == 0 || numThreads > kNumThreadsMax)
+      numargs = 0;
+    else
+      numargs = 3;
+  }
+  #endif
+  if (numargs - numNames != 3)
   {
     PrintError("incorrect command");
     return 1;
@@ -328,44 +721,66 @@ int MY_CDECL main(int numargs, char *args[])
   lookStream.realStream = &archiveStream.s;
   LookToRead_Init(&lookStream);
 
+  /* the mapped stream reads headers and packed streams without copying.
+     If the file can't be mapped, we read it via CLookToRead */
+  FileMap_Construct(&map);
+  FileMapInStream_CreateVTable(&mapStream);
+  mapStream.map = &map;
+  FileMapInStream_Init(&mapStream);
+  inStream = &lookStream.s;
+  if (FileMap_Open(&map, &archiveStream.file) == 0)
+    inStream = &mapStream.s;
+
   CrcGenerateTable();
 
+  if (strcmp(args[1], "b") == 0)
+  {
+    clock_t t;
+    res = BenchOpen(&lookStream.s, &allocImp, &allocTempImp, &t);
+    if (res == SZ_OK)
+    {
+      PrintOpenTime("LookToRead", t);
+      if (inStream == &mapStream.s)
+      {
+        res = BenchOpen(&mapStream.s, &allocImp, &allocTempImp, &t);
+        if (res == SZ_OK)
+          PrintOpenTime("FileMap", t);
+      }
+    }
+    FileMap_Close(&map);
+    File_Close(&archiveStream.file);
+    if (res == SZ_OK)
+      return 0;
+    printf("\nERROR #%d\n", res);
+    return 1;
+  }
+
   SzArEx_Init(&db);
-  res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
+  res = SzArEx_Open(&db, inStream, &allocImp, &allocTempImp);
   if (res == SZ_OK)
   {
     char *command = args[1];
-    int listCommand = 0, testCommand = 0, extractCommand = 0, fullPaths = 0;
+    int listCommand = 0, testCommand = 0, fullPaths = 0, findCommand = 0;
     if (strcmp(command, "l") == 0) listCommand = 1;
+    else if (strcmp(command, "f") == 0) findCommand = 1;
     else if (strcmp(command, "t") == 0) testCommand = 1;
-    else if (strcmp(command, "e") == 0) extractCommand = 1;
-    else if (strcmp(command, "x") == 0) { extractCommand = 1; fullPaths = 1; }
-    else
+    else if (strcmp(command, "x") == 0) fullPaths = 1;
+    else if (strcmp(command, "e") != 0)
     {
       PrintError("incorrect command");
       res = SZ_ERROR_FAIL;
     }
 
-    if (res == SZ_OK)
+    if (res == SZ_OK && findCommand)
+      res = FindFiles(&db, &allocImp, args + 3, numNames);
+    else if (res == SZ_OK && listCommand)
     {
       UInt32 i;
-
-      /*
-      if you need cache, use these 3 variables.
-      if you use external function, you can make these variable as static.
-      */
-      UInt32 blockIndex = 0xFFFFFFFF; /* it can have any value before first call (if outBuffer = 0) */
-      Byte *outBuffer = 0; /* it must be 0 before first call for each new archive. */
-      size_t outBufferSize = 0;  /* it can have any value before first call (if outBuffer = 0) */
-
       for (i = 0; i < db.db.NumFiles; i++)
       {
-        size_t offset = 0;
-        size_t outSizeProcessed = 0;
-        const CSzFileItem *f = db.db.Files + i;
         size_t len;
-        if (listCommand == 0 && f->IsDir && !fullPaths)
-          continue;
+        int isDir = SzArEx_IsDir(&db, i);
+        char attr[8], s[32], t[32];
         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
 
         if (len > tempSize)
@@ -381,108 +796,125 @@ int MY_CDECL main(int numargs, char *args[])
         }
 
         SzArEx_GetFileNameUtf16(&db, i, temp);
-        if (listCommand)
-        {
-          char attr[8], s[32], t[32];
 
-          GetAttribString(f->AttribDefined ? f->Attrib : 0, f->IsDir, attr);
+        GetAttribString(SzBitWithVals_Check(&db.db.Attribs, i) ? db.db.Attribs.Vals[i] : 0, isDir, attr);
 
-          UInt64ToStr(f->Size, s);
-          if (f->MTimeDefined)
-            ConvertFileTimeToString(&f->MTime, t);
-          else
-          {
-            size_t j;
-            for (j = 0; j < 19; j++)
-              t[j] = ' ';
-            t[j] = '\0';
-          }
-          
-          printf("%s %s %10s  ", t, attr, s);
-          res = PrintString(temp);
-          if (res != SZ_OK)
-            break;
-          if (f->IsDir)
-            printf("/");
-          printf("\n");
-          continue;
+        UInt64ToStr(SzArEx_GetFileSize(&db, i), s);
+        if (SzBitWithVals_Check(&db.db.MTimes, i))
+          ConvertFileTimeToString(&db.db.MTimes.Vals[i], t);
+        else
+        {
+          size_t j;
+          for (j = 0; j < 19; j++)
+            t[j] = ' ';
+          t[j] = '\0';
         }
-        fputs(testCommand ?
-            "Testing    ":
-            "Extracting ",
-            stdout);
+        
+        printf("%s %s %10s  ", t, attr, s);
         res = PrintString(temp);
         if (res != SZ_OK)
           break;
-        if (f->IsDir)
+        if (isDir)
           printf("/");
-        else
+        printf("\n");
+      }
+    }
+    else if (res == SZ_OK)
+    {
+      /* the files are written while their folder is decoded,
+         so we don't need the buffer for whole folder */
+      CExtractCallback callback;
+      ILookInStream **streams = &inStream;
+      UInt32 i;
+      callback.vt.Write = ExtractCallback_Write;
+      callback.vt.Finish = ExtractCallback_Finish;
+      callback.db = &db;
+      callback.testMode = testCommand;
+      callback.fullPaths = fullPaths;
+      callback.numFiles = numThreads;
+      callback.files = (CExtractFile *)SzAlloc(NULL, numThreads * sizeof(CExtractFile));
+      if (callback.files == 0)
+        res = SZ_ERROR_MEM;
+      else
+        for (i = 0; i < numThreads; i++)
         {
-          res = SzArEx_Extract(&db, &lookStream.s, i,
-              &blockIndex, &outBuffer, &outBufferSize,
-              &offset, &outSizeProcessed,
-              &allocImp, &allocTempImp);
-          if (res != SZ_OK)
-            break;
+          CExtractFile *f = &callback.files[i];
+          f->fileIndex = (UInt32)-1;
+          f->skip = 0;
+          f->isOpen = 0;
+          f->name = NULL;
+          f->nameSize = 0;
+          f->destPath = NULL;
         }
-        if (!testCommand)
+
+      #ifndef _7ZIP_ST
+      /* each thread reads the archive with its own stream: the streams over
+         the map share it, else the archive is opened again for each thread */
+      if (res == SZ_OK && numThreads > 1)
+      {
+        streams = inStreams;
+        inStreams[0] = inStream;
+        threadStreams = (CThreadInStream *)SzAlloc(NULL, (numThreads - 1) * sizeof(CThreadInStream));
+        if (threadStreams == 0)
+          res = SZ_ERROR_MEM;
+        for (; res == SZ_OK && numThreadStreams < numThreads - 1; numThreadStreams++)
         {
-          CSzFile outFile;
-          size_t processedSize;
-          size_t j;
-          UInt16 *name = (UInt16 *)temp;
-          const UInt16 *destPath = (const UInt16 *)name;
-          for (j = 0; name[j] != 0; j++)
-            if (name[j] == '/')
-            {
-              if (fullPaths)
-              {
-                name[j] = 0;
-                MyCreateDir(name);
-                name[j] = CHAR_PATH_SEPARATOR;
-              }
-              else
-                destPath = name + j + 1;
-            }
-    
-          if (f->IsDir)
+          CThreadInStream *s = &threadStreams[numThreadStreams];
+          if (inStream == &mapStream.s)
           {
-            MyCreateDir(destPath);
-            printf("\n");
+            FileMapInStream_CreateVTable(&s->mapStream);
+            s->mapStream.map = &map;
+            FileMapInStream_Init(&s->mapStream);
+            inStreams[numThreadStreams + 1] = &s->mapStream.s;
             continue;
           }
-          else if (OutFile_OpenUtf16(&outFile, destPath))
-          {
-            PrintError("can not open output file");
-            res = SZ_ERROR_FAIL;
-            break;
-          }
-          processedSize = outSizeProcessed;
-          if (File_Write(&outFile, outBuffer + offset, &processedSize) != 0 || processedSize != outSizeProcessed)
+          if (InFile_Open(&s->archiveStream.file, args[2]))
           {
-            PrintError("can not write output file");
+            PrintError("can not open input file");
             res = SZ_ERROR_FAIL;
             break;
           }
-          if (File_Close(&outFile))
-          {
-            PrintError("can not close output file");
-            res = SZ_ERROR_FAIL;
-            break;
-          }
-          #ifdef USE_WINDOWS_FILE
-          if (f->AttribDefined)
-            SetFileAttributesW(destPath, f->Attrib);
-          #endif
+          FileInStream_CreateVTable(&s->archiveStream);
+          LookToRead_CreateVTable(&s->lookStream, False);
+          s->lookStream.realStream = &s->archiveStream.s;
+          LookToRead_Init(&s->lookStream);
+          inStreams[numThreadStreams + 1] = &s->lookStream.s;
         }
-        printf("\n");
       }
-      IAlloc_Free(&allocImp, outBuffer);
+      if (res == SZ_OK && CriticalSection_Init(&callback.cs) != 0)
+        res = SZ_ERROR_THREAD;
+      #endif
+
+      if (res == SZ_OK)
+      {
+        res = SzArEx_ExtractAll(&db, streams, numThreads, &callback.vt, &allocImp, &allocTempImp);
+        #ifndef _7ZIP_ST
+        CriticalSection_Delete(&callback.cs);
+        #endif
+      }
+
+      #ifndef _7ZIP_ST
+      if (inStream != &mapStream.s)
+        for (i = 0; i < numThreadStreams; i++)
+          File_Close(&threadStreams[i].archiveStream.file);
+      SzFree(NULL, threadStreams);
+      #endif
+      if (callback.files != 0)
+      {
+        for (i = 0; i < numThreads; i++)
+        {
+          if (callback.files[i].isOpen)
+            File_Close(&callback.files[i].outFile);
+          SzFree(NULL, callback.files[i].name);
+        }
+        SzFree(NULL, callback.files);
+      }
     }
   }
   SzArEx_Free(&db, &allocImp);
   SzFree(NULL, temp);
 
+  FileMap_Close(&map);
   File_Close(&archiveStream.file);
   if (res == SZ_OK)
   {
@@ -384,7 +384,6 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     {
       size_t offset = 0;
       size_t outSizeProcessed = 0;
-      const CSzFileItem *f = db.db.Files + i;
       size_t len;
       WCHAR *temp;
       len = SzArEx_GetFileNameUtf16(&db, i, NULL);
@@ -422,7 +421,7 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
           }
         }
 
-        if (f->IsDir)
+        if (SzArEx_IsDir(&db, i))
         {
           MyCreateDir(path);
           continue;
@@ -465,11 +464,11 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
         }
         
         #ifdef USE_WINDOWS_FILE
-        if (f->MTimeDefined)
+        if (SzBitWithVals_Check(&db.db.MTimes, i))
         {
           FILETIME mTime;
-          mTime.dwLowDateTime = f->MTime.Low;
-          mTime.dwHighDateTime = f->MTime.High;
+          mTime.dwLowDateTime = db.db.MTimes.Vals[i].Low;
+          mTime.dwHighDateTime = db.db.MTimes.Vals[i].High;
           SetFileTime(outFile.handle, NULL, NULL, &mTime);
         }
         #endif
@@ -485,8 +484,8 @@ int APIENTRY WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
           }
         }
         #ifdef USE_WINDOWS_FILE
-        if (f->AttribDefined)
-          SetFileAttributesW(path, f->Attrib);
+        if (SzBitWithVals_Check(&db.db.Attribs, i))
+          SetFileAttributesW(path, db.db.Attribs.Vals[i]);
         #endif
       }
     }
@@ -0,0 +1,350 @@
+/* XzTest.c -- Tests for multi-thread Xz decoder and random access reader
+2010-11-18 : Igor Pavlov : Public domain */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../7zCrc.h"
+#include "../../XzCrc64.h"
+#include "../../XzEnc.h"
+
+#define kDataSize (4 << 20)
+#define kBlockSize (1 << 20)
+
+/* allocations of (failSize) bytes or more fail, and are counted */
+static size_t g_FailSize = (size_t)0 - 1;
+static unsigned g_NumFailed;
+
+static void *SzAlloc(void *p, size_t size)
+{
+  p = p;
+  if (size >= g_FailSize)
+  {
+    g_NumFailed++;
+    return 0;
+  }
+  return malloc(size);
+}
+
+static void SzFree(void *p, void *address) { p = p; free(address); }
+static ISzAlloc g_Alloc = { SzAlloc, SzFree };
+
+typedef struct
+{
+  ISeqOutStream s;
+  Byte *data;
+  size_t size;
+  size_t pos;
+} CBufOutStream;
+
+static size_t BufOutStream_Write(void *pp, const void *data, size_t size)
+{
+  CBufOutStream *p = (CBufOutStream *)pp;
+  if (size > p->size - p->pos)
+    size = p->size - p->pos;
+  memcpy(p->data + p->pos, data, size);
+  p->pos += size;
+  return size;
+}
+
+typedef struct
+{
+  ISeekInStream s;
+  const Byte *data;
+  size_t size;
+  size_t pos;
+} CBufInStream;
+
+static SRes BufInStream_Read(void *pp, void *buf, size_t *size)
+{
+  CBufInStream *p = (CBufInStream *)pp;
+  if (*size > p->size - p->pos)
+    *size = p->size - p->pos;
+  memcpy(buf, p->data + p->pos, *size);
+  p->pos += *size;
+  return SZ_OK;
+}
+
+static SRes BufInStream_Seek(void *pp, Int64 *pos, ESzSeek origin)
+{
+  CBufInStream *p = (CBufInStream *)pp;
+  Int64 base = 0;
+  if (origin == SZ_SEEK_CUR)
+    base = (Int64)p->pos;
+  else if (origin == SZ_SEEK_END)
+    base = (Int64)p->size;
+  base += *pos;
+  if (base < 0 || base > (Int64)p->size)
+    return SZ_ERROR_PARAM;
+  p->pos = (size_t)base;
+  *pos = base;
+  return SZ_OK;
+}
+
+/* in-memory .xz file, with CLookToRead over it */
+
+typedef struct
+{
+  CBufInStream in;
+  CLookToRead look;
+} CXzFile;
+
+static ILookInStream *XzFile_Open(CXzFile *p, const Byte *data, size_t size)
+{
+  p->in.s.Read = BufInStream_Read;
+  p->in.s.Seek = BufInStream_Seek;
+  p->in.data = data;
+  p->in.size = size;
+  p->in.pos = 0;
+  LookToRead_CreateVTable(&p->look, True);
+  p->look.realStream = &p->in.s;
+  LookToRead_Init(&p->look);
+  return &p->look.s;
+}
+
+static SRes Encode(Byte *dest, size_t *destLen, const Byte *src, size_t srcLen, UInt64 blockSize)
+{
+  CBufOutStream outStream;
+  CBufInStream inStream;
+  CXzProps props;
+  outStream.s.Write = BufOutStream_Write;
+  outStream.data = dest;
+  outStream.size = *destLen;
+  outStream.pos = 0;
+  inStream.s.Read = BufInStream_Read;
+  inStream.data = src;
+  inStream.size = srcLen;
+  inStream.pos = 0;
+  XzProps_Init(&props);
+  props.blockSize = blockSize;
+  props.lzma2Props.lzmaProps.level = 1;
+  RINOK(XzEnc_Encode(&outStream.s, (ISeqInStream *)&inStream.s, &props, NULL));
+  *destLen = outStream.pos;
+  return SZ_OK;
+}
+
+static SRes DecodeToBuf(Byte *dest, SizeT *destLen, const Byte *src, size_t srcLen,
+    unsigned numThreads, UInt64 memUsageMax)
+{
+  CXzFile file;
+  CXzDecMtProps props;
+  XzDecMtProps_Init(&props);
+  props.numThreads = numThreads;
+  props.memUsageMax = memUsageMax;
+  return XzDecMt_DecodeToBuf(dest, destLen, XzFile_Open(&file, src, srcLen), &props, NULL, &g_Alloc);
+}
+
+static SRes Decode(Byte *dest, SizeT *destLen, const Byte *src, size_t srcLen, unsigned numThreads)
+{
+  CXzFile file;
+  CXzDecMtProps props;
+  CBufOutStream outStream;
+  outStream.s.Write = BufOutStream_Write;
+  outStream.data = dest;
+  outStream.size = *destLen;
+  outStream.pos = 0;
+  XzDecMtProps_Init(&props);
+  props.numThreads = numThreads;
+  RINOK(XzDecMt_Decode(&outStream.s, XzFile_Open(&file, src, srcLen), &props, NULL, &g_Alloc));
+  *destLen = outStream.pos;
+  return SZ_OK;
+}
+
+static int g_NumErrors;
+
+static void Check(int ok, const char *name, unsigned numThreads, SRes res)
+{
+  if (ok)
+    return;
+  printf("FAILED: %s, threads = %u, res = %d\n", name, numThreads, res);
+  g_NumErrors++;
+}
+
+/* every block that has padding must be rejected with SZ_ERROR_ARCHIVE, if a padding byte is not zero */
+
+static void TestPadding(const Byte *xz, size_t xzSize)
+{
+  CXzFile file;
+  CXzs xzs;
+  CXzBlockInfo *blocks = 0;
+  size_t numBlocks = 0, i;
+  unsigned numTested = 0;
+  Int64 startOffset;
+  ILookInStream *inStream = XzFile_Open(&file, xz, xzSize);
+  SRes res;
+
+  Xzs_Construct(&xzs);
+  startOffset = 0;
+  res = inStream->Seek(inStream, &startOffset, SZ_SEEK_END);
+  if (res == SZ_OK)
+    res = Xzs_ReadBackward(&xzs, inStream, &startOffset, NULL, &g_Alloc);
+  if (res == SZ_OK)
+    res = Xzs_GetBlocks(&xzs, &blocks, &numBlocks, &g_Alloc);
+  Xzs_Free(&xzs, &g_Alloc);
+  Check(res == SZ_OK, "index", 1, res);
+
+  for (i = 0; i < numBlocks && res == SZ_OK; i++)
+  {
+    const CXzBlockInfo *b = &blocks[i];
+    size_t size = (size_t)((b->totalSize + 3) & ~(UInt64)3);
+    size_t checkSize = XzFlags_GetCheckSize(b->flags);
+    Byte *block, *dest;
+    CMixCoder decoder;
+    if ((b->totalSize & 3) == 0)
+      continue;
+    block = (Byte *)malloc(size);
+    dest = (Byte *)malloc((size_t)b->unpackSize);
+    memcpy(block, xz + (size_t)b->inPos, size);
+    MixCoder_Construct(&decoder, &g_Alloc);
+    res = XzDec_DecodeBlock(&decoder, b->flags, dest, (SizeT)b->unpackSize, block, (SizeT)b->totalSize);
+    Check(res == SZ_OK, "block", 1, res);
+    block[size - checkSize - 1] = 1;
+    res = XzDec_DecodeBlock(&decoder, b->flags, dest, (SizeT)b->unpackSize, block, (SizeT)b->totalSize);
+    Check(res == SZ_ERROR_ARCHIVE, "block padding", 1, res);
+    res = SZ_OK;
+    MixCoder_Free(&decoder);
+    free(block);
+    free(dest);
+    numTested++;
+  }
+  Check(numTested != 0, "no block with padding", 1, SZ_OK);
+  free(blocks);
+}
+
+static void TestDecode(const char *name, const Byte *data, size_t size, UInt64 blockSize)
+{
+  size_t xzSize = size + size / 8 + (1 << 16);
+  Byte *xz = (Byte *)malloc(xzSize);
+  Byte *dest = (Byte *)malloc(size + 1);
+  unsigned numThreads;
+  SRes res;
+
+  res = Encode(xz, &xzSize, data, size, blockSize);
+  Check(res == SZ_OK, name, 0, res);
+
+  for (numThreads = 1; numThreads <= 4; numThreads += 3)
+  {
+    SizeT destLen;
+
+    /* dest of exactly unpacked size */
+    destLen = size;
+    res = DecodeToBuf(dest, &destLen, xz, xzSize, numThreads, (UInt64)1 << 30);
+    Check(res == SZ_OK && destLen == size && memcmp(dest, data, size) == 0, name, numThreads, res);
+
+    if (size != 0)
+    {
+      destLen = size - 1;
+      res = DecodeToBuf(dest, &destLen, xz, xzSize, numThreads, (UInt64)1 << 30);
+      Check(res == SZ_ERROR_OUTPUT_EOF, "small dest", numThreads, res);
+    }
+
+    destLen = size + 1;
+    res = DecodeToBuf(dest, &destLen, xz, xzSize, numThreads, (UInt64)1 << 30);
+    Check(res == SZ_OK && destLen == size && memcmp(dest, data, size) == 0, "big dest", numThreads, res);
+
+    destLen = size;
+    res = Decode(dest, &destLen, xz, xzSize, numThreads);
+    Check(res == SZ_OK && destLen == size && memcmp(dest, data, size) == 0, "stream", numThreads, res);
+
+    /* without memory for two threads it decodes in one thread */
+    if (size != 0)
+    {
+      g_FailSize = kBlockSize - (kBlockSize >> 2);
+      g_NumFailed = 0;
+      destLen = size;
+      res = DecodeToBuf(dest, &destLen, xz, xzSize, numThreads, kBlockSize);
+      Check(res == SZ_OK && g_NumFailed == 0 && memcmp(dest, data, size) == 0, "memUsageMax", numThreads, res);
+
+      /* if thread buffers can not be allocated, it falls back to one thread */
+      destLen = size;
+      res = DecodeToBuf(dest, &destLen, xz, xzSize, numThreads, (UInt64)1 << 30);
+      Check(res == SZ_OK && memcmp(dest, data, size) == 0, "no memory", numThreads, res);
+      g_FailSize = (size_t)0 - 1;
+    }
+  }
+
+  if (blockSize != 0)
+    TestPadding(xz, xzSize);
+  free(xz);
+  free(dest);
+}
+
+static SRes ReaderOpen(CXzReader *reader, CXzFile *file, const Byte *xz, size_t xzSize)
+{
+  XzReader_Construct(reader, &g_Alloc);
+  return XzReader_Open(reader, XzFile_Open(file, xz, xzSize), 4);
+}
+
+/* file of two streams: the reader must see both of them,
+   and it must not open the file, if the first stream is damaged */
+
+static void TestReader(const Byte *data, size_t size)
+{
+  size_t half = size / 2;
+  size_t xzSize = size + size / 4 + (1 << 17);
+  size_t size1 = xzSize, size2;
+  Byte *xz = (Byte *)malloc(xzSize + 4);
+  Byte buf[100];
+  size_t bufSize;
+  CXzFile file;
+  CXzReader reader;
+  SRes res;
+
+  res = Encode(xz + 4, &size1, data, half, kBlockSize / 2);
+  Check(res == SZ_OK, "reader", 1, res);
+  size2 = xzSize - size1;
+  res = Encode(xz + 4 + size1, &size2, data + half, size - half, kBlockSize / 2);
+  Check(res == SZ_OK, "reader", 1, res);
+  xzSize = size1 + size2;
+
+  res = ReaderOpen(&reader, &file, xz + 4, xzSize);
+  bufSize = sizeof(buf);
+  if (res == SZ_OK)
+    res = XzReader_Read(&reader, half - sizeof(buf) / 2, buf, &bufSize);
+  Check(res == SZ_OK && XzReader_GetSize(&reader) == size &&
+      bufSize == sizeof(buf) && memcmp(buf, data + half - sizeof(buf) / 2, sizeof(buf)) == 0,
+      "reader", 1, res);
+  XzReader_Free(&reader);
+
+  memcpy(xz, "junk", 4);
+  res = ReaderOpen(&reader, &file, xz, xzSize + 4);
+  Check(res == SZ_ERROR_NO_ARCHIVE, "reader, junk before streams", 1, res);
+  XzReader_Free(&reader);
+
+  xz[4 + size1 - 1] ^= 1;
+  res = ReaderOpen(&reader, &file, xz + 4, xzSize);
+  Check(res == SZ_ERROR_NO_ARCHIVE, "reader, damaged first stream", 1, res);
+  XzReader_Free(&reader);
+
+  free(xz);
+}
+
+int MY_CDECL main(void)
+{
+  Byte *data = (Byte *)malloc(kDataSize);
+  UInt32 rnd = 1;
+  size_t i;
+
+  CrcGenerateTable();
+  Crc64GenerateTable();
+
+  /* text-like data, with one incompressible block */
+  for (i = 0; i < kDataSize; i++)
+  {
+    rnd = rnd * 1103515245 + 12345;
+    data[i] = (i / kBlockSize == 1) ? (Byte)(rnd >> 16) : (Byte)("abcdefgh"[(rnd >> 16) & 7]);
+  }
+
+  TestDecode("empty", data, 0, 0);
+  TestDecode("one block", data, kDataSize, 0);
+  TestDecode("blocks", data, kDataSize, kBlockSize);
+  TestDecode("blocks, last is partial", data, kDataSize - 1000, kBlockSize);
+  TestReader(data, kDataSize);
+
+  free(data);
+  if (g_NumErrors != 0)
+    return 1;
+  printf("Xz tests passed\n");
+  return 0;
+}
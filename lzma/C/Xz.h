@@ -133,6 +133,19 @@ SRes Xzs_ReadBackward(CXzs *p, ILookInStream *inStream, Int64 *startOffset, ICom
 UInt64 Xzs_GetNumBlocks(const CXzs *p);
 UInt64 Xzs_GetUnpackSize(const CXzs *p);
 
+typedef struct
+{
+  UInt64 inPos;       /* offset of block header in file */
+  UInt64 outPos;      /* offset of unpacked block in output */
+  UInt64 totalSize;   /* block size without padding, from index */
+  UInt64 unpackSize;
+  CXzStreamFlags flags;
+} CXzBlockInfo;
+
+/* Xzs_GetBlocks returns blocks of all streams in file order.
+   The caller frees (*blocks) with alloc. */
+SRes Xzs_GetBlocks(const CXzs *p, CXzBlockInfo **blocks, size_t *numBlocks, ISzAlloc *alloc);
+
 typedef enum
 {
   CODER_STATUS_NOT_SPECIFIED,               /* use main error code instead */
@@ -247,6 +260,110 @@ SRes XzUnpacker_Code(CXzUnpacker *p, Byte *dest, SizeT *destLen,
 
 Bool XzUnpacker_IsStreamWasFinished(CXzUnpacker *p);
 
+/*
+XzDec_DecodeBlock decodes one whole block that is already in memory.
+  src     - block header, compressed data, padding and check
+  srcLen  - total (unpadded) size of block, as stored in index.
+            src must contain ((srcLen + 3) & ~3) bytes.
+  destLen - unpacked size of block, as stored in index.
+Returns:
+  SZ_OK
+  SZ_ERROR_ARCHIVE - block header or padding error
+  SZ_ERROR_DATA - data error, or sizes don't match the sizes from index
+  SZ_ERROR_CRC - check error
+  SZ_ERROR_MEM, SZ_ERROR_UNSUPPORTED
+*/
+
+SRes XzDec_DecodeBlock(CMixCoder *p, CXzStreamFlags flags, Byte *dest, SizeT destLen,
+    const Byte *src, SizeT srcLen);
+
+/* ---------- Multi-thread decoding ---------- */
+
+typedef struct
+{
+  unsigned numThreads;  /* 1 : decode in calling thread */
+  UInt64 blockSizeMax;  /* files with bigger blocks are decoded in one thread */
+  UInt64 memUsageMax;   /* limit for block buffers of all threads */
+} CXzDecMtProps;
+
+void XzDecMtProps_Init(CXzDecMtProps *p);
+
+/*
+XzDecMt_Decode / XzDecMt_DecodeToBuf decode all streams of .xz file.
+  inStream must be at the start of .xz data, and if inStream supports Seek,
+  that start must be at offset 0.
+
+  If (numThreads > 1), inStream supports Seek, and the file contains indexes,
+  the block list is read with Xzs_ReadBackward, and blocks are decoded
+  on numThreads threads, each block straight into its final position:
+  into (dest) for XzDecMt_DecodeToBuf, or into thread buffer that is
+  written to outStream in order.
+  Each thread needs buffers for the biggest packed block and, for
+  XzDecMt_Decode, for the biggest unpacked block. numThreads is reduced
+  so that these buffers fit into memUsageMax.
+  Otherwise, or if there is not enough memory for two threads, or if the
+  allocation of thread buffers fails before any output was written,
+  the file is decoded with XzUnpacker_Code in calling thread.
+
+XzDecMt_DecodeToBuf:
+  *destLen - in: size of dest, out: number of bytes written to dest
+  It returns SZ_ERROR_OUTPUT_EOF, if dest is too small.
+*/
+
+SRes XzDecMt_Decode(ISeqOutStream *outStream, ILookInStream *inStream,
+    const CXzDecMtProps *props, ICompressProgress *progress, ISzAlloc *alloc);
+
+SRes XzDecMt_DecodeToBuf(Byte *dest, SizeT *destLen, ILookInStream *inStream,
+    const CXzDecMtProps *props, ICompressProgress *progress, ISzAlloc *alloc);
+
+/* ---------- Random access reader ---------- */
+
+#define XZ_READER_CACHE_MAX 32
+
+typedef struct
+{
+  Byte *data;
+  size_t size;        /* allocated size of data */
+  size_t blockIndex;  /* (size_t)-1 : item is free */
+  UInt64 lastUse;
+} CXzReaderCacheItem;
+
+typedef struct
+{
+  ILookInStream *inStream;
+  ISzAlloc *alloc;
+  CXzBlockInfo *blocks;
+  size_t numBlocks;
+  UInt64 unpackSize;
+  CMixCoder decoder;
+  Byte *inBuf;
+  size_t inBufSize;
+  UInt64 useCounter;
+  unsigned numCacheItems;
+  CXzReaderCacheItem cache[XZ_READER_CACHE_MAX];
+} CXzReader;
+
+void XzReader_Construct(CXzReader *p, ISzAlloc *alloc);
+void XzReader_Free(CXzReader *p);
+
+/*
+XzReader_Open reads indexes of all streams in inStream.
+  numCacheBlocks - number of decoded blocks that are kept in memory (1 .. XZ_READER_CACHE_MAX).
+  The least recently used block is dropped, when a new block is decoded.
+  It returns SZ_ERROR_NO_ARCHIVE, if the file is not a sequence of xz streams
+  that starts at offset 0 (for example, if the first stream is damaged).
+
+XzReader_Read reads (*size) bytes at offset (offset) of unpacked data.
+  It decodes only the blocks that contain the requested bytes and are not in cache.
+  *size - in: number of bytes to read, out: number of bytes read.
+  It reads less than requested only at the end of data.
+*/
+
+SRes XzReader_Open(CXzReader *p, ILookInStream *inStream, unsigned numCacheBlocks);
+SRes XzReader_Read(CXzReader *p, UInt64 offset, Byte *dest, size_t *size);
+
+#define XzReader_GetSize(p) ((p)->unpackSize)
+
 EXTERN_C_END
 
 #endif
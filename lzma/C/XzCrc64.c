@@ -1,10 +1,146 @@
 /* XzCrc64.c -- CRC64 calculation
 2010-04-16 : Igor Pavlov : Public domain */
 
+#include "CpuArch.h"
 #include "XzCrc64.h"
 
 #define kCrc64Poly UINT64_CONST(0xC96C5795D7870F42)
-UInt64 g_Crc64Table[256];
+
+#ifdef MY_CPU_LE
+#define CRC64_NUM_TABLES 8
+#else
+#define CRC64_NUM_TABLES 1
+#endif
+
+#if defined(MY_CPU_X86_OR_AMD64) && ( \
+    (defined(__GNUC__) && (__GNUC__ >= 5) && !defined(__clang__)) || \
+    (defined(__clang__) && (__clang_major__ >= 4)) || \
+    (defined(_MSC_VER) && (_MSC_VER >= 1600)))
+#define USE_CRC64_CLMUL
+#endif
+
+typedef UInt64 (MY_FAST_CALL *CRC64_FUNC)(UInt64 v, const void *data, size_t size, const UInt64 *table);
+
+static CRC64_FUNC g_Crc64Update;
+UInt64 g_Crc64Table[256 * CRC64_NUM_TABLES];
+
+#define CRC64_UPDATE_BYTE_2(crc, b) (table[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
+
+#if CRC64_NUM_TABLES == 8
+
+static UInt64 MY_FAST_CALL Crc64UpdateT8(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 && ((unsigned)(ptrdiff_t)p & 3) != 0; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  for (; size >= 8; size -= 8, p += 8)
+  {
+    UInt32 d0 = (UInt32)v ^ ((const UInt32 *)p)[0];
+    UInt32 d1 = (UInt32)(v >> 32) ^ ((const UInt32 *)p)[1];
+    v =
+      table[0x700 + (d0 & 0xFF)] ^
+      table[0x600 + ((d0 >> 8) & 0xFF)] ^
+      table[0x500 + ((d0 >> 16) & 0xFF)] ^
+      table[0x400 + ((d0 >> 24))] ^
+      table[0x300 + (d1 & 0xFF)] ^
+      table[0x200 + ((d1 >> 8) & 0xFF)] ^
+      table[0x100 + ((d1 >> 16) & 0xFF)] ^
+      table[0x000 + ((d1 >> 24))];
+  }
+  for (; size > 0; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  return v;
+}
+
+#define Crc64UpdateTable Crc64UpdateT8
+
+#else
+
+static UInt64 MY_FAST_CALL Crc64UpdateT1(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 ; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  return v;
+}
+
+#define Crc64UpdateTable Crc64UpdateT1
+
+#endif
+
+#ifdef USE_CRC64_CLMUL
+
+/*
+PCLMULQDQ folding. The CRC is reflected, so a 16-byte block in an XMM register
+keeps the coefficient of the highest power in bit 0, and the product of two
+reflected 64-bit values comes out one bit lower than the reflected product.
+So the multiplier for the low / high qword of a block that must be moved
+(n) bits forward is (x^(n+63) mod P) / (x^(n-1) mod P) in reflected form.
+The last 16-byte block is reduced with the tables: its CRC with zero
+initial value is the CRC of the whole folded data.
+*/
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ATTRIB_CLMUL __attribute__((__target__("sse2,pclmul")))
+#else
+#define ATTRIB_CLMUL
+#endif
+
+/* { lo, hi } multipliers for folding over 512 bits and over 128 bits */
+static UInt64 g_Crc64Fold[4];
+
+static UInt64 Crc64_XPowModP(unsigned n)
+{
+  UInt64 r = (UInt64)1 << 63;
+  for (; n != 0; n--)
+    r = (r >> 1) ^ (kCrc64Poly & ~((r & 1) - 1));
+  return r;
+}
+
+#define CLMUL_LOAD(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define CLMUL_FOLD(x, k) _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11))
+
+static UInt64 MY_FAST_CALL ATTRIB_CLMUL Crc64UpdateClmul(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  __m128i x0, x1, x2, x3, k;
+  Byte temp[16];
+
+  if (size < 64 * 2)
+    return Crc64UpdateTable(v, data, size, table);
+
+  x0 = _mm_xor_si128(CLMUL_LOAD(p), _mm_set_epi32(0, 0, (int)(UInt32)(v >> 32), (int)(UInt32)v));
+  x1 = CLMUL_LOAD(p + 16);
+  x2 = CLMUL_LOAD(p + 32);
+  x3 = CLMUL_LOAD(p + 48);
+  p += 64;
+  size -= 64;
+
+  k = _mm_loadu_si128((const __m128i *)(const void *)(g_Crc64Fold + 0));
+  for (; size >= 64; size -= 64, p += 64)
+  {
+    x0 = _mm_xor_si128(CLMUL_FOLD(x0, k), CLMUL_LOAD(p));
+    x1 = _mm_xor_si128(CLMUL_FOLD(x1, k), CLMUL_LOAD(p + 16));
+    x2 = _mm_xor_si128(CLMUL_FOLD(x2, k), CLMUL_LOAD(p + 32));
+    x3 = _mm_xor_si128(CLMUL_FOLD(x3, k), CLMUL_LOAD(p + 48));
+  }
+
+  k = _mm_loadu_si128((const __m128i *)(const void *)(g_Crc64Fold + 2));
+  x1 = _mm_xor_si128(CLMUL_FOLD(x0, k), x1);
+  x2 = _mm_xor_si128(CLMUL_FOLD(x1, k), x2);
+  x3 = _mm_xor_si128(CLMUL_FOLD(x2, k), x3);
+  for (; size >= 16; size -= 16, p += 16)
+    x3 = _mm_xor_si128(CLMUL_FOLD(x3, k), CLMUL_LOAD(p));
+
+  _mm_storeu_si128((__m128i *)(void *)temp, x3);
+  v = Crc64UpdateTable(0, temp, 16, table);
+  return Crc64UpdateTable(v, p, size, table);
+}
+
+#endif
 
 void MY_FAST_CALL Crc64GenerateTable(void)
 {
@@ -17,17 +153,30 @@ void MY_FAST_CALL Crc64GenerateTable(void)
       r = (r >> 1) ^ ((UInt64)kCrc64Poly & ~((r & 1) - 1));
     g_Crc64Table[i] = r;
   }
+  for (; i < 256 * CRC64_NUM_TABLES; i++)
+  {
+    UInt64 r = g_Crc64Table[i - 256];
+    g_Crc64Table[i] = g_Crc64Table[r & 0xFF] ^ (r >> 8);
+  }
+  g_Crc64Update = Crc64UpdateTable;
+  #ifdef USE_CRC64_CLMUL
+  if (CPU_Is_Clmul_Supported())
+  {
+    g_Crc64Fold[0] = Crc64_XPowModP(512 + 63);
+    g_Crc64Fold[1] = Crc64_XPowModP(512 - 1);
+    g_Crc64Fold[2] = Crc64_XPowModP(128 + 63);
+    g_Crc64Fold[3] = Crc64_XPowModP(128 - 1);
+    g_Crc64Update = Crc64UpdateClmul;
+  }
+  #endif
 }
 
 UInt64 MY_FAST_CALL Crc64Update(UInt64 v, const void *data, size_t size)
 {
-  const Byte *p = (const Byte *)data;
-  for (; size > 0 ; size--, p++)
-    v = CRC64_UPDATE_BYTE(v, *p);
-  return v;
+  return g_Crc64Update(v, data, size, g_Crc64Table);
 }
 
 UInt64 MY_FAST_CALL Crc64Calc(const void *data, size_t size)
 {
-  return CRC64_GET_DIGEST(Crc64Update(CRC64_INIT_VAL, data, size));
+  return CRC64_GET_DIGEST(g_Crc64Update(CRC64_INIT_VAL, data, size, g_Crc64Table));
 }
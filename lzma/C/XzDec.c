@@ -17,6 +17,10 @@
 #include "Delta.h"
 #include "Lzma2Dec.h"
 
+#ifndef _7ZIP_ST
+#include "MtCoder.h"
+#endif
+
 #ifdef USE_SUBBLOCK
 #include "SbDec.h"
 #endif
@@ -873,3 +877,434 @@ Bool XzUnpacker_IsStreamWasFinished(CXzUnpacker *p)
 {
   return (p->state == XZ_STATE_STREAM_PADDING) && (((UInt32)p->padSize & 3) == 0);
 }
+
+SRes XzDec_DecodeBlock(CMixCoder *p, CXzStreamFlags flags, Byte *dest, SizeT destLen,
+    const Byte *src, SizeT srcLen)
+{
+  CXzBlock block;
+  CXzCheck check;
+  Byte digest[XZ_CHECK_SIZE_MAX];
+  ECoderStatus status;
+  SizeT headerSize, checkSize, packSize, inLen, outLen, pos;
+
+  if (srcLen == 0 || src[0] == 0)
+    return SZ_ERROR_ARCHIVE;
+  headerSize = ((SizeT)src[0] << 2) + 4;
+  checkSize = XzFlags_GetCheckSize(flags);
+  if (srcLen <= headerSize + checkSize)
+    return SZ_ERROR_ARCHIVE;
+  packSize = srcLen - headerSize - checkSize;
+
+  RINOK(XzBlock_Parse(&block, src));
+  if (XzBlock_HasPackSize(&block) && block.packSize != packSize)
+    return SZ_ERROR_ARCHIVE;
+  if (XzBlock_HasUnpackSize(&block) && block.unpackSize != destLen)
+    return SZ_ERROR_ARCHIVE;
+  RINOK(XzDec_Init(p, &block));
+
+  /* MixCoder_Code reports the end of filter chain only in a call that finds all coders finished */
+  for (inLen = outLen = 0;;)
+  {
+    SizeT inCur = packSize - inLen;
+    SizeT outCur = destLen - outLen;
+    RINOK(MixCoder_Code(p, dest + outLen, &outCur, src + headerSize + inLen, &inCur, True, CODER_FINISH_END, &status));
+    inLen += inCur;
+    outLen += outCur;
+    if (status == CODER_STATUS_FINISHED_WITH_MARK || (inCur == 0 && outCur == 0))
+      break;
+  }
+  if (status != CODER_STATUS_FINISHED_WITH_MARK || inLen != packSize || outLen != destLen)
+    return SZ_ERROR_DATA;
+
+  for (pos = headerSize + packSize; (pos & 3) != 0; pos++)
+    if (src[pos] != 0)
+      return SZ_ERROR_ARCHIVE;
+
+  XzCheck_Init(&check, XzFlags_GetCheckType(flags));
+  XzCheck_Update(&check, dest, destLen);
+  if (XzCheck_Final(&check, digest) && memcmp(digest, src + pos, checkSize) != 0)
+    return SZ_ERROR_CRC;
+  return SZ_OK;
+}
+
+/* ---------- Multi-thread decoding ---------- */
+
+#define XZ_DEC_LOOK_SIZE (1 << 16)
+#define XZ_DEC_OUT_BUF_SIZE (1 << 21)
+
+void XzDecMtProps_Init(CXzDecMtProps *p)
+{
+  p->numThreads = 1;
+  p->blockSizeMax = (UInt64)1 << 28;
+  p->memUsageMax = (UInt64)1 << 30;
+}
+
+#ifndef _7ZIP_ST
+
+typedef struct
+{
+  CLoopThread thread;
+  CMixCoder decoder;
+  Byte *inBuf;
+  size_t inBufSize;
+  Byte *outBuf;
+  size_t outBufSize;
+  const CXzBlockInfo *block;
+  Byte *dest;
+  SRes res;
+} CXzDecMtThread;
+
+#endif
+
+typedef struct
+{
+  ILookInStream *inStream;
+  ISeqOutStream *outStream;   /* NULL, if we decode to dest */
+  Byte *dest;
+  SizeT destSize;
+  ICompressProgress *progress;
+  ISzAlloc *alloc;
+  UInt64 inProcessed;
+  UInt64 outProcessed;
+  #ifndef _7ZIP_ST
+  unsigned numThreads;
+  UInt64 blockSizeMax;
+  UInt64 memUsageMax;
+  CXzDecMtThread *threads;
+  #endif
+} CXzDecMt;
+
+static SRes XzDecMt_Progress(CXzDecMt *p)
+{
+  if (p->progress && p->progress->Progress(p->progress, p->inProcessed, p->outProcessed) != SZ_OK)
+    return SZ_ERROR_PROGRESS;
+  return SZ_OK;
+}
+
+static SRes XzDecMt_DecodeSeq(CXzDecMt *p)
+{
+  CXzUnpacker xzu;
+  Byte *outBuf = p->dest;
+  SizeT outSize = p->destSize;
+  SizeT outPos = 0;
+  ECoderStatus status = CODER_STATUS_NOT_SPECIFIED;
+  SRes res;
+  Byte spare;
+
+  if (p->outStream)
+  {
+    outSize = XZ_DEC_OUT_BUF_SIZE;
+    outBuf = (Byte *)IAlloc_Alloc(p->alloc, outSize);
+    if (outBuf == 0)
+      return SZ_ERROR_MEM;
+  }
+  XzUnpacker_Create(&xzu, p->alloc);
+
+  for (;;)
+  {
+    const void *inBuf;
+    size_t inSize = XZ_DEC_LOOK_SIZE;
+    SizeT inLen, outLen;
+    Byte *outCur = outBuf + outPos;
+    Bool finished;
+
+    res = p->inStream->Look(p->inStream, &inBuf, &inSize);
+    if (res != SZ_OK)
+      break;
+    inLen = inSize;
+    outLen = outSize - outPos;
+    if (outLen == 0)
+    {
+      /* dest is full: the rest of the stream must decode to nothing, so the
+         unpacker still gets one spare byte to finish the block with */
+      outCur = &spare;
+      outLen = 1;
+    }
+    res = XzUnpacker_Code(&xzu, outCur, &outLen, (const Byte *)inBuf, &inLen,
+        (inSize == 0 ? CODER_FINISH_END : CODER_FINISH_ANY), &status);
+    if (outCur == &spare && outLen != 0)
+    {
+      res = SZ_ERROR_OUTPUT_EOF;
+      break;
+    }
+    outPos += outLen;
+    p->inProcessed += inLen;
+    p->outProcessed += outLen;
+    if (res == SZ_OK)
+      res = p->inStream->Skip(p->inStream, inLen);
+
+    finished = ((inLen == 0 && outLen == 0) || res != SZ_OK);
+    if (p->outStream && (outPos == outSize || finished))
+    {
+      if (outPos != 0 && p->outStream->Write(p->outStream, outBuf, outPos) != outPos && res == SZ_OK)
+        res = SZ_ERROR_WRITE;
+      outPos = 0;
+    }
+    if (finished)
+      break;
+    res = XzDecMt_Progress(p);
+    if (res != SZ_OK)
+      break;
+  }
+
+  if (res == SZ_OK &&
+      !(status == CODER_STATUS_NEEDS_MORE_INPUT && XzUnpacker_IsStreamWasFinished(&xzu)))
+    res = SZ_ERROR_DATA;
+
+  XzUnpacker_Free(&xzu);
+  if (p->outStream)
+    IAlloc_Free(p->alloc, outBuf);
+  return res;
+}
+
+#ifndef _7ZIP_ST
+
+static SRes XzDecMt_GetBlocks(CXzDecMt *p, const CXzs *xzs, CXzBlockInfo **blocks, size_t *numBlocks)
+{
+  size_t i;
+  RINOK(Xzs_GetBlocks(xzs, blocks, numBlocks, p->alloc));
+  for (i = 0; i < *numBlocks; i++)
+  {
+    const CXzBlockInfo *b = &(*blocks)[i];
+    if (b->unpackSize > p->blockSizeMax || b->totalSize > p->blockSizeMax + (1 << 16) ||
+        (SizeT)b->unpackSize != b->unpackSize ||
+        (size_t)(b->totalSize + 3) != b->totalSize + 3)
+      return SZ_ERROR_UNSUPPORTED;
+  }
+  if (!p->outStream && *numBlocks != 0 &&
+      (*blocks)[*numBlocks - 1].outPos + (*blocks)[*numBlocks - 1].unpackSize > p->destSize)
+    return SZ_ERROR_OUTPUT_EOF;
+  return SZ_OK;
+}
+
+static THREAD_FUNC_RET_TYPE THREAD_FUNC_CALL_TYPE XzDecMtThread_Func(void *pp)
+{
+  CXzDecMtThread *t = (CXzDecMtThread *)pp;
+  const CXzBlockInfo *b = t->block;
+  t->res = XzDec_DecodeBlock(&t->decoder, b->flags, t->dest, (SizeT)b->unpackSize,
+      t->inBuf, (SizeT)b->totalSize);
+  return 0;
+}
+
+#define MY_BUF_GROW(buf, size, newSize) \
+  if (size < newSize) \
+  { IAlloc_Free(p->alloc, buf); \
+    size = newSize; buf = (Byte *)IAlloc_Alloc(p->alloc, size); \
+    if (buf == 0) { size = 0; return SZ_ERROR_MEM; } }
+
+/* reads block to thread buffer, and starts the thread */
+
+static SRes XzDecMt_StartBlock(CXzDecMt *p, CXzDecMtThread *t, const CXzBlockInfo *b)
+{
+  size_t inSize = (size_t)((b->totalSize + 3) & ~(UInt64)3);
+  MY_BUF_GROW(t->inBuf, t->inBufSize, inSize)
+  if (p->outStream)
+  {
+    size_t outSize = (size_t)b->unpackSize;
+    MY_BUF_GROW(t->outBuf, t->outBufSize, outSize)
+    t->dest = t->outBuf;
+  }
+  else
+    t->dest = p->dest + (size_t)b->outPos;
+  t->block = b;
+  RINOK(LookInStream_SeekTo(p->inStream, b->inPos));
+  RINOK(LookInStream_Read2(p->inStream, t->inBuf, inSize, SZ_ERROR_INPUT_EOF));
+  return LoopThread_StartSubThread(&t->thread) == 0 ? SZ_OK : SZ_ERROR_THREAD;
+}
+
+static SRes XzDecMt_DecodeMt(CXzDecMt *p, const CXzBlockInfo *blocks, size_t numBlocks)
+{
+  unsigned i, numThreads = p->numThreads;
+  size_t numStarted = 0, numFinished = 0;
+  UInt64 inSizeMax = 0, outSizeMax = 0, threadMem;
+  SRes res = SZ_OK;
+
+  if (numThreads > numBlocks)
+    numThreads = (unsigned)numBlocks;
+  for (numStarted = 0; numStarted < numBlocks; numStarted++)
+  {
+    const CXzBlockInfo *b = &blocks[numStarted];
+    UInt64 inSize = (b->totalSize + 3) & ~(UInt64)3;
+    if (inSizeMax < inSize)
+      inSizeMax = inSize;
+    if (outSizeMax < b->unpackSize)
+      outSizeMax = b->unpackSize;
+  }
+  numStarted = 0;
+  threadMem = inSizeMax + (p->outStream ? outSizeMax : 0);
+  if (numThreads > p->memUsageMax / threadMem)
+    numThreads = (unsigned)(p->memUsageMax / threadMem);
+  if (numThreads < 2)
+    return SZ_ERROR_NO_ARCHIVE;
+  p->threads = (CXzDecMtThread *)IAlloc_Alloc(p->alloc, numThreads * sizeof(CXzDecMtThread));
+  if (p->threads == 0)
+    return SZ_ERROR_MEM;
+  for (i = 0; i < numThreads; i++)
+  {
+    CXzDecMtThread *t = &p->threads[i];
+    LoopThread_Construct(&t->thread);
+    MixCoder_Construct(&t->decoder, p->alloc);
+    t->inBuf = t->outBuf = 0;
+    t->inBufSize = t->outBufSize = 0;
+  }
+  for (i = 0; i < numThreads; i++)
+  {
+    CXzDecMtThread *t = &p->threads[i];
+    t->thread.func = XzDecMtThread_Func;
+    t->thread.param = t;
+    if (LoopThread_Create(&t->thread) != 0)
+    {
+      res = SZ_ERROR_THREAD;
+      break;
+    }
+  }
+
+  /* the calling thread reads next block, while other threads decode */
+  if (res == SZ_OK)
+  for (;;)
+  {
+    while (res == SZ_OK && numStarted < numBlocks && numStarted - numFinished < numThreads)
+    {
+      res = XzDecMt_StartBlock(p, &p->threads[numStarted % numThreads], &blocks[numStarted]);
+      if (res == SZ_OK)
+        numStarted++;
+    }
+    if (numFinished == numStarted)
+      break;
+    {
+      CXzDecMtThread *t = &p->threads[numFinished % numThreads];
+      const CXzBlockInfo *b = &blocks[numFinished++];
+      if (LoopThread_WaitSubThread(&t->thread) != 0)
+      {
+        if (res == SZ_OK)
+          res = SZ_ERROR_THREAD;
+        break;
+      }
+      if (res != SZ_OK)
+        continue;
+      res = t->res;
+      if (res == SZ_OK && p->outStream &&
+          p->outStream->Write(p->outStream, t->dest, (size_t)b->unpackSize) != b->unpackSize)
+        res = SZ_ERROR_WRITE;
+      if (res == SZ_OK)
+      {
+        p->inProcessed += (b->totalSize + 3) & ~(UInt64)3;
+        p->outProcessed += b->unpackSize;
+        res = XzDecMt_Progress(p);
+      }
+    }
+  }
+
+  for (i = 0; i < numThreads; i++)
+  {
+    CXzDecMtThread *t = &p->threads[i];
+    if (Thread_WasCreated(&t->thread.thread))
+    {
+      LoopThread_StopAndWait(&t->thread);
+      LoopThread_Close(&t->thread);
+    }
+    MixCoder_Free(&t->decoder);
+    IAlloc_Free(p->alloc, t->inBuf);
+    IAlloc_Free(p->alloc, t->outBuf);
+  }
+  IAlloc_Free(p->alloc, p->threads);
+  p->threads = 0;
+  return res;
+}
+
+/* It returns SZ_OK, if it has decoded the file.
+   It returns SZ_ERROR_NO_ARCHIVE, if multi-thread decoding is not possible,
+   or if it ran out of memory before any output was written,
+   and then the stream is at offset 0 again. */
+
+static SRes XzDecMt_TryDecodeMt(CXzDecMt *p)
+{
+  CXzs xzs;
+  CXzBlockInfo *blocks = 0;
+  size_t numBlocks = 0;
+  Int64 startOffset = 0;
+  SRes res;
+
+  if (p->inStream->Seek(p->inStream, &startOffset, SZ_SEEK_END) != SZ_OK)
+    return SZ_ERROR_NO_ARCHIVE;
+  
+  Xzs_Construct(&xzs);
+  res = Xzs_ReadBackward(&xzs, p->inStream, &startOffset, NULL, p->alloc);
+  if (res == SZ_OK && startOffset != 0)
+    res = SZ_ERROR_NO_ARCHIVE;
+  if (res == SZ_OK)
+    res = XzDecMt_GetBlocks(p, &xzs, &blocks, &numBlocks);
+  Xzs_Free(&xzs, p->alloc);
+  
+  if (res == SZ_OK && numBlocks > 1)
+  {
+    res = XzDecMt_DecodeMt(p, blocks, numBlocks);
+    if (res == SZ_ERROR_MEM && p->outProcessed == 0)
+      res = SZ_ERROR_NO_ARCHIVE;
+  }
+  else
+    res = SZ_ERROR_NO_ARCHIVE;
+  IAlloc_Free(p->alloc, blocks);
+
+  if (res == SZ_ERROR_NO_ARCHIVE)
+  {
+    p->inProcessed = 0;
+    startOffset = 0;
+    RINOK(p->inStream->Seek(p->inStream, &startOffset, SZ_SEEK_SET));
+  }
+  return res;
+}
+
+#endif
+
+static SRes XzDecMt_Decode2(CXzDecMt *p, const CXzDecMtProps *props)
+{
+  #ifndef _7ZIP_ST
+  p->numThreads = props->numThreads;
+  if (p->numThreads > NUM_MT_CODER_THREADS_MAX)
+    p->numThreads = NUM_MT_CODER_THREADS_MAX;
+  p->blockSizeMax = props->blockSizeMax;
+  p->memUsageMax = props->memUsageMax;
+  p->threads = 0;
+  if (p->numThreads > 1)
+  {
+    SRes res = XzDecMt_TryDecodeMt(p);
+    if (res != SZ_ERROR_NO_ARCHIVE)
+      return res;
+  }
+  #else
+  props = props;
+  #endif
+  return XzDecMt_DecodeSeq(p);
+}
+
+SRes XzDecMt_Decode(ISeqOutStream *outStream, ILookInStream *inStream,
+    const CXzDecMtProps *props, ICompressProgress *progress, ISzAlloc *alloc)
+{
+  CXzDecMt p;
+  p.inStream = inStream;
+  p.outStream = outStream;
+  p.dest = 0;
+  p.destSize = 0;
+  p.progress = progress;
+  p.alloc = alloc;
+  p.inProcessed = p.outProcessed = 0;
+  return XzDecMt_Decode2(&p, props);
+}
+
+SRes XzDecMt_DecodeToBuf(Byte *dest, SizeT *destLen, ILookInStream *inStream,
+    const CXzDecMtProps *props, ICompressProgress *progress, ISzAlloc *alloc)
+{
+  CXzDecMt p;
+  SRes res;
+  p.inStream = inStream;
+  p.outStream = 0;
+  p.dest = dest;
+  p.destSize = *destLen;
+  p.progress = progress;
+  p.alloc = alloc;
+  p.inProcessed = p.outProcessed = 0;
+  res = XzDecMt_Decode2(&p, props);
+  *destLen = (SizeT)p.outProcessed;
+  return res;
+}
@@ -14,6 +14,12 @@
 
 #include "XzEnc.h"
 
+#ifndef _7ZIP_ST
+#include "MtCoder.h"
+#else
+#define NUM_MT_CODER_THREADS_MAX 1
+#endif
+
 static void *SzBigAlloc(void *p, size_t size) { p = p; return BigAlloc(size); }
 static void SzBigFree(void *p, void *address) { p = p; BigFree(address); }
 static ISzAlloc g_BigAlloc = { SzBigAlloc, SzBigFree };
@@ -135,8 +141,10 @@ SRes Xz_AddIndexRecord(CXzStream *p, UInt64 unpackSize, UInt64 totalSize, ISzAll
       return SZ_ERROR_MEM;
     if (p->numBlocks != 0)
     {
-      memcpy(blocks, p->blocks, p->numBlocks * sizeof(CXzBlockSizes));
+      size_t numBlocks = p->numBlocks;
+      memcpy(blocks, p->blocks, numBlocks * sizeof(CXzBlockSizes));
       Xz_Free(p, alloc);
+      p->numBlocks = numBlocks;
     }
     p->blocks = blocks;
     p->numBlocksAllocated = num;
@@ -495,3 +503,351 @@ SRes Xz_EncodeEmpty(ISeqOutStream *outStream)
   Xz_Free(&xz, &g_Alloc);
   return res;
 }
+
+/* ---------- Multi-block encoding ---------- */
+
+void XzProps_Init(CXzProps *p)
+{
+  Lzma2EncProps_Init(&p->lzma2Props);
+  p->blockSize = 0;
+  p->numBlockThreads = 1;
+}
+
+typedef struct
+{
+  ISeqInStream p;
+  const Byte *data;
+  size_t rem;
+} CSeqInBuf;
+
+static SRes SeqInBuf_Read(void *pp, void *data, size_t *size)
+{
+  CSeqInBuf *p = (CSeqInBuf *)pp;
+  size_t cur = *size;
+  if (cur > p->rem)
+    cur = p->rem;
+  memcpy(data, p->data, cur);
+  p->data += cur;
+  p->rem -= cur;
+  *size = cur;
+  return SZ_OK;
+}
+
+typedef struct
+{
+  ISeqOutStream p;
+  Byte *data;
+  size_t size;
+  size_t pos;
+} CSeqOutBuf;
+
+static size_t SeqOutBuf_Write(void *pp, const void *data, size_t size)
+{
+  CSeqOutBuf *p = (CSeqOutBuf *)pp;
+  if (size > p->size - p->pos)
+    size = p->size - p->pos;
+  memcpy(p->data + p->pos, data, size);
+  p->pos += size;
+  return size;
+}
+
+/* it converts progress of one block to progress of whole stream */
+
+typedef struct
+{
+  ICompressProgress p;
+  ICompressProgress *progress;
+  UInt64 inPos;
+  UInt64 outPos;
+  #ifndef _7ZIP_ST
+  CMtProgress *mtProgress;
+  unsigned index;
+  #endif
+} CXzBlockProgress;
+
+static SRes XzBlockProgress_Progress(void *pp, UInt64 inSize, UInt64 outSize)
+{
+  CXzBlockProgress *p = (CXzBlockProgress *)pp;
+  #ifndef _7ZIP_ST
+  if (p->mtProgress)
+    return MtProgress_Set(p->mtProgress, p->index, inSize, outSize);
+  #endif
+  if (p->progress && p->progress->Progress(p->progress, p->inPos + inSize, p->outPos + outSize) != SZ_OK)
+    return SZ_ERROR_PROGRESS;
+  return SZ_OK;
+}
+
+/* block header contains packSize and unpackSize,
+   so the index record can be restored from the written block */
+
+#define XZ_CHECK_SIZE_MAX 64
+
+#define XZ_BLOCK_DEST_SIZE(blockSize) ((blockSize) + ((blockSize) >> 10) + 16 + \
+    XZ_BLOCK_HEADER_SIZE_MAX + 3 + XZ_CHECK_SIZE_MAX)
+
+static SRes Xz_EncodeBlock(CLzma2EncHandle lzma2, CXzStreamFlags flags,
+    Byte *dest, size_t *destSize, const Byte *src, size_t srcSize, ICompressProgress *progress)
+{
+  CXzBlock block;
+  CXzCheck check;
+  CSeqInBuf inBuf;
+  CSeqOutBuf outBuf;
+  size_t pos;
+
+  XzBlock_ClearFlags(&block);
+  XzBlock_SetNumFilters(&block, 1);
+  XzBlock_SetHasPackSize(&block);
+  XzBlock_SetHasUnpackSize(&block);
+  block.filters[0].id = XZ_ID_LZMA2;
+  block.filters[0].propsSize = 1;
+  block.filters[0].props[0] = Lzma2Enc_WriteProperties(lzma2);
+
+  inBuf.p.Read = SeqInBuf_Read;
+  inBuf.data = src;
+  inBuf.rem = srcSize;
+
+  /* packed data is written after space for largest header, and then moved to real header end */
+  outBuf.p.Write = SeqOutBuf_Write;
+  outBuf.data = dest + XZ_BLOCK_HEADER_SIZE_MAX;
+  outBuf.size = *destSize - XZ_BLOCK_HEADER_SIZE_MAX - 3 - XZ_CHECK_SIZE_MAX;
+  outBuf.pos = 0;
+  RINOK(Lzma2Enc_Encode(lzma2, &outBuf.p, &inBuf.p, progress));
+  block.packSize = outBuf.pos;
+  block.unpackSize = srcSize;
+
+  outBuf.data = dest;
+  outBuf.size = XZ_BLOCK_HEADER_SIZE_MAX;
+  outBuf.pos = 0;
+  RINOK(XzBlock_WriteHeader(&block, &outBuf.p));
+  memmove(dest + outBuf.pos, dest + XZ_BLOCK_HEADER_SIZE_MAX, (size_t)block.packSize);
+  
+  for (pos = outBuf.pos + (size_t)block.packSize; (pos & 3) != 0; pos++)
+    dest[pos] = 0;
+  XzCheck_Init(&check, XzFlags_GetCheckType(flags));
+  XzCheck_Update(&check, src, srcSize);
+  XzCheck_Final(&check, dest + pos);
+  *destSize = pos + XzFlags_GetCheckSize(flags);
+  return SZ_OK;
+}
+
+/* it writes blocks, one block per call, and adds their records to index */
+
+typedef struct
+{
+  ISeqOutStream p;
+  ISeqOutStream *realStream;
+  CXzStream *xz;
+  SRes res;
+} CSeqBlockOutStream;
+
+static size_t SeqBlockOutStream_Write(void *pp, const void *data, size_t size)
+{
+  CSeqBlockOutStream *p = (CSeqBlockOutStream *)pp;
+  const Byte *buf = (const Byte *)data;
+  CXzBlock block;
+  if (size == 0)
+    return 0;
+  p->res = XzBlock_Parse(&block, buf);
+  if (p->res == SZ_OK)
+    p->res = Xz_AddIndexRecord(p->xz, block.unpackSize,
+        ((UInt64)buf[0] << 2) + 4 + block.packSize + XzFlags_GetCheckSize(p->xz->flags), &g_Alloc);
+  if (p->res != SZ_OK)
+    return 0;
+  return p->realStream->Write(p->realStream, data, size);
+}
+
+typedef struct
+{
+  CXzProps props;
+  size_t blockSize;
+  CXzStream xz;
+  CSeqBlockOutStream outStream;
+  CLzma2EncHandle lzma2[NUM_MT_CODER_THREADS_MAX];
+  CXzBlockProgress progress[NUM_MT_CODER_THREADS_MAX];
+  #ifndef _7ZIP_ST
+  CMtCoder mtCoder;
+  #endif
+} CXzBlocksEnc;
+
+static SRes XzBlocksEnc_Encode1(CXzBlocksEnc *p, ISeqInStream *inStream, ICompressProgress *progress)
+{
+  SRes res = SZ_OK;
+  size_t destBlockSize = XZ_BLOCK_DEST_SIZE(p->blockSize);
+  Byte *inBuf = (Byte *)IAlloc_Alloc(&g_BigAlloc, p->blockSize);
+  Byte *outBuf = (Byte *)IAlloc_Alloc(&g_BigAlloc, destBlockSize);
+  CXzBlockProgress *bp = &p->progress[0];
+
+  bp->progress = progress;
+  bp->inPos = bp->outPos = 0;
+
+  if (inBuf == 0 || outBuf == 0)
+    res = SZ_ERROR_MEM;
+  while (res == SZ_OK)
+  {
+    size_t size = 0;
+    size_t destSize = destBlockSize;
+    while (size < p->blockSize)
+    {
+      size_t cur = p->blockSize - size;
+      res = inStream->Read(inStream, inBuf + size, &cur);
+      if (res != SZ_OK || cur == 0)
+        break;
+      size += cur;
+    }
+    if (res != SZ_OK || size == 0)
+      break;
+    res = Xz_EncodeBlock(p->lzma2[0], p->xz.flags, outBuf, &destSize, inBuf, size, &bp->p);
+    if (res != SZ_OK)
+      break;
+    if (p->outStream.p.Write(&p->outStream.p, outBuf, destSize) != destSize)
+      res = (p->outStream.res != SZ_OK) ? p->outStream.res : SZ_ERROR_WRITE;
+    bp->inPos += size;
+    bp->outPos += destSize;
+    if (size != p->blockSize)
+      break;
+  }
+  IAlloc_Free(&g_BigAlloc, inBuf);
+  IAlloc_Free(&g_BigAlloc, outBuf);
+  return res;
+}
+
+#ifndef _7ZIP_ST
+
+typedef struct
+{
+  IMtCoderCallback funcTable;
+  CXzBlocksEnc *enc;
+} CXzMtCallbackImp;
+
+static SRes XzMtCallbackImp_Code(void *pp, unsigned index, Byte *dest, size_t *destSize,
+      const Byte *src, size_t srcSize, size_t prefixSize, UInt64 srcPos, int finished)
+{
+  CXzBlocksEnc *p = ((CXzMtCallbackImp *)pp)->enc;
+  prefixSize = prefixSize;
+  srcPos = srcPos;
+  finished = finished;
+  if (srcSize == 0)
+  {
+    *destSize = 0;
+    return SZ_OK;
+  }
+  return Xz_EncodeBlock(p->lzma2[index], p->xz.flags, dest, destSize, src, srcSize, &p->progress[index].p);
+}
+
+#endif
+
+static SRes XzBlocksEnc_Encode(CXzBlocksEnc *p, ISeqOutStream *outStream, ISeqInStream *inStream,
+    ICompressProgress *progress)
+{
+  CLzma2EncProps lzma2Props = p->props.lzma2Props;
+  UInt64 blockSize = p->props.blockSize;
+  int numThreads = p->props.numBlockThreads;
+  int i;
+
+  if (numThreads < 1)
+    numThreads = 1;
+  if (numThreads > NUM_MT_CODER_THREADS_MAX)
+    numThreads = NUM_MT_CODER_THREADS_MAX;
+
+  /* each block is encoded by one LZMA2 encoder without LZMA2 block threads */
+  lzma2Props.numBlockThreads = 1;
+  lzma2Props.numTotalThreads = 0;
+  lzma2Props.overlapSize = 0;
+  Lzma2EncProps_Normalize(&lzma2Props);
+  if (blockSize == 0)
+    blockSize = lzma2Props.blockSize;
+  p->blockSize = (size_t)blockSize;
+  if (p->blockSize != blockSize || XZ_BLOCK_DEST_SIZE(p->blockSize) < p->blockSize)
+    return SZ_ERROR_PARAM;
+  if (lzma2Props.lzmaProps.dictSize > blockSize)
+    lzma2Props.lzmaProps.dictSize = (blockSize < (1 << 12)) ? (1 << 12) : (UInt32)blockSize;
+
+  for (i = 0; i < numThreads; i++)
+  {
+    CXzBlockProgress *bp = &p->progress[i];
+    p->lzma2[i] = Lzma2Enc_Create(&g_Alloc, &g_BigAlloc);
+    if (p->lzma2[i] == 0)
+      return SZ_ERROR_MEM;
+    RINOK(Lzma2Enc_SetProps(p->lzma2[i], &lzma2Props));
+    bp->p.Progress = XzBlockProgress_Progress;
+    bp->progress = NULL;
+    #ifndef _7ZIP_ST
+    bp->mtProgress = (numThreads > 1) ? &p->mtCoder.mtProgress : NULL;
+    bp->index = i;
+    #endif
+  }
+
+  p->xz.flags = XZ_CHECK_CRC32;
+  p->outStream.p.Write = SeqBlockOutStream_Write;
+  p->outStream.realStream = outStream;
+  p->outStream.xz = &p->xz;
+  p->outStream.res = SZ_OK;
+
+  RINOK(Xz_WriteHeader(p->xz.flags, outStream));
+
+  #ifndef _7ZIP_ST
+  if (numThreads > 1)
+  {
+    SRes res;
+    CXzMtCallbackImp mtCallback;
+
+    mtCallback.funcTable.Code = XzMtCallbackImp_Code;
+    mtCallback.enc = p;
+
+    p->mtCoder.progress = progress;
+    p->mtCoder.inStream = inStream;
+    p->mtCoder.outStream = &p->outStream.p;
+    p->mtCoder.alloc = &g_BigAlloc;
+    p->mtCoder.mtCallback = &mtCallback.funcTable;
+
+    p->mtCoder.blockSize = p->blockSize;
+    p->mtCoder.destBlockSize = XZ_BLOCK_DEST_SIZE(p->blockSize);
+    p->mtCoder.overlapSize = 0;
+    p->mtCoder.numThreads = numThreads;
+    
+    res = MtCoder_Code(&p->mtCoder);
+    if (res == SZ_ERROR_WRITE && p->outStream.res != SZ_OK)
+      res = p->outStream.res;
+    RINOK(res);
+  }
+  else
+  #endif
+  {
+    RINOK(XzBlocksEnc_Encode1(p, inStream, progress));
+  }
+  return Xz_WriteFooter(&p->xz, outStream);
+}
+
+SRes XzEnc_Encode(ISeqOutStream *outStream, ISeqInStream *inStream,
+    const CXzProps *props, ICompressProgress *progress)
+{
+  SRes res;
+  CXzBlocksEnc *p;
+  int i;
+
+  if (props->blockSize == 0 && props->numBlockThreads <= 1)
+    return Xz_Encode(outStream, inStream, &props->lzma2Props, False, progress);
+
+  p = (CXzBlocksEnc *)IAlloc_Alloc(&g_Alloc, sizeof(CXzBlocksEnc));
+  if (p == 0)
+    return SZ_ERROR_MEM;
+  p->props = *props;
+  Xz_Construct(&p->xz);
+  for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
+    p->lzma2[i] = NULL;
+  #ifndef _7ZIP_ST
+  MtCoder_Construct(&p->mtCoder);
+  #endif
+
+  res = XzBlocksEnc_Encode(p, outStream, inStream, progress);
+
+  #ifndef _7ZIP_ST
+  MtCoder_Destruct(&p->mtCoder);
+  #endif
+  for (i = 0; i < NUM_MT_CODER_THREADS_MAX; i++)
+    if (p->lzma2[i])
+      Lzma2Enc_Destroy(p->lzma2[i]);
+  Xz_Free(&p->xz, &g_Alloc);
+  IAlloc_Free(&g_Alloc, p);
+  return res;
+}
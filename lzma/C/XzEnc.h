@@ -18,6 +18,30 @@ SRes Xz_Encode(ISeqOutStream *outStream, ISeqInStream *inStream,
 
 SRes Xz_EncodeEmpty(ISeqOutStream *outStream);
 
+/* ---------- Multi-block encoding ---------- */
+
+typedef struct
+{
+  CLzma2EncProps lzma2Props;
+  UInt64 blockSize;     /* 0 - default: whole input in one block, if (numBlockThreads <= 1),
+                           else blockSize from normalized lzma2Props */
+  int numBlockThreads;  /* number of blocks that are encoded in parallel, default = 1 */
+} CXzProps;
+
+void XzProps_Init(CXzProps *p);
+
+/*
+XzEnc_Encode
+  If (blockSize != 0) or (numBlockThreads > 1), the input is split to
+  independent blocks of blockSize bytes. Each block is encoded by its own
+  LZMA2 encoder, and block headers and index store the sizes of each block,
+  so the stream can be decoded in parallel or from any block.
+  Otherwise it works as Xz_Encode without Subblock filter.
+*/
+
+SRes XzEnc_Encode(ISeqOutStream *outStream, ISeqInStream *inStream,
+    const CXzProps *props, ICompressProgress *progress);
+
 #ifdef __cplusplus
 }
 #endif
@@ -260,6 +260,50 @@ UInt64 Xzs_GetUnpackSize(const CXzs *p)
   return size;
 }
 
+SRes Xzs_GetBlocks(const CXzs *p, CXzBlockInfo **blocksRes, size_t *numBlocksRes, ISzAlloc *alloc)
+{
+  CXzBlockInfo *blocks;
+  UInt64 numBlocks64 = Xzs_GetNumBlocks(p);
+  UInt64 outPos = 0;
+  size_t numBlocks = (size_t)numBlocks64;
+  size_t i, k = 0;
+
+  *blocksRes = 0;
+  *numBlocksRes = 0;
+  if (numBlocks != numBlocks64 || numBlocks > ((size_t)-1) / sizeof(CXzBlockInfo))
+    return SZ_ERROR_UNSUPPORTED;
+  if (numBlocks == 0)
+    return SZ_OK;
+  blocks = (CXzBlockInfo *)alloc->Alloc(alloc, numBlocks * sizeof(CXzBlockInfo));
+  if (blocks == 0)
+    return SZ_ERROR_MEM;
+  *blocksRes = blocks;
+  *numBlocksRes = numBlocks;
+
+  /* Xzs_ReadBackward stores the last stream first */
+  for (i = p->num; i != 0;)
+  {
+    const CXzStream *st = &p->streams[--i];
+    UInt64 inPos = st->startOffset + XZ_STREAM_HEADER_SIZE;
+    size_t j;
+    for (j = 0; j < st->numBlocks; j++)
+    {
+      const CXzBlockSizes *bs = &st->blocks[j];
+      CXzBlockInfo *b = &blocks[k++];
+      b->inPos = inPos;
+      b->outPos = outPos;
+      b->totalSize = bs->totalSize;
+      b->unpackSize = bs->unpackSize;
+      b->flags = st->flags;
+      inPos += (bs->totalSize + 3) & ~(UInt64)3;
+      if (outPos + bs->unpackSize < outPos)
+        return SZ_ERROR_ARCHIVE;
+      outPos += bs->unpackSize;
+    }
+  }
+  return SZ_OK;
+}
+
 /*
 UInt64 Xzs_GetPackSize(const CXzs *p)
 {
@@ -304,3 +348,189 @@ SRes Xzs_ReadBackward(CXzs *p, ILookInStream *stream, Int64 *startOffset, ICompr
   }
   return SZ_OK;
 }
+
+
+/* ---------- Random access reader ---------- */
+
+void XzReader_Construct(CXzReader *p, ISzAlloc *alloc)
+{
+  unsigned i;
+  p->inStream = 0;
+  p->alloc = alloc;
+  p->blocks = 0;
+  p->numBlocks = 0;
+  p->unpackSize = 0;
+  MixCoder_Construct(&p->decoder, alloc);
+  p->inBuf = 0;
+  p->inBufSize = 0;
+  p->useCounter = 0;
+  p->numCacheItems = 0;
+  for (i = 0; i < XZ_READER_CACHE_MAX; i++)
+  {
+    CXzReaderCacheItem *item = &p->cache[i];
+    item->data = 0;
+    item->size = 0;
+    item->blockIndex = (size_t)-1;
+  }
+}
+
+void XzReader_Free(CXzReader *p)
+{
+  unsigned i;
+  for (i = 0; i < XZ_READER_CACHE_MAX; i++)
+  {
+    CXzReaderCacheItem *item = &p->cache[i];
+    p->alloc->Free(p->alloc, item->data);
+    item->data = 0;
+    item->size = 0;
+    item->blockIndex = (size_t)-1;
+  }
+  MixCoder_Free(&p->decoder);
+  MixCoder_Construct(&p->decoder, p->alloc);
+  p->alloc->Free(p->alloc, p->inBuf);
+  p->inBuf = 0;
+  p->inBufSize = 0;
+  p->alloc->Free(p->alloc, p->blocks);
+  p->blocks = 0;
+  p->numBlocks = 0;
+  p->unpackSize = 0;
+}
+
+SRes XzReader_Open(CXzReader *p, ILookInStream *inStream, unsigned numCacheBlocks)
+{
+  CXzs xzs;
+  Int64 startOffset;
+  SRes res;
+
+  XzReader_Free(p);
+  if (numCacheBlocks == 0)
+    numCacheBlocks = 1;
+  if (numCacheBlocks > XZ_READER_CACHE_MAX)
+    numCacheBlocks = XZ_READER_CACHE_MAX;
+  p->numCacheItems = numCacheBlocks;
+  p->inStream = inStream;
+
+  Xzs_Construct(&xzs);
+  res = Xzs_ReadBackward(&xzs, inStream, &startOffset, NULL, p->alloc);
+  /* the streams must cover the whole file: if some data before them is not a valid
+     stream, the offsets of blocks would not match the unpacked data */
+  if (res == SZ_OK && startOffset != 0)
+    res = SZ_ERROR_NO_ARCHIVE;
+  if (res == SZ_OK)
+    res = Xzs_GetBlocks(&xzs, &p->blocks, &p->numBlocks, p->alloc);
+  Xzs_Free(&xzs, p->alloc);
+  if (res == SZ_OK && p->numBlocks != 0)
+  {
+    const CXzBlockInfo *last = &p->blocks[p->numBlocks - 1];
+    p->unpackSize = last->outPos + last->unpackSize;
+  }
+  return res;
+}
+
+static size_t XzReader_FindBlock(const CXzReader *p, UInt64 offset)
+{
+  size_t left = 0, right = p->numBlocks;
+  while (right - left > 1)
+  {
+    size_t mid = (left + right) / 2;
+    if (offset < p->blocks[mid].outPos)
+      right = mid;
+    else
+      left = mid;
+  }
+  return left;
+}
+
+static SRes XzReader_GetBlock(CXzReader *p, size_t blockIndex, const Byte **data)
+{
+  const CXzBlockInfo *b = &p->blocks[blockIndex];
+  CXzReaderCacheItem *item = &p->cache[0];
+  size_t inSize, outSize;
+  unsigned i;
+  SRes res;
+
+  p->useCounter++;
+  for (i = 0; i < p->numCacheItems; i++)
+  {
+    CXzReaderCacheItem *cur = &p->cache[i];
+    if (cur->blockIndex == blockIndex)
+    {
+      cur->lastUse = p->useCounter;
+      *data = cur->data;
+      return SZ_OK;
+    }
+    if (cur->blockIndex == (size_t)-1)
+    {
+      if (item->blockIndex != (size_t)-1)
+        item = cur;
+    }
+    else if (item->blockIndex != (size_t)-1 && cur->lastUse < item->lastUse)
+      item = cur;
+  }
+
+  inSize = (size_t)((b->totalSize + 3) & ~(UInt64)3);
+  outSize = (size_t)b->unpackSize;
+  if (inSize != ((b->totalSize + 3) & ~(UInt64)3) || outSize != b->unpackSize)
+    return SZ_ERROR_UNSUPPORTED;
+
+  item->blockIndex = (size_t)-1;
+  if (item->size < outSize || item->data == 0)
+  {
+    p->alloc->Free(p->alloc, item->data);
+    item->size = 0;
+    item->data = (Byte *)p->alloc->Alloc(p->alloc, outSize == 0 ? 1 : outSize);
+    if (item->data == 0)
+      return SZ_ERROR_MEM;
+    item->size = outSize;
+  }
+  if (p->inBufSize < inSize)
+  {
+    p->alloc->Free(p->alloc, p->inBuf);
+    p->inBufSize = 0;
+    p->inBuf = (Byte *)p->alloc->Alloc(p->alloc, inSize);
+    if (p->inBuf == 0)
+      return SZ_ERROR_MEM;
+    p->inBufSize = inSize;
+  }
+
+  RINOK(LookInStream_SeekTo(p->inStream, b->inPos));
+  RINOK(LookInStream_Read2(p->inStream, p->inBuf, inSize, SZ_ERROR_INPUT_EOF));
+  res = XzDec_DecodeBlock(&p->decoder, b->flags, item->data, outSize, p->inBuf, (SizeT)b->totalSize);
+  if (res != SZ_OK)
+    return res;
+  item->blockIndex = blockIndex;
+  item->lastUse = p->useCounter;
+  *data = item->data;
+  return SZ_OK;
+}
+
+SRes XzReader_Read(CXzReader *p, UInt64 offset, Byte *dest, size_t *size)
+{
+  size_t rem = *size;
+  *size = 0;
+  if (offset >= p->unpackSize)
+    return SZ_OK;
+  {
+    size_t blockIndex = XzReader_FindBlock(p, offset);
+    while (rem != 0 && blockIndex < p->numBlocks)
+    {
+      const CXzBlockInfo *b = &p->blocks[blockIndex];
+      UInt64 pos = offset - b->outPos;
+      if (pos < b->unpackSize)
+      {
+        const Byte *data;
+        size_t cur = rem;
+        if (cur > b->unpackSize - pos)
+          cur = (size_t)(b->unpackSize - pos);
+        RINOK(XzReader_GetBlock(p, blockIndex, &data));
+        memcpy(dest, data + (size_t)pos, cur);
+        dest += cur;
+        offset += cur;
+        rem -= cur;
+        *size += cur;
+      }
+      blockIndex++;
+    }
+  }
+  return SZ_OK;
+}
@@ -4,6 +4,7 @@
 
 #include "../../../../C/CpuArch.h"
 
+#include "../../Common/InOutTempBuffer.h"
 #include "../../Common/LimitedStreams.h"
 #include "../../Common/ProgressUtils.h"
 
@@ -27,6 +28,7 @@ namespace N7z {
 static const UInt64 k_LZMA = 0x030101;
 static const UInt64 k_BCJ  = 0x03030103;
 static const UInt64 k_BCJ2 = 0x0303011B;
+static const UInt64 k_PPMD = 0x030401;
 
 static const wchar_t *kMatchFinderForBCJ2_LZMA = L"BT2";
 static const UInt32 kDictionaryForBCJ2_LZMA = 1 << 20;
@@ -636,6 +638,226 @@ void CThreadDecoder::Execute()
   FosSpec->ReleaseOutStream();
 }
 
+#ifndef _7ZIP_ST
+
+/*
+PPMd keeps one model for the whole stream, so one PPMd coder can't use more
+than one thread. For multithreaded PPMd we split the solid block into segments
+(whole files) and code each segment to separate folder in its own thread.
+Each thread reads the files of its segment itself. The oldest running segment
+is written directly to archive, and it reports the progress. Next segments are
+written to temp buffers (memory block, then temp file) and they are copied to
+archive when all previous segments are finished.
+*/
+
+static const UInt64 kPpmdSegmentSizeMin = (UInt64)1 << 24;
+static const UInt64 kPpmdSegmentSizeMax = (UInt64)1 << 28;
+
+static bool IsPpmdMethod(const CCompressionMethodMode &method)
+{
+  for (int i = 0; i < method.Methods.Size(); i++)
+    if (method.Methods[i].Id == k_PPMD)
+      return true;
+  return false;
+}
+
+// all calls to IArchiveUpdateCallback from encoding threads go through one critical section
+
+class CLockedSequentialInStream:
+  public ISequentialInStream,
+  public CMyUnknownImp
+{
+  CMyComPtr<ISequentialInStream> _stream;
+  NWindows::NSynchronization::CCriticalSection *_cs;
+public:
+  void Init(ISequentialInStream *stream, NWindows::NSynchronization::CCriticalSection *cs)
+  {
+    _stream = stream;
+    _cs = cs;
+  }
+  MY_UNKNOWN_IMP
+  STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize);
+};
+
+STDMETHODIMP CLockedSequentialInStream::Read(void *data, UInt32 size, UInt32 *processedSize)
+{
+  NWindows::NSynchronization::CCriticalSectionLock lock(*_cs);
+  return _stream->Read(data, size, processedSize);
+}
+
+class CLockedProgress:
+  public ICompressProgressInfo,
+  public CMyUnknownImp
+{
+  CMyComPtr<ICompressProgressInfo> _progress;
+  NWindows::NSynchronization::CCriticalSection *_cs;
+public:
+  void Init(ICompressProgressInfo *progress, NWindows::NSynchronization::CCriticalSection *cs)
+  {
+    _progress = progress;
+    _cs = cs;
+  }
+  MY_UNKNOWN_IMP
+  STDMETHOD(SetRatioInfo)(const UInt64 *inSize, const UInt64 *outSize);
+};
+
+STDMETHODIMP CLockedProgress::SetRatioInfo(const UInt64 *inSize, const UInt64 *outSize)
+{
+  NWindows::NSynchronization::CCriticalSectionLock lock(*_cs);
+  return _progress->SetRatioInfo(inSize, outSize);
+}
+
+class CThreadEncoder: public CVirtThread
+{
+public:
+  HRESULT Result;
+  CEncoder *Encoder;
+  UInt64 InSizeForReduce;
+
+  CFolderInStream *InStreamSpec;
+  CMyComPtr<ISequentialInStream> InStream;
+  CMyComPtr<ISequentialOutStream> OutStream;
+  CMyComPtr<ICompressProgressInfo> Progress;
+  CInOutTempBuffer *TempBuf; // NULL, if segment is written directly to archive
+
+  CFolder Folder;
+  CRecordVector<UInt64> PackSizes;
+  int StartIndex;
+  int NumSubFiles;
+
+  DECL_EXTERNAL_CODECS_VARS
+
+  CThreadEncoder(): Result(E_FAIL), Encoder(NULL), InSizeForReduce(0), TempBuf(NULL), StartIndex(0), NumSubFiles(0) {}
+  ~CThreadEncoder() { delete TempBuf; delete Encoder; }
+  void FreeSegment()
+  {
+    InStream.Release();
+    OutStream.Release();
+    Progress.Release();
+    delete TempBuf;
+    TempBuf = NULL;
+  }
+  virtual void Execute();
+};
+
+void CThreadEncoder::Execute()
+{
+  try
+  {
+    PackSizes.Clear();
+    Folder = CFolder();
+    Result = Encoder->Encode(
+      EXTERNAL_CODECS_VARS
+      InStream, NULL, &InSizeForReduce, Folder,
+      OutStream, PackSizes, Progress);
+  }
+  catch(...)
+  {
+    Result = E_FAIL;
+  }
+}
+
+struct CThreadEncoders
+{
+  CThreadEncoder *Items;
+  UInt32 Num;
+  NWindows::NSynchronization::CCriticalSection CS;
+
+  CThreadEncoders(): Items(NULL), Num(0) {}
+  ~CThreadEncoders() { delete []Items; }
+  HRESULT Create(UInt32 numThreads, const CCompressionMethodMode &method)
+  {
+    Items = new CThreadEncoder[numThreads];
+    Num = numThreads;
+    for (UInt32 i = 0; i < numThreads; i++)
+    {
+      Items[i].Encoder = new CEncoder(method);
+      RINOK(Items[i].Create());
+    }
+    return S_OK;
+  }
+};
+
+#endif
+
+static int GetNumSubFiles(const CObjectVector<CUpdateItem> &updateItems,
+    const CRecordVector<UInt32> &indices, int startIndex,
+    UInt64 numSolidFiles, UInt64 numSolidBytes, bool solidExtension)
+{
+  UInt64 totalSize = 0;
+  int numSubFiles;
+  UString prevExtension;
+  for (numSubFiles = 0; startIndex + numSubFiles < indices.Size() &&
+      numSubFiles < numSolidFiles; numSubFiles++)
+  {
+    const CUpdateItem &ui = updateItems[indices[startIndex + numSubFiles]];
+    totalSize += ui.Size;
+    if (totalSize > numSolidBytes)
+      break;
+    if (solidExtension)
+    {
+      UString ext = ui.GetExtension();
+      if (numSubFiles == 0)
+        prevExtension = ext;
+      else
+        if (ext.CompareNoCase(prevExtension) != 0)
+          break;
+    }
+  }
+  if (numSubFiles < 1)
+    numSubFiles = 1;
+  return numSubFiles;
+}
+
+static HRESULT AddFolderFiles(const CArchiveDatabaseEx *db,
+    const CObjectVector<CUpdateItem> &updateItems,
+    const UInt32 *indices, int numSubFiles,
+    const CFolderInStream &inStream, CArchiveDatabase &newDatabase)
+{
+  CNum numUnpackStreams = 0;
+  for (int subIndex = 0; subIndex < numSubFiles; subIndex++)
+  {
+    const CUpdateItem &ui = updateItems[indices[subIndex]];
+    CFileItem file;
+    CFileItem2 file2;
+    if (ui.NewProps)
+      FromUpdateItemToFileItem(ui, file, file2);
+    else
+      db->GetFile(ui.IndexInArchive, file, file2);
+    if (file2.IsAnti || file.IsDir)
+      return E_FAIL;
+    
+    /*
+    CFileItem &file = newDatabase.Files[
+          startFileIndexInDatabase + i + subIndex];
+    */
+    if (!inStream.Processed[subIndex])
+    {
+      continue;
+      // file.Name += L".locked";
+    }
+
+    file.Crc = inStream.CRCs[subIndex];
+    file.Size = inStream.Sizes[subIndex];
+    if (file.Size != 0)
+    {
+      file.CrcDefined = true;
+      file.HasStream = true;
+      numUnpackStreams++;
+    }
+    else
+    {
+      file.CrcDefined = false;
+      file.HasStream = false;
+    }
+    newDatabase.AddFile(file, file2);
+  }
+  // numUnpackStreams = 0 is very bad case for locked files
+  // v3.13 doesn't understand it.
+  newDatabase.NumUnpackStreamsVector.Add(numUnpackStreams);
+  return S_OK;
+}
+
 bool static Is86FilteredFolder(const CFolder &f)
 {
   for (int i = 0; i < f.Coders.Size(); i++)
@@ -1039,30 +1261,115 @@ HRESULT Update(
       */
     }
     
-    for (i = 0; i < numFiles;)
+    UInt64 numSolidBytes = options.NumSolidBytes;
+    #ifndef _7ZIP_ST
+    CThreadEncoders threads;
+    if (method.NumThreads > 1 && IsPpmdMethod(method))
     {
       UInt64 totalSize = 0;
-      int numSubFiles;
-      UString prevExtension;
-      for (numSubFiles = 0; i + numSubFiles < numFiles &&
-          numSubFiles < numSolidFiles; numSubFiles++)
+      for (i = 0; i < numFiles; i++)
+        totalSize += updateItems[indices[i]].Size;
+      UInt64 segmentSize = totalSize / method.NumThreads + 1;
+      if (segmentSize < kPpmdSegmentSizeMin)
+        segmentSize = kPpmdSegmentSizeMin;
+      if (segmentSize > kPpmdSegmentSizeMax)
+        segmentSize = kPpmdSegmentSizeMax;
+      if (numSolidBytes > segmentSize)
+        numSolidBytes = segmentSize;
+      if (totalSize > numSolidBytes)
       {
-        const CUpdateItem &ui = updateItems[indices[i + numSubFiles]];
-        totalSize += ui.Size;
-        if (totalSize > options.NumSolidBytes)
-          break;
-        if (options.SolidExtension)
+        CCompressionMethodMode threadMethod = method;
+        threadMethod.NumThreads = 1;
+        RINOK(threads.Create(method.NumThreads, threadMethod));
+        for (UInt32 t = 0; t < threads.Num; t++)
         {
-          UString ext = ui.GetExtension();
-          if (numSubFiles == 0)
-            prevExtension = ext;
-          else
-            if (ext.CompareNoCase(prevExtension) != 0)
-              break;
+          #ifdef EXTERNAL_CODECS
+          threads.Items[t]._codecsInfo = codecsInfo;
+          threads.Items[t]._externalCodecs = *externalCodecs;
+          #endif
+          threads.Items[t].InSizeForReduce = inSizeForReduce;
+        }
+      }
+    }
+    #endif
+
+    for (i = 0; i < numFiles;)
+    {
+      #ifndef _7ZIP_ST
+      if (threads.Num != 0)
+      {
+        // ---------- PPMd segments: segment (k) is coded in thread (k % threads.Num) ----------
+        HRESULT res = S_OK;
+        UInt32 firstSegment = 0, nextSegment = 0;
+        for (;;)
+        {
+          while (res == S_OK && i < numFiles && nextSegment - firstSegment < threads.Num)
+          {
+            int numSubFiles = GetNumSubFiles(updateItems, indices, i, numSolidFiles, numSolidBytes, options.SolidExtension);
+            CThreadEncoder &t = threads.Items[nextSegment % threads.Num];
+            t.StartIndex = i;
+            t.NumSubFiles = numSubFiles;
+            t.InStreamSpec = new CFolderInStream;
+            CMyComPtr<ISequentialInStream> folderInStream = t.InStreamSpec;
+            t.InStreamSpec->Init(updateCallback, &indices[i], numSubFiles);
+            CLockedSequentialInStream *lockedInStreamSpec = new CLockedSequentialInStream;
+            t.InStream = lockedInStreamSpec;
+            lockedInStreamSpec->Init(folderInStream, &threads.CS);
+            if (nextSegment == firstSegment)
+            {
+              t.OutStream = archive.SeqStream;
+              CLockedProgress *lockedProgressSpec = new CLockedProgress;
+              t.Progress = lockedProgressSpec;
+              lockedProgressSpec->Init(progress, &threads.CS);
+            }
+            else
+            {
+              t.TempBuf = new CInOutTempBuffer;
+              t.TempBuf->Create();
+              t.TempBuf->InitWriting();
+              CSequentialOutTempBufferImp *tempBufStreamSpec = new CSequentialOutTempBufferImp;
+              t.OutStream = tempBufStreamSpec;
+              tempBufStreamSpec->Init(t.TempBuf);
+            }
+            t.Start();
+            nextSegment++;
+            i += numSubFiles;
+          }
+          
+          // all started threads must be finished before return
+          if (firstSegment == nextSegment)
+            break;
+          CThreadEncoder &t = threads.Items[firstSegment % threads.Num];
+          firstSegment++;
+          t.WaitFinish();
+          if (res == S_OK)
+            res = t.Result;
+          if (res == S_OK && t.TempBuf)
+            res = t.TempBuf->WriteToStream(archive.SeqStream);
+          if (res == S_OK)
+          {
+            for (int j = 0; j < t.PackSizes.Size(); j++)
+            {
+              newDatabase.PackSizes.Add(t.PackSizes[j]);
+              lps->OutSize += t.PackSizes[j];
+            }
+            lps->InSize += t.Folder.GetUnpackSize();
+            newDatabase.Folders.Add(t.Folder);
+            res = AddFolderFiles(db, updateItems, &indices[t.StartIndex], t.NumSubFiles, *t.InStreamSpec, newDatabase);
+          }
+          if (res == S_OK)
+          {
+            NWindows::NSynchronization::CCriticalSectionLock lock(threads.CS);
+            res = lps->SetCur();
+          }
+          t.FreeSegment();
         }
+        RINOK(res);
+        continue;
       }
-      if (numSubFiles < 1)
-        numSubFiles = 1;
+      #endif
+
+      int numSubFiles = GetNumSubFiles(updateItems, indices, i, numSolidFiles, numSolidBytes, options.SolidExtension);
 
       CFolderInStream *inStreamSpec = new CFolderInStream;
       CMyComPtr<ISequentialInStream> solidInStream(inStreamSpec);
@@ -1086,47 +1393,7 @@ HRESULT Update(
       
       newDatabase.Folders.Add(folderItem);
       
-      CNum numUnpackStreams = 0;
-      for (int subIndex = 0; subIndex < numSubFiles; subIndex++)
-      {
-        const CUpdateItem &ui = updateItems[indices[i + subIndex]];
-        CFileItem file;
-        CFileItem2 file2;
-        if (ui.NewProps)
-          FromUpdateItemToFileItem(ui, file, file2);
-        else
-          db->GetFile(ui.IndexInArchive, file, file2);
-        if (file2.IsAnti || file.IsDir)
-          return E_FAIL;
-        
-        /*
-        CFileItem &file = newDatabase.Files[
-              startFileIndexInDatabase + i + subIndex];
-        */
-        if (!inStreamSpec->Processed[subIndex])
-        {
-          continue;
-          // file.Name += L".locked";
-        }
-
-        file.Crc = inStreamSpec->CRCs[subIndex];
-        file.Size = inStreamSpec->Sizes[subIndex];
-        if (file.Size != 0)
-        {
-          file.CrcDefined = true;
-          file.HasStream = true;
-          numUnpackStreams++;
-        }
-        else
-        {
-          file.CrcDefined = false;
-          file.HasStream = false;
-        }
-        newDatabase.AddFile(file, file2);
-      }
-      // numUnpackStreams = 0 is very bad case for locked files
-      // v3.13 doesn't understand it.
-      newDatabase.NumUnpackStreamsVector.Add(numUnpackStreams);
+      RINOK(AddFolderFiles(db, updateItems, &indices[i], numSubFiles, *inStreamSpec, newDatabase));
       i += numSubFiles;
     }
   }
@@ -3,12 +3,17 @@
 #include "StdAfx.h"
 
 #include "../../../C/Alloc.h"
+#include "../../../C/Sha256.h"
 #include "../../../C/XzCrc64.h"
 #include "../../../C/XzEnc.h"
 
 #include "../../Common/ComTry.h"
 #include "../../Common/IntToString.h"
 
+#ifndef _7ZIP_ST
+#include "../../Windows/System.h"
+#endif
+
 #include "../ICoder.h"
 
 #include "../Common/CWrappers.h"
@@ -39,6 +44,7 @@ namespace NArchive {
 namespace NXz {
 
 struct CCrc64Gen { CCrc64Gen() { Crc64GenerateTable(); } } g_Crc64TableInit;
+struct CSha256Prep { CSha256Prep() { Sha256Prepare(); } } g_Sha256Prepare;
 
 class CHandler:
   public IInArchive,
@@ -71,6 +77,9 @@ class CHandler:
   }
 
   HRESULT Open2(IInStream *inStream, IArchiveOpenCallback *callback);
+  #ifndef _7ZIP_ST
+  HRESULT DecodeMt(ISequentialOutStream *outStream, ICompressProgressInfo *progress, SRes &res);
+  #endif
 
 public:
   MY_QUERYINTERFACE_BEGIN2(IInArchive)
@@ -448,6 +457,42 @@ struct CXzUnpackerCPP
   }
 };
 
+#ifndef _7ZIP_ST
+
+HRESULT CHandler::DecodeMt(ISequentialOutStream *outStream, ICompressProgressInfo *progress, SRes &res)
+{
+  CSeekInStreamWrap inStreamImp(_stream);
+
+  CLookToRead lookStream;
+  LookToRead_CreateVTable(&lookStream, True);
+  lookStream.realStream = &inStreamImp.p;
+  LookToRead_Init(&lookStream);
+
+  CSeqOutStreamWrap outStreamWrap(outStream);
+  CCompressProgressWrap progressWrap(progress);
+
+  CXzDecMtProps props;
+  XzDecMtProps_Init(&props);
+  #ifndef EXTRACT_ONLY
+  props.numThreads = _numThreads;
+  #else
+  props.numThreads = NSystem::GetNumberOfProcessors();
+  #endif
+  // each thread holds whole packed and unpacked blocks (up to blockSizeMax each)
+  props.memUsageMax = NSystem::GetRamSize() / 2;
+
+  res = XzDecMt_Decode(&outStreamWrap.p, &lookStream.s, &props, &progressWrap.p, &g_Alloc);
+  if (res == SZ_ERROR_READ && inStreamImp.Res != S_OK)
+    return inStreamImp.Res;
+  if (res == SZ_ERROR_WRITE && outStreamWrap.Res != S_OK)
+    return outStreamWrap.Res;
+  if (res == SZ_ERROR_PROGRESS && progressWrap.Res != S_OK)
+    return progressWrap.Res;
+  return S_OK;
+}
+
+#endif
+
 STDMETHODIMP CHandler::Extract(const UInt32 *indices, UInt32 numItems,
     Int32 testMode, IArchiveExtractCallback *extractCallback)
 {
@@ -491,16 +536,27 @@ STDMETHODIMP CHandler::Extract(const UInt32 *indices, UInt32 numItems,
   UInt32 inPos = 0;
   UInt32 inSize = 0;
   UInt32 outPos = 0;
+  bool useSeq = true;
   CXzUnpackerCPP xzu;
   res = XzUnpacker_Create(&xzu.p, &g_Alloc);
-  if (res == SZ_OK)
+
+  #ifndef _7ZIP_ST
+  if (res == SZ_OK && !_useSeq)
+  {
+    // the index gives the position of each block, so blocks are decoded in parallel
+    useSeq = false;
+    RINOK(DecodeMt(realOutStream, progress, res));
+  }
+  #endif
+
+  if (res == SZ_OK && useSeq)
   {
     xzu.InBuf = (Byte *)MyAlloc(kInBufSize);
     xzu.OutBuf = (Byte *)MyAlloc(kOutBufSize);
     if (xzu.InBuf == 0 || xzu.OutBuf == 0)
       res = SZ_ERROR_MEM;
   }
-  if (res == SZ_OK)
+  if (res == SZ_OK && useSeq)
   for (;;)
   {
     if (inPos == inSize)
@@ -657,16 +713,26 @@ STDMETHODIMP CHandler::UpdateItems(ISequentialOutStream *outStream, UInt32 numIt
       }
     }
 
+    CXzProps xzProps;
+    XzProps_Init(&xzProps);
+
     #ifndef _7ZIP_ST
     lzma2Props.numTotalThreads = _numThreads;
+    Lzma2EncProps_Normalize(&lzma2Props);
+    // threads encode independent xz blocks, so the archive can be decoded in parallel too
+    xzProps.numBlockThreads = lzma2Props.numBlockThreads;
+    lzma2Props.numBlockThreads = 1;
+    lzma2Props.numTotalThreads = 0;
     #endif
 
+    xzProps.lzma2Props = lzma2Props;
+
     CLocalProgress *lps = new CLocalProgress;
     CMyComPtr<ICompressProgressInfo> progress = lps;
     lps->Init(updateCallback, true);
 
     CCompressProgressWrap progressWrap(progress);
-    SRes res = Xz_Encode(&seqOutStream.p, &seqInStream.p, &lzma2Props, False, &progressWrap.p);
+    SRes res = XzEnc_Encode(&seqOutStream.p, &seqInStream.p, &xzProps, &progressWrap.p);
     if (res == SZ_OK)
       return updateCallback->SetOperationResult(NArchive::NUpdate::NOperationResult::kOK);
     return SResToHRESULT(res);
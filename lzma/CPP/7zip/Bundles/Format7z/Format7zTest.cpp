@@ -0,0 +1,403 @@
+// Format7zTest.cpp
+
+/*
+Usage: 7zTest [maxThreads]
+
+Creates a solid PPMd 7z archive in memory with 1 .. maxThreads (default 3)
+threads, reads it back with the 7z handler and compares the data of files.
+With more than one thread the update code must split the solid block into
+several independent PPMd folders ("mt" option). The update callback checks
+that its calls don't overlap and that the progress is reported in order.
+*/
+
+#include "StdAfx.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../Common/MyInitGuid.h"
+
+#include "../../../Common/MyCom.h"
+#include "../../../Common/DynamicBuffer.h"
+#include "../../../Common/IntToString.h"
+#include "../../../Common/StringToInt.h"
+
+#include "../../../Windows/PropVariant.h"
+#include "../../../Windows/Synchronization.h"
+
+#include "../../Common/StreamObjects.h"
+
+#include "../../Archive/7z/7zHandler.h"
+
+using namespace NWindows;
+
+static const UInt32 kNumFiles = 17;
+static const UInt32 kFileSize = (UInt32)1 << 21;
+
+class CMemOutStream:
+  public IOutStream,
+  public CMyUnknownImp
+{
+  size_t _pos;
+public:
+  CByteDynamicBuffer Buf;
+  size_t Size;
+
+  CMemOutStream(): _pos(0), Size(0) {}
+  MY_UNKNOWN_IMP1(IOutStream)
+  STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize);
+  STDMETHOD(Seek)(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition);
+  STDMETHOD(SetSize)(UInt64 newSize);
+};
+
+STDMETHODIMP CMemOutStream::Write(const void *data, UInt32 size, UInt32 *processedSize)
+{
+  Buf.EnsureCapacity(_pos + size);
+  memcpy((Byte *)Buf + _pos, data, size);
+  _pos += size;
+  if (_pos > Size)
+    Size = _pos;
+  if (processedSize)
+    *processedSize = size;
+  return S_OK;
+}
+
+STDMETHODIMP CMemOutStream::Seek(Int64 offset, UInt32 seekOrigin, UInt64 *newPosition)
+{
+  switch(seekOrigin)
+  {
+    case STREAM_SEEK_SET: break;
+    case STREAM_SEEK_CUR: offset += _pos; break;
+    case STREAM_SEEK_END: offset += Size; break;
+    default: return STG_E_INVALIDFUNCTION;
+  }
+  if (offset < 0)
+    return STG_E_INVALIDFUNCTION;
+  _pos = (size_t)offset;
+  if (newPosition)
+    *newPosition = _pos;
+  return S_OK;
+}
+
+STDMETHODIMP CMemOutStream::SetSize(UInt64 newSize)
+{
+  Buf.EnsureCapacity((size_t)newSize);
+  Size = (size_t)newSize;
+  return S_OK;
+}
+
+// Items: kNumFiles files with data, one empty file, one directory
+
+struct CTestItems
+{
+  CByteBuffer Data;
+  UInt32 NumItems() const { return kNumFiles + 2; }
+  bool IsDir(UInt32 index) const { return index == kNumFiles + 1; }
+  UInt32 GetSize(UInt32 index) const { return index < kNumFiles ? kFileSize : 0; }
+  const Byte *GetData(UInt32 index) const { return (const Byte *)Data + (size_t)index * kFileSize; }
+  UInt64 GetTotalSize() const { return (UInt64)kNumFiles * kFileSize; }
+  void Generate();
+};
+
+void CTestItems::Generate()
+{
+  // words from small vocabulary: PPMd compresses it well and fast
+  static const char *kWords[] = { "the", "stream", "of", "model", "context",
+      "symbol", "order", "range", "coder", "7z", "folder", "solid", "block" };
+  const size_t size = (size_t)kNumFiles * kFileSize;
+  Data.SetCapacity(size);
+  UInt32 seed = 1;
+  size_t pos = 0;
+  while (pos < size)
+  {
+    seed = seed * 1103515245 + 12345;
+    const char *word = kWords[(seed >> 16) % (sizeof(kWords) / sizeof(kWords[0]))];
+    for (; *word != 0 && pos < size; word++)
+      Data[pos++] = (Byte)*word;
+    if (pos < size)
+      Data[pos++] = (Byte)(((seed >> 8) & 15) == 0 ? '\n' : ' ');
+  }
+}
+
+class CUpdateCallback:
+  public IArchiveUpdateCallback,
+  public CMyUnknownImp
+{
+  const CTestItems *_items;
+  NSynchronization::CCriticalSection _cs;
+  unsigned _numCallsInside;
+  void EnterCall()
+  {
+    NSynchronization::CCriticalSectionLock lock(_cs);
+    if (++_numCallsInside != 1)
+      NumOverlappedCalls++;
+  }
+  void LeaveCall()
+  {
+    NSynchronization::CCriticalSectionLock lock(_cs);
+    _numCallsInside--;
+  }
+public:
+  unsigned NumOverlappedCalls;
+  unsigned NumProgressCalls;
+  UInt64 Completed;
+  bool ProgressError;
+
+  CUpdateCallback(const CTestItems *items): _items(items), _numCallsInside(0),
+      NumOverlappedCalls(0), NumProgressCalls(0), Completed(0), ProgressError(false) {}
+  MY_UNKNOWN_IMP
+  INTERFACE_IArchiveUpdateCallback(;)
+};
+
+STDMETHODIMP CUpdateCallback::SetTotal(UInt64 /* size */) { return S_OK; }
+
+STDMETHODIMP CUpdateCallback::SetCompleted(const UInt64 *completeValue)
+{
+  EnterCall();
+  if (completeValue)
+  {
+    if (*completeValue < Completed)
+      ProgressError = true;
+    Completed = *completeValue;
+    NumProgressCalls++;
+  }
+  LeaveCall();
+  return S_OK;
+}
+
+STDMETHODIMP CUpdateCallback::GetUpdateItemInfo(UInt32 /* index */,
+    Int32 *newData, Int32 *newProperties, UInt32 *indexInArchive)
+{
+  if (newData)
+    *newData = 1;
+  if (newProperties)
+    *newProperties = 1;
+  if (indexInArchive)
+    *indexInArchive = (UInt32)-1;
+  return S_OK;
+}
+
+STDMETHODIMP CUpdateCallback::GetProperty(UInt32 index, PROPID propID, PROPVARIANT *value)
+{
+  NCOM::CPropVariant prop;
+  switch(propID)
+  {
+    case kpidPath:
+    {
+      wchar_t temp[16];
+      ConvertUInt32ToString(index, temp);
+      UString name = (_items->IsDir(index) ? L"dir" : L"file");
+      name += temp;
+      prop = name;
+      break;
+    }
+    case kpidIsDir: prop = _items->IsDir(index); break;
+    case kpidSize: prop = (UInt64)_items->GetSize(index); break;
+    case kpidIsAnti: prop = false; break;
+  }
+  prop.Detach(value);
+  return S_OK;
+}
+
+STDMETHODIMP CUpdateCallback::GetStream(UInt32 index, ISequentialInStream **inStream)
+{
+  *inStream = NULL;
+  if (_items->IsDir(index))
+    return S_OK;
+  EnterCall();
+  CBufInStream *streamSpec = new CBufInStream;
+  CMyComPtr<ISequentialInStream> stream = streamSpec;
+  streamSpec->Init(_items->GetData(index), _items->GetSize(index));
+  *inStream = stream.Detach();
+  LeaveCall();
+  return S_OK;
+}
+
+STDMETHODIMP CUpdateCallback::SetOperationResult(Int32 /* operationResult */)
+{
+  EnterCall();
+  LeaveCall();
+  return S_OK;
+}
+
+// compares the extracted data with the data of item
+
+class CCompareOutStream:
+  public ISequentialOutStream,
+  public CMyUnknownImp
+{
+  const Byte *_data;
+  UInt32 _size;
+public:
+  UInt32 Pos;
+  bool Error;
+  CCompareOutStream(const Byte *data, UInt32 size): _data(data), _size(size), Pos(0), Error(false) {}
+  MY_UNKNOWN_IMP
+  STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize);
+};
+
+STDMETHODIMP CCompareOutStream::Write(const void *data, UInt32 size, UInt32 *processedSize)
+{
+  if (size > _size - Pos || memcmp(_data + Pos, data, size) != 0)
+    Error = true;
+  else
+    Pos += size;
+  if (processedSize)
+    *processedSize = size;
+  return S_OK;
+}
+
+// the handler sorts the files, so items are found by the number in their names
+
+class CExtractCallback:
+  public IArchiveExtractCallback,
+  public CMyUnknownImp
+{
+  const CTestItems *_items;
+  IInArchive *_archive;
+  UInt32 _index;
+  CCompareOutStream *_outStreamSpec;
+  CMyComPtr<ISequentialOutStream> _outStream;
+public:
+  UInt32 NumErrors;
+  UInt32 NumFiles;
+  CExtractCallback(const CTestItems *items, IInArchive *archive):
+      _items(items), _archive(archive), _outStreamSpec(NULL), NumErrors(0), NumFiles(0) {}
+  MY_UNKNOWN_IMP
+  INTERFACE_IArchiveExtractCallback(;)
+};
+
+STDMETHODIMP CExtractCallback::SetTotal(UInt64 /* size */) { return S_OK; }
+STDMETHODIMP CExtractCallback::SetCompleted(const UInt64 * /* completeValue */) { return S_OK; }
+
+STDMETHODIMP CExtractCallback::GetStream(UInt32 index, ISequentialOutStream **outStream, Int32 askExtractMode)
+{
+  *outStream = NULL;
+  _outStream.Release();
+  _outStreamSpec = NULL;
+  {
+    NCOM::CPropVariant prop;
+    RINOK(_archive->GetProperty(index, kpidPath, &prop));
+    if (prop.vt != VT_BSTR)
+      return E_FAIL;
+    const wchar_t *name = prop.bstrVal;
+    while (*name != 0 && (*name < '0' || *name > '9'))
+      name++;
+    const wchar_t *end;
+    _index = (UInt32)ConvertStringToUInt64(name, &end);
+    if (name == end || *end != 0 || _index >= _items->NumItems())
+      return E_FAIL;
+  }
+  if (askExtractMode != NArchive::NExtract::NAskMode::kExtract || _items->IsDir(_index))
+    return S_OK;
+  _outStreamSpec = new CCompareOutStream(_items->GetData(_index), _items->GetSize(_index));
+  _outStream = _outStreamSpec;
+  *outStream = _outStreamSpec;
+  _outStreamSpec->AddRef();
+  return S_OK;
+}
+
+STDMETHODIMP CExtractCallback::PrepareOperation(Int32 /* askExtractMode */) { return S_OK; }
+
+STDMETHODIMP CExtractCallback::SetOperationResult(Int32 operationResult)
+{
+  NumFiles++;
+  if (operationResult != NArchive::NExtract::NOperationResult::kOK ||
+      (_outStreamSpec && (_outStreamSpec->Error || _outStreamSpec->Pos != _items->GetSize(_index))))
+  {
+    printf("  ERROR: file %u\n", (unsigned)_index);
+    NumErrors++;
+  }
+  _outStream.Release();
+  _outStreamSpec = NULL;
+  return S_OK;
+}
+
+static HRESULT TestThreads(const CTestItems &items, UInt32 numThreads)
+{
+  CMemOutStream *archiveSpec = new CMemOutStream;
+  CMyComPtr<IOutStream> archive = archiveSpec;
+  {
+    NArchive::N7z::CHandler *handlerSpec = new NArchive::N7z::CHandler;
+    CMyComPtr<IOutArchive> handler = handlerSpec;
+    const wchar_t *names[3] = { L"0", L"s", L"mt" };
+    NCOM::CPropVariant values[3];
+    values[0] = L"PPMd";
+    values[1] = true;
+    values[2] = numThreads;
+    RINOK(handlerSpec->SetProperties(names, values, 3));
+    CUpdateCallback *callbackSpec = new CUpdateCallback(&items);
+    CMyComPtr<IArchiveUpdateCallback> callback = callbackSpec;
+    RINOK(handler->UpdateItems(archive, items.NumItems(), callback));
+    printf("mt%u: %u progress calls\n", (unsigned)numThreads, callbackSpec->NumProgressCalls);
+    if (callbackSpec->NumOverlappedCalls != 0 || callbackSpec->ProgressError ||
+        callbackSpec->Completed != items.GetTotalSize())
+      return S_FALSE;
+  }
+
+  NArchive::N7z::CHandler *handlerSpec = new NArchive::N7z::CHandler;
+  CMyComPtr<IInArchive> handler = handlerSpec;
+  CBufInStream *inStreamSpec = new CBufInStream;
+  CMyComPtr<IInStream> inStream = inStreamSpec;
+  inStreamSpec->Init((const Byte *)archiveSpec->Buf, archiveSpec->Size);
+  const UInt64 kMaxCheckStartPosition = 0;
+  RINOK(handler->Open(inStream, &kMaxCheckStartPosition, NULL));
+
+  UInt32 numItems = 0, numBlocks = 0;
+  RINOK(handler->GetNumberOfItems(&numItems));
+  {
+    NCOM::CPropVariant prop;
+    RINOK(handler->GetArchiveProperty(kpidNumBlocks, &prop));
+    if (prop.vt == VT_UI4)
+      numBlocks = prop.ulVal;
+  }
+  printf("mt%u: %u bytes, %u items, %u folders\n", (unsigned)numThreads,
+      (unsigned)archiveSpec->Size, (unsigned)numItems, (unsigned)numBlocks);
+  if (numItems != items.NumItems() || numBlocks == 0 ||
+      (numThreads == 1) != (numBlocks == 1))
+    return S_FALSE;
+
+  CExtractCallback *callbackSpec = new CExtractCallback(&items, handler);
+  CMyComPtr<IArchiveExtractCallback> callback = callbackSpec;
+  RINOK(handler->Extract(NULL, (UInt32)(Int32)-1, 0, callback));
+  if (callbackSpec->NumErrors != 0 || callbackSpec->NumFiles != numItems)
+    return S_FALSE;
+  return S_OK;
+}
+
+int MY_CDECL main(int numArgs, const char *args[])
+{
+  UInt32 maxThreads = 3;
+  if (numArgs > 1)
+  {
+    int v = atoi(args[1]);
+    if (v < 1 || v > 64)
+    {
+      fputs("Usage: 7zTest [maxThreads]\n", stderr);
+      return 1;
+    }
+    maxThreads = (UInt32)v;
+  }
+  CTestItems items;
+  items.Generate();
+  for (UInt32 numThreads = 1; numThreads <= maxThreads; numThreads++)
+  {
+    HRESULT res;
+    try
+    {
+      res = TestThreads(items, numThreads);
+    }
+    catch(...)
+    {
+      res = E_FAIL;
+    }
+    if (res != S_OK)
+    {
+      printf("mt%u: ERROR %08X\n", (unsigned)numThreads, (unsigned)res);
+      return 1;
+    }
+  }
+  printf("Everything is Ok\n");
+  return 0;
+}
@@ -98,7 +98,7 @@ static void PrintHelp()
              "  d: decode file\n"
              "  b: Benchmark\n"
     "<Switches>\n"
-    "  -a{N}:  set compression mode - [0, 1], default: 1 (max)\n"
+    "  -a{N}:  set compression mode - [0, 2], default: 1 (max)\n"
     "  -d{N}:  set dictionary size - [12, 30], default: 23 (8MB)\n"
     "  -fb{N}: set number of fast bytes - [5, 273], default: 128\n"
     "  -mc{N}: set number of cycles for match finder\n"
@@ -236,7 +236,12 @@ int main2(int numArgs, const char *args[])
         if (!GetNumber(nonSwitchStrings[paramIndex++], numIterations))
           numIterations = kNumDefaultItereations;
     }
-    return LzmaBenchCon(stderr, numIterations, numThreads, dict);
+    RINOK(LzmaBenchCon(stderr, numIterations, numThreads, dict));
+    RINOK(CryptoBenchCon(stderr, dict));
+    HRESULT res = FilterBenchCon(stderr, dict);
+    if (res == S_FALSE)
+      throw "filter internal test failed";
+    return res;
   }
 
   if (numThreads == (UInt32)-1)
@@ -4,19 +4,31 @@
 
 #include "../../../C/7zCrc.h"
 
+#include "../../Common/Defs.h"
+
 #include "InOutTempBuffer.h"
 #include "StreamUtils.h"
 
+#ifdef _WIN32
 using namespace NWindows;
 using namespace NFile;
 using namespace NDirectory;
+#endif
 
 static const UInt32 kTempBufSize = (1 << 20);
 
+#ifdef _WIN32
+
 static LPCTSTR kTempFilePrefixString = TEXT("7zt");
 
 CInOutTempBuffer::CInOutTempBuffer(): _buf(NULL) { }
 
+#else
+
+CInOutTempBuffer::CInOutTempBuffer(): _file(NULL), _buf(NULL) { }
+
+#endif
+
 void CInOutTempBuffer::Create()
 {
   if (!_buf)
@@ -25,11 +37,22 @@ void CInOutTempBuffer::Create()
 
 CInOutTempBuffer::~CInOutTempBuffer()
 {
+  #ifndef _WIN32
+  if (_file)
+    fclose(_file);
+  #endif
   delete []_buf;
 }
 
 void CInOutTempBuffer::InitWriting()
 {
+  #ifndef _WIN32
+  if (_file)
+  {
+    fclose(_file);
+    _file = NULL;
+  }
+  #endif
   _bufPos = 0;
   _tempFileCreated = false;
   _size = 0;
@@ -42,6 +65,7 @@ bool CInOutTempBuffer::WriteToFile(const void *data, UInt32 size)
     return true;
   if (!_tempFileCreated)
   {
+    #ifdef _WIN32
     CSysString tempDirPath;
     if (!MyGetTempPath(tempDirPath))
       return false;
@@ -49,11 +73,20 @@ bool CInOutTempBuffer::WriteToFile(const void *data, UInt32 size)
       return false;
     if (!_outFile.Create(_tempFileName, true))
       return false;
+    #else
+    _file = tmpfile();
+    if (!_file)
+      return false;
+    #endif
     _tempFileCreated = true;
   }
+  #ifdef _WIN32
   UInt32 processed;
   if (!_outFile.Write(data, size, processed))
     return false;
+  #else
+  UInt32 processed = (UInt32)fwrite(data, 1, size, _file);
+  #endif
   _crc = CrcUpdate(_crc, data, processed);
   _size += processed;
   return (processed == size);
@@ -76,8 +109,10 @@ bool CInOutTempBuffer::Write(const void *data, UInt32 size)
 
 HRESULT CInOutTempBuffer::WriteToStream(ISequentialOutStream *stream)
 {
+  #ifdef _WIN32
   if (!_outFile.Close())
     return E_FAIL;
+  #endif
 
   UInt64 size = 0;
   UInt32 crc = CRC_INIT_VAL;
@@ -90,14 +125,25 @@ HRESULT CInOutTempBuffer::WriteToStream(ISequentialOutStream *stream)
   }
   if (_tempFileCreated)
   {
+    #ifdef _WIN32
     NIO::CInFile inFile;
     if (!inFile.Open(_tempFileName))
       return E_FAIL;
+    #else
+    if (fflush(_file) != 0 || fseek(_file, 0, SEEK_SET) != 0)
+      return E_FAIL;
+    #endif
     while (size < _size)
     {
+      #ifdef _WIN32
       UInt32 processed;
       if (!inFile.ReadPart(_buf, kTempBufSize, processed))
         return E_FAIL;
+      #else
+      UInt32 processed = (UInt32)fread(_buf, 1, kTempBufSize, _file);
+      if (ferror(_file))
+        return E_FAIL;
+      #endif
       if (processed == 0)
         break;
       RINOK(WriteStream(stream, _buf, processed));
@@ -4,18 +4,26 @@
 #define __IN_OUT_TEMP_BUFFER_H
 
 #include "../../Common/MyCom.h"
+#ifdef _WIN32
 #include "../../Windows/FileDir.h"
 #include "../../Windows/FileIO.h"
+#else
+#include <stdio.h>
+#endif
 
 #include "../IStream.h"
 
 class CInOutTempBuffer
 {
+  #ifdef _WIN32
   NWindows::NFile::NDirectory::CTempFile _tempFile;
   NWindows::NFile::NIO::COutFile _outFile;
+  CSysString _tempFileName;
+  #else
+  FILE *_file; // tmpfile() is deleted when it's closed
+  #endif
   Byte *_buf;
   UInt32 _bufPos;
-  CSysString _tempFileName;
   bool _tempFileCreated;
   UInt64 _size;
   UInt32 _crc;
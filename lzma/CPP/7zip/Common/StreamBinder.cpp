@@ -62,6 +62,9 @@ void CStreamBinder::ReInit()
 {
   _thereAreBytesToReadEvent.Reset();
   _readStreamIsClosedEvent.Reset();
+  #ifndef _WIN32
+  SetReadingWasClosed(false);
+  #endif
   ProcessedSize = 0;
 }
 
@@ -84,6 +87,9 @@ void CStreamBinder::CreateStreams(ISequentialInStream **inStream,
 
   _buffer = NULL;
   _bufferSize= 0;
+  #ifndef _WIN32
+  SetReadingWasClosed(false);
+  #endif
   ProcessedSize = 0;
 }
 
@@ -115,6 +121,11 @@ HRESULT CStreamBinder::Read(void *data, UInt32 size, UInt32 *processedSize)
 void CStreamBinder::CloseRead()
 {
   _readStreamIsClosedEvent.Set();
+  #ifndef _WIN32
+  // there is no WaitForMultipleObjects: Write() waits only for _allBytesAreWritenEvent
+  SetReadingWasClosed(true);
+  _allBytesAreWritenEvent.Set();
+  #endif
 }
 
 HRESULT CStreamBinder::Write(const void *data, UInt32 size, UInt32 *processedSize)
@@ -124,8 +135,13 @@ HRESULT CStreamBinder::Write(const void *data, UInt32 size, UInt32 *processedSiz
     _buffer = data;
     _bufferSize = size;
     _allBytesAreWritenEvent.Reset();
+    #ifndef _WIN32
+    if (ReadingWasClosed())
+      return S_FALSE;
+    #endif
     _thereAreBytesToReadEvent.Set();
 
+    #ifdef _WIN32
     HANDLE events[2];
     events[0] = _allBytesAreWritenEvent;
     events[1] = _readStreamIsClosedEvent;
@@ -135,6 +151,11 @@ HRESULT CStreamBinder::Write(const void *data, UInt32 size, UInt32 *processedSiz
       // ReadingWasClosed = true;
       return S_FALSE;
     }
+    #else
+    RINOK(_allBytesAreWritenEvent.Lock());
+    if (ReadingWasClosed())
+      return S_FALSE;
+    #endif
     // if(!_allBytesAreWritenEvent.Lock())
     //   return E_FAIL;
   }
@@ -11,6 +11,21 @@ class CStreamBinder
   NWindows::NSynchronization::CManualResetEvent _allBytesAreWritenEvent;
   NWindows::NSynchronization::CManualResetEvent _thereAreBytesToReadEvent;
   NWindows::NSynchronization::CManualResetEvent _readStreamIsClosedEvent;
+  #ifndef _WIN32
+  // _readingWasClosed is set by reading thread and tested by writing thread
+  NWindows::NSynchronization::CCriticalSection _readingWasClosedCS;
+  bool _readingWasClosed;
+  void SetReadingWasClosed(bool val)
+  {
+    NWindows::NSynchronization::CCriticalSectionLock lock(_readingWasClosedCS);
+    _readingWasClosed = val;
+  }
+  bool ReadingWasClosed()
+  {
+    NWindows::NSynchronization::CCriticalSectionLock lock(_readingWasClosedCS);
+    return _readingWasClosed;
+  }
+  #endif
   UInt32 _bufferSize;
   const void *_buffer;
 public:
@@ -81,14 +81,13 @@ HRESULT CEncoder::Code(ISequentialInStream *inStream, ISequentialOutStream *outS
   }
   if (!_outStream.Alloc(1 << 20))
     return E_OUTOFMEMORY;
-  if (!Ppmd7_Alloc(&_ppmd, _usedMemSize, &g_BigAlloc))
+  if (!Ppmd7_Reset(&_ppmd, _usedMemSize, _order, &g_BigAlloc))
     return E_OUTOFMEMORY;
 
   _outStream.Stream = outStream;
   _outStream.Init();
 
   Ppmd7z_RangeEnc_Init(&_rangeEnc);
-  Ppmd7_Init(&_ppmd, _order);
 
   UInt64 processed = 0;
   for (;;)
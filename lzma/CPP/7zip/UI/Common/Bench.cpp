@@ -29,7 +29,11 @@
 #endif
 
 #include "../../../../C/7zCrc.h"
+#include "../../../../C/Aes.h"
 #include "../../../../C/Alloc.h"
+#include "../../../../C/Bra.h"
+#include "../../../../C/Delta.h"
+#include "../../../../C/Sha256.h"
 
 #ifndef _7ZIP_ST
 #include "../../../Windows/Synchronization.h"
@@ -907,7 +911,7 @@ struct CCrcThreads
 {
   UInt32 NumThreads;
   CCrcInfo *Items;
-  CCrcThreads(): Items(0), NumThreads(0) {}
+  CCrcThreads(): NumThreads(0), Items(0) {}
   void WaitAll()
   {
     for (UInt32 i = 0; i < NumThreads; i++)
@@ -963,6 +967,21 @@ bool CrcInternalTest()
     for (UInt32 j = 0; j < kCheckSize; j++)
       if (CrcCalc1(buf + i, j) != CrcCalc(buf + i, j))
         return false;
+  // long blocks can use PCLMULQDQ code
+  for (i = 0; i < 16; i++)
+    for (UInt32 j = kBufferSize1 - 16 * 4; j <= kBufferSize1; j++)
+      if (CrcCalc1(buf + i, j) != CrcCalc(buf + i, j))
+        return false;
+  if (Crc32cCalc("123456789", 9) != 0xE3069283)
+    return false;
+  for (i = 0; i < kBufferSize0 + kBufferSize1; i++)
+  {
+    UInt32 crc = CRC_INIT_VAL;
+    for (UInt32 j = 0; j < i; j++)
+      crc = CRC32C_UPDATE_BYTE(crc, buf[j]);
+    if (CRC_GET_DIGEST(crc) != Crc32cCalc(buf, i))
+      return false;
+  }
   return true;
 }
 
@@ -1026,3 +1045,443 @@ HRESULT CrcBench(UInt32 numThreads, UInt32 bufferSize, UInt64 &speed)
   speed = MyMultDiv64(size, timeVal, GetFreq());
   return S_OK;
 }
+
+static const Byte kSha256AbcDigest[SHA256_DIGEST_SIZE] =
+{
+  0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+  0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD
+};
+
+static void Sha256Calc(unsigned algo, const Byte *data, UInt32 size, UInt32 step, Byte *digest)
+{
+  CSha256 sha;
+  Sha256_Init(&sha);
+  Sha256_SetFunction(&sha, algo);
+  for (UInt32 pos = 0; pos < size;)
+  {
+    UInt32 cur = size - pos;
+    if (cur > step)
+      cur = step;
+    Sha256_Update(&sha, data + pos, cur);
+    pos += cur;
+  }
+  Sha256_Final(&sha, digest);
+}
+
+bool Sha256InternalTest()
+{
+  Byte digest[SHA256_DIGEST_SIZE];
+  Sha256Calc(SHA256_ALGO_SW, (const Byte *)"abc", 3, 3, digest);
+  if (memcmp(digest, kSha256AbcDigest, SHA256_DIGEST_SIZE) != 0)
+    return false;
+
+  CBenchBuffer buffer;
+  const UInt32 kBufferSize = (1 << 12);
+  if (!buffer.Alloc(kBufferSize * SHA256_NUM_LANES_MAX))
+    return false;
+  Byte *buf = buffer.Buffer;
+  CBaseRandomGenerator RG;
+  RandGen(buf, kBufferSize * SHA256_NUM_LANES_MAX, RG);
+
+  CSha256 sha;
+  Sha256_Init(&sha);
+  bool useHw = Sha256_SetFunction(&sha, SHA256_ALGO_HW) != 0;
+  UInt32 size;
+  for (size = 0; size <= kBufferSize; size += 61)
+  {
+    Byte digest2[SHA256_DIGEST_SIZE];
+    Sha256Calc(SHA256_ALGO_SW, buf, size, 1, digest);
+    Sha256Calc(SHA256_ALGO_SW, buf, size, 100, digest2);
+    if (memcmp(digest, digest2, SHA256_DIGEST_SIZE) != 0)
+      return false;
+    if (useHw)
+    {
+      Sha256Calc(SHA256_ALGO_HW, buf, size, size + 1, digest2);
+      if (memcmp(digest, digest2, SHA256_DIGEST_SIZE) != 0)
+        return false;
+    }
+  }
+
+  CSha256 shas[SHA256_NUM_LANES_MAX];
+  CSha256 *lanes[SHA256_NUM_LANES_MAX];
+  const Byte *data[SHA256_NUM_LANES_MAX];
+  const UInt32 kHeadSize = 3;
+  UInt32 i;
+  for (i = 0; i < SHA256_NUM_LANES_MAX; i++)
+  {
+    Sha256_Init(&shas[i]);
+    Sha256_SetFunction(&shas[i], SHA256_ALGO_SW);
+    Sha256_Update(&shas[i], buf + kBufferSize * i, kHeadSize * i);
+    lanes[i] = &shas[i];
+    data[i] = buf + kBufferSize * i + kHeadSize * i;
+  }
+  size = kBufferSize - kHeadSize * SHA256_NUM_LANES_MAX;
+  Sha256_UpdateN(lanes, data, size, SHA256_NUM_LANES_MAX);
+  for (i = 0; i < SHA256_NUM_LANES_MAX; i++)
+  {
+    Byte digest2[SHA256_DIGEST_SIZE];
+    Sha256_Final(&shas[i], digest2);
+    Sha256Calc(SHA256_ALGO_SW, buf + kBufferSize * i, kHeadSize * i + size, 1 << 12, digest);
+    if (memcmp(digest, digest2, SHA256_DIGEST_SIZE) != 0)
+      return false;
+  }
+  return true;
+}
+
+HRESULT Sha256Bench(unsigned algo, UInt32 numLanes, UInt32 bufferSize, UInt64 &speed)
+{
+  if (numLanes == 0 || numLanes > SHA256_NUM_LANES_MAX)
+    return E_INVALIDARG;
+  CSha256 shas[SHA256_NUM_LANES_MAX];
+  CSha256 *lanes[SHA256_NUM_LANES_MAX];
+  const Byte *data[SHA256_NUM_LANES_MAX];
+
+  CBenchBuffer buffer;
+  if (!buffer.Alloc(bufferSize))
+    return E_OUTOFMEMORY;
+  Byte *buf = buffer.Buffer;
+  CBaseRandomGenerator RG;
+  RandGen(buf, bufferSize, RG);
+
+  UInt32 laneSize = bufferSize / numLanes;
+  UInt32 i;
+  for (i = 0; i < numLanes; i++)
+  {
+    Sha256_Init(&shas[i]);
+    if (!Sha256_SetFunction(&shas[i], algo))
+      return E_NOTIMPL;
+    lanes[i] = &shas[i];
+    data[i] = buf + (size_t)laneSize * i;
+  }
+  UInt32 numCycles = (kCrcBlockSize >> 3) / (bufferSize + 1) + 1;
+
+  UInt64 timeVal = GetTimeCount();
+  for (i = 0; i < numCycles; i++)
+  {
+    if (numLanes == 1)
+      Sha256_Update(lanes[0], buf, laneSize);
+    else
+      Sha256_UpdateN(lanes, data, laneSize, numLanes);
+  }
+  Byte digest[SHA256_DIGEST_SIZE];
+  for (i = 0; i < numLanes; i++)
+    Sha256_Final(lanes[i], digest);
+  timeVal = GetTimeCount() - timeVal;
+  if (timeVal == 0)
+    timeVal = 1;
+
+  UInt64 size = (UInt64)numCycles * laneSize * numLanes;
+  speed = MyMultDiv64(size, timeVal, GetFreq());
+  return S_OK;
+}
+
+static const Byte kAesKey[32] =
+{
+  0x60, 0x3D, 0xEB, 0x10, 0x15, 0xCA, 0x71, 0xBE, 0x2B, 0x73, 0xAE, 0xF0, 0x85, 0x7D, 0x77, 0x81,
+  0x1F, 0x35, 0x2C, 0x07, 0x3B, 0x61, 0x08, 0xD7, 0x2D, 0x98, 0x10, 0xA3, 0x09, 0x14, 0xDF, 0xF4
+};
+
+static const Byte kAesIv[AES_BLOCK_SIZE] =
+{
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+// NIST SP 800-38A, F.2.5: CBC-AES256.Encrypt
+static const Byte kAesCbcPlain[AES_BLOCK_SIZE * 4] =
+{
+  0x6B, 0xC1, 0xBE, 0xE2, 0x2E, 0x40, 0x9F, 0x96, 0xE9, 0x3D, 0x7E, 0x11, 0x73, 0x93, 0x17, 0x2A,
+  0xAE, 0x2D, 0x8A, 0x57, 0x1E, 0x03, 0xAC, 0x9C, 0x9E, 0xB7, 0x6F, 0xAC, 0x45, 0xAF, 0x8E, 0x51,
+  0x30, 0xC8, 0x1C, 0x46, 0xA3, 0x5C, 0xE4, 0x11, 0xE5, 0xFB, 0xC1, 0x19, 0x1A, 0x0A, 0x52, 0xEF,
+  0xF6, 0x9F, 0x24, 0x45, 0xDF, 0x4F, 0x9B, 0x17, 0xAD, 0x2B, 0x41, 0x7B, 0xE6, 0x6C, 0x37, 0x10
+};
+
+static const Byte kAesCbcCipher[AES_BLOCK_SIZE * 4] =
+{
+  0xF5, 0x8C, 0x4C, 0x04, 0xD6, 0xE5, 0xF1, 0xBA, 0x77, 0x9E, 0xAB, 0xFB, 0x5F, 0x7B, 0xFB, 0xD6,
+  0x9C, 0xFC, 0x4E, 0x96, 0x7E, 0xDB, 0x80, 0x8D, 0x67, 0x9F, 0x77, 0x7B, 0xC6, 0x70, 0x2C, 0x7D,
+  0x39, 0xF2, 0x33, 0x69, 0xA9, 0xD9, 0xBA, 0xCF, 0xA5, 0x30, 0xE2, 0x63, 0x04, 0x23, 0x14, 0x61,
+  0xB2, 0xEB, 0x05, 0xE2, 0xC3, 0x9B, 0xE9, 0xFC, 0xDA, 0x6C, 0x19, 0x07, 0x8C, 0x6A, 0x9D, 0x1B
+};
+
+// FIPS-197, C.1 - C.3: key is 00 01 02 ..., plaintext is 00 11 22 ...
+static const Byte kAesBlockCipher[3][AES_BLOCK_SIZE] =
+{
+  { 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A },
+  { 0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91 },
+  { 0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89 }
+};
+
+class CAesContext
+{
+  UInt32 _aes[AES_NUM_IVMRK_WORDS + 3];
+public:
+  UInt32 *Aes;
+  CAesContext() { Aes = _aes + ((0 - (unsigned)(ptrdiff_t)_aes) & 0xF) / sizeof(UInt32); }
+  void Init(bool encode, const Byte *key, unsigned keySize, const Byte *iv)
+  {
+    if (encode)
+      Aes_SetKey_Enc(Aes + 4, key, keySize);
+    else
+      Aes_SetKey_Dec(Aes + 4, key, keySize);
+    AesCbc_Init(Aes, iv);
+  }
+};
+
+static const AES_CODE_FUNC g_AesFuncsSw[3] = { AesCbc_Encode, AesCbc_Decode, AesCtr_Code };
+
+static AES_CODE_FUNC GetAesFunc(bool hw, unsigned mode)
+{
+  if (!hw)
+    return g_AesFuncsSw[mode];
+  AES_CODE_FUNC funcs[3] = { g_AesCbc_Encode, g_AesCbc_Decode, g_AesCtr_Code };
+  if (funcs[mode] == g_AesFuncsSw[mode])
+    return 0;
+  return funcs[mode];
+}
+
+static bool AesCheckBlocks(bool hw, const Byte *key, unsigned keySize, const Byte *plain, const Byte *cipher, size_t numBlocks)
+{
+  Byte buf[AES_BLOCK_SIZE * 4];
+  CAesContext aes;
+  memcpy(buf, plain, numBlocks * AES_BLOCK_SIZE);
+  aes.Init(true, key, keySize, kAesIv);
+  GetAesFunc(hw, 0)(aes.Aes, buf, numBlocks);
+  if (memcmp(buf, cipher, numBlocks * AES_BLOCK_SIZE) != 0)
+    return false;
+  aes.Init(false, key, keySize, kAesIv);
+  GetAesFunc(hw, 1)(aes.Aes, buf, numBlocks);
+  return memcmp(buf, plain, numBlocks * AES_BLOCK_SIZE) == 0;
+}
+
+bool AesInternalTest()
+{
+  bool useHw = (GetAesFunc(true, 0) != 0);
+  unsigned i;
+  for (int hw = 0; hw <= (useHw ? 1 : 0); hw++)
+  {
+    if (!AesCheckBlocks(hw != 0, kAesKey, 32, kAesCbcPlain, kAesCbcCipher, 4))
+      return false;
+    Byte key[32];
+    Byte plain[AES_BLOCK_SIZE];
+    Byte zeroIv[AES_BLOCK_SIZE];
+    for (i = 0; i < 32; i++)
+      key[i] = (Byte)i;
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+    {
+      plain[i] = (Byte)(i * 0x11);
+      zeroIv[i] = 0;
+    }
+    for (i = 0; i < 3; i++)
+    {
+      CAesContext aes;
+      Byte buf[AES_BLOCK_SIZE];
+      memcpy(buf, plain, AES_BLOCK_SIZE);
+      aes.Init(true, key, 16 + i * 8, zeroIv);
+      GetAesFunc(hw != 0, 0)(aes.Aes, buf, 1);
+      if (memcmp(buf, kAesBlockCipher[i], AES_BLOCK_SIZE) != 0)
+        return false;
+    }
+  }
+  if (!useHw)
+    return true;
+
+  // AES-NI code must give same results as portable code for any number of blocks
+  CBenchBuffer buffer;
+  const UInt32 kNumBlocksMax = 40;
+  if (!buffer.Alloc(AES_BLOCK_SIZE * kNumBlocksMax * 3))
+    return false;
+  Byte *buf = buffer.Buffer;
+  Byte *buf1 = buf + AES_BLOCK_SIZE * kNumBlocksMax;
+  Byte *buf2 = buf1 + AES_BLOCK_SIZE * kNumBlocksMax;
+  CBaseRandomGenerator RG;
+  RandGen(buf, AES_BLOCK_SIZE * kNumBlocksMax, RG);
+  for (unsigned keySize = 16; keySize <= 32; keySize += 8)
+    for (unsigned mode = 0; mode < 3; mode++)
+      for (UInt32 numBlocks = 0; numBlocks <= kNumBlocksMax; numBlocks++)
+      {
+        CAesContext aes1, aes2;
+        aes1.Init(mode != 1, buf + 3, keySize, buf + 50);
+        aes2.Init(mode != 1, buf + 3, keySize, buf + 50);
+        // CTR counter carries to high word
+        aes1.Aes[0] = aes2.Aes[0] = (UInt32)0 - 2;
+        size_t size = (size_t)numBlocks * AES_BLOCK_SIZE;
+        memcpy(buf1, buf, size);
+        memcpy(buf2, buf, size);
+        GetAesFunc(false, mode)(aes1.Aes, buf1, numBlocks);
+        GetAesFunc(true, mode)(aes2.Aes, buf2, numBlocks / 2);
+        GetAesFunc(true, mode)(aes2.Aes, buf2 + numBlocks / 2 * AES_BLOCK_SIZE, numBlocks - numBlocks / 2);
+        if (memcmp(buf1, buf2, size) != 0 || memcmp(aes1.Aes, aes2.Aes, AES_BLOCK_SIZE) != 0)
+          return false;
+      }
+  return true;
+}
+
+HRESULT AesBench(bool hw, unsigned mode, UInt32 bufferSize, UInt64 &speed)
+{
+  if (mode > 2)
+    return E_INVALIDARG;
+  AES_CODE_FUNC func = GetAesFunc(hw, mode);
+  if (!func)
+    return E_NOTIMPL;
+  bufferSize &= ~(UInt32)(AES_BLOCK_SIZE - 1);
+  if (bufferSize == 0)
+    return E_INVALIDARG;
+
+  CBenchBuffer buffer;
+  if (!buffer.Alloc(bufferSize))
+    return E_OUTOFMEMORY;
+  Byte *buf = buffer.Buffer;
+  CBaseRandomGenerator RG;
+  RandGen(buf, bufferSize, RG);
+
+  CAesContext aes;
+  aes.Init(mode != 1, kAesKey, 32, kAesIv);
+  UInt32 numCycles = (kCrcBlockSize >> 3) / (bufferSize + 1) + 1;
+
+  UInt64 timeVal = GetTimeCount();
+  for (UInt32 i = 0; i < numCycles; i++)
+    func(aes.Aes, buf, bufferSize / AES_BLOCK_SIZE);
+  timeVal = GetTimeCount() - timeVal;
+  if (timeVal == 0)
+    timeVal = 1;
+
+  UInt64 size = (UInt64)numCycles * bufferSize;
+  speed = MyMultDiv64(size, timeVal, GetFreq());
+  return S_OK;
+}
+
+static bool DeltaRef(Byte *state, unsigned delta, Byte *data, UInt32 size, bool encode)
+{
+  // all[i] is the byte at position (i - delta)
+  CBenchBuffer buffer;
+  if (!buffer.Alloc(delta + size))
+    return false;
+  Byte *all = buffer.Buffer;
+  memcpy(all, state, delta);
+  for (UInt32 i = 0; i < size; i++)
+  {
+    Byte b = data[i];
+    if (encode)
+    {
+      all[delta + i] = b;
+      data[i] = (Byte)(b - all[i]);
+    }
+    else
+      all[delta + i] = data[i] = (Byte)(b + all[i]);
+  }
+  memcpy(state, all + size, delta);
+  return true;
+}
+
+static UInt32 x86ConvertAll(Byte *data, UInt32 size, UInt32 chunkSize, int encoding)
+{
+  UInt32 state;
+  x86_Convert_Init(state);
+  UInt32 pos = 0;
+  for (;;)
+  {
+    UInt32 rem = size - pos;
+    if (rem > chunkSize)
+      rem = chunkSize;
+    SizeT processed = x86_Convert(data + pos, rem, pos, &state, encoding);
+    if (processed == 0)
+      return pos;
+    pos += (UInt32)processed;
+  }
+}
+
+bool FilterInternalTest()
+{
+  const UInt32 kBufferSize = (1 << 12);
+  CBenchBuffer buffer;
+  if (!buffer.Alloc(kBufferSize * 3))
+    return false;
+  Byte *buf = buffer.Buffer;
+  Byte *buf1 = buf + kBufferSize;
+  Byte *buf2 = buf1 + kBufferSize;
+  CBaseRandomGenerator RG;
+  UInt32 i;
+  for (i = 0; i < kBufferSize; i++)
+  {
+    UInt32 r = RG.GetRnd();
+    static const Byte kBytes[4] = { 0xE8, 0xE9, 0, 0xFF };
+    buf[i] = (Byte)((r & 0x300) == 0 ? (r >> 16) : kBytes[r & 3]);
+  }
+
+  // Delta: vector code must match the byte loop for any split of data
+  for (unsigned delta = 1; delta <= DELTA_STATE_SIZE; delta += (delta < 20 ? 1 : 37))
+    for (int encode = 0; encode < 2; encode++)
+    {
+      Byte state1[DELTA_STATE_SIZE], state2[DELTA_STATE_SIZE];
+      for (i = 0; i < delta; i++)
+        state1[i] = state2[i] = (Byte)RG.GetRnd();
+      memcpy(buf1, buf, kBufferSize);
+      memcpy(buf2, buf, kBufferSize);
+      for (UInt32 pos = 0; pos < kBufferSize;)
+      {
+        UInt32 size = RG.GetRnd() % (delta * 3 + 40);
+        if (size > kBufferSize - pos)
+          size = kBufferSize - pos;
+        if (!DeltaRef(state1, delta, buf1 + pos, size, encode != 0))
+          return false;
+        if (encode)
+          Delta_Encode(state2, delta, buf2 + pos, size);
+        else
+          Delta_Decode(state2, delta, buf2 + pos, size);
+        pos += size;
+      }
+      if (memcmp(buf1, buf2, kBufferSize) != 0 || memcmp(state1, state2, delta) != 0)
+        return false;
+    }
+
+  // x86: short calls don't use vector scan
+  for (UInt32 size = kBufferSize - 64; size <= kBufferSize; size++)
+    for (int encoding = 0; encoding < 2; encoding++)
+    {
+      memcpy(buf1, buf, size);
+      memcpy(buf2, buf, size);
+      if (x86ConvertAll(buf1, size, 19, encoding) != x86ConvertAll(buf2, size, size, encoding) ||
+          memcmp(buf1, buf2, size) != 0)
+        return false;
+      x86ConvertAll(buf2, size, size, 1 - encoding);
+      if (memcmp(buf, buf2, size) != 0)
+        return false;
+    }
+  return true;
+}
+
+HRESULT FilterBench(unsigned filter, UInt32 bufferSize, UInt64 &speed)
+{
+  if (filter >= kNumBenchFilters)
+    return E_INVALIDARG;
+  CBenchBuffer buffer;
+  if (!buffer.Alloc(bufferSize))
+    return E_OUTOFMEMORY;
+  Byte *buf = buffer.Buffer;
+  CBaseRandomGenerator RG;
+  RandGen(buf, bufferSize, RG);
+
+  int encoding = ((filter & 1) == 0);
+  unsigned delta = 1 << ((filter >> 1) - 1);
+  Byte state[DELTA_STATE_SIZE];
+  Delta_Init(state);
+  UInt32 numCycles = (kCrcBlockSize >> 3) / (bufferSize + 1) + 1;
+
+  UInt64 timeVal = GetTimeCount();
+  for (UInt32 i = 0; i < numCycles; i++)
+  {
+    if (filter < 2)
+      x86ConvertAll(buf, bufferSize, bufferSize, encoding);
+    else if (encoding)
+      Delta_Encode(state, delta, buf, bufferSize);
+    else
+      Delta_Decode(state, delta, buf, bufferSize);
+  }
+  timeVal = GetTimeCount() - timeVal;
+  if (timeVal == 0)
+    timeVal = 1;
+
+  UInt64 size = (UInt64)numCycles * bufferSize;
+  speed = MyMultDiv64(size, timeVal, GetFreq());
+  return S_OK;
+}
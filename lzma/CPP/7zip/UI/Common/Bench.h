@@ -39,4 +39,18 @@ UInt64 GetBenchMemoryUsage(UInt32 numThreads, UInt32 dictionary);
 bool CrcInternalTest();
 HRESULT CrcBench(UInt32 numThreads, UInt32 bufferSize, UInt64 &speed);
 
+bool Sha256InternalTest();
+// algo is SHA256_ALGO_*. (numLanes > 1) hashes (numLanes) parts of buffer with Sha256_UpdateN()
+HRESULT Sha256Bench(unsigned algo, UInt32 numLanes, UInt32 bufferSize, UInt64 &speed);
+
+bool AesInternalTest();
+// AES-256. mode: 0 - CBC encode, 1 - CBC decode, 2 - CTR. (hw) uses AES-NI code.
+HRESULT AesBench(bool hw, unsigned mode, UInt32 bufferSize, UInt64 &speed);
+
+bool FilterInternalTest();
+// filter: 0 - x86 BCJ encode, 1 - x86 BCJ decode,
+// (2 + k * 2) - Delta encode with delta = (1 << k), (3 + k * 2) - Delta decode. k = 0 ... 3
+const unsigned kNumBenchFilters = 10;
+HRESULT FilterBench(unsigned filter, UInt32 bufferSize, UInt64 &speed);
+
 #endif
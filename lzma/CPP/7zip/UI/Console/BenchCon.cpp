@@ -9,6 +9,9 @@
 #include "../../../Windows/System.h"
 #endif
 
+#include "../../../../C/Aes.h"
+#include "../../../../C/Sha256.h"
+
 #include "../Common/Bench.h"
 
 #include "BenchCon.h"
@@ -181,6 +184,15 @@ HRESULT LzmaBenchCon(
 
   PrintRequirements(f, "usage:", GetBenchMemoryUsage(numThreads, dictionary), "Benchmark threads:   ", numThreads);
 
+  // the decompression columns depend on the bit decoder that LzmaDec.c was built with
+  fprintf(f, "\nLZMA decoder: %s",
+      #ifdef _LZMA_DEC_BRANCHLESS
+      "branchless"
+      #else
+      "branching"
+      #endif
+      );
+
   CBenchCallback callback;
   callback.Init();
   callback.f = f;
@@ -238,6 +250,129 @@ struct CTempValues
   ~CTempValues() { delete []Values; }
 };
 
+static HRESULT Sha256BenchCon(FILE *f, UInt32 dictionary)
+{
+  Sha256Prepare();
+  if (!Sha256InternalTest())
+    return S_FALSE;
+
+  const unsigned kNumAlgos = 3;
+  static const char *kAlgoNames[kNumAlgos] = { "SW", "HW", "SWx8" };
+  fprintf(f, "\n\nSHA-256, 1 thread, MB/s\n\nSize");
+  for (unsigned a = 0; a < kNumAlgos; a++)
+    fprintf(f, " %5s", kAlgoNames[a]);
+  fprintf(f, "\n\n");
+
+  for (int pow = 10; pow < 32; pow++)
+  {
+    UInt32 bufSize = (UInt32)1 << pow;
+    if (bufSize > dictionary)
+      break;
+    fprintf(f, "%2d: ", pow);
+    for (unsigned a = 0; a < kNumAlgos; a++)
+    {
+      if (NConsoleClose::TestBreakSignal())
+        return E_ABORT;
+      UInt32 numLanes = 1;
+      unsigned algo = (a == 1 ? SHA256_ALGO_HW : SHA256_ALGO_SW);
+      if (a == 2)
+        numLanes = Sha256_GetNumLanes();
+      UInt64 speed;
+      HRESULT res = E_NOTIMPL;
+      if (a != 2 || numLanes > 1)
+        res = Sha256Bench(algo, numLanes, bufSize, speed);
+      if (res == E_NOTIMPL)
+      {
+        fprintf(f, "     -");
+        continue;
+      }
+      RINOK(res);
+      PrintNumber(f, (speed >> 20), 5);
+    }
+    fprintf(f, "\n");
+  }
+  return S_OK;
+}
+
+static HRESULT AesBenchCon(FILE *f, UInt32 dictionary)
+{
+  AesGenTables();
+  if (!AesInternalTest())
+    return S_FALSE;
+
+  const unsigned kNumAlgos = 6;
+  static const char *kAlgoNames[kNumAlgos] = { "Enc", "Dec", "Ctr", "HWEnc", "HWDec", "HWCtr" };
+  fprintf(f, "\n\nAES-256, 1 thread, MB/s\n\nSize");
+  for (unsigned a = 0; a < kNumAlgos; a++)
+    fprintf(f, " %5s", kAlgoNames[a]);
+  fprintf(f, "\n\n");
+
+  for (int pow = 10; pow < 32; pow++)
+  {
+    UInt32 bufSize = (UInt32)1 << pow;
+    if (bufSize > dictionary)
+      break;
+    fprintf(f, "%2d: ", pow);
+    for (unsigned a = 0; a < kNumAlgos; a++)
+    {
+      if (NConsoleClose::TestBreakSignal())
+        return E_ABORT;
+      UInt64 speed;
+      HRESULT res = AesBench(a >= 3, a % 3, bufSize, speed);
+      if (res == E_NOTIMPL)
+      {
+        fprintf(f, "     -");
+        continue;
+      }
+      RINOK(res);
+      PrintNumber(f, (speed >> 20), 5);
+    }
+    fprintf(f, "\n");
+  }
+  return S_OK;
+}
+
+HRESULT FilterBenchCon(FILE *f, UInt32 dictionary)
+{
+  if (!FilterInternalTest())
+    return S_FALSE;
+  if (dictionary == (UInt32)-1)
+    dictionary = (1 << 24);
+
+  static const char *kFilterNames[kNumBenchFilters] =
+    { "x86", "x86d", "D1", "D1d", "D2", "D2d", "D4", "D4d", "D8", "D8d" };
+  fprintf(f, "\n\nFilters, 1 thread, MB/s\n\nSize");
+  for (unsigned a = 0; a < kNumBenchFilters; a++)
+    fprintf(f, " %5s", kFilterNames[a]);
+  fprintf(f, "\n\n");
+
+  for (int pow = 10; pow < 32; pow++)
+  {
+    UInt32 bufSize = (UInt32)1 << pow;
+    if (bufSize > dictionary)
+      break;
+    fprintf(f, "%2d: ", pow);
+    for (unsigned a = 0; a < kNumBenchFilters; a++)
+    {
+      if (NConsoleClose::TestBreakSignal())
+        return E_ABORT;
+      UInt64 speed;
+      RINOK(FilterBench(a, bufSize, speed));
+      PrintNumber(f, (speed >> 20), 5);
+    }
+    fprintf(f, "\n");
+  }
+  return S_OK;
+}
+
+HRESULT CryptoBenchCon(FILE *f, UInt32 dictionary)
+{
+  if (dictionary == (UInt32)-1)
+    dictionary = (1 << 24);
+  RINOK(Sha256BenchCon(f, dictionary));
+  return AesBenchCon(f, dictionary);
+}
+
 HRESULT CrcBenchCon(FILE *f, UInt32 numIterations, UInt32 numThreads, UInt32 dictionary)
 {
   if (!CrcInternalTest())
@@ -293,5 +428,6 @@ HRESULT CrcBenchCon(FILE *f, UInt32 numIterations, UInt32 numThreads, UInt32 dic
       PrintNumber(f, ((speedTotals.Values[ti] / numSteps) >> 20), 5);
     fprintf(f, "\n");
   }
-  return S_OK;
+  RINOK(CryptoBenchCon(f, dictionary));
+  return FilterBenchCon(f, dictionary);
 }
@@ -13,4 +13,10 @@ HRESULT LzmaBenchCon(
 
 HRESULT CrcBenchCon(FILE *f, UInt32 numIterations, UInt32 numThreads, UInt32 dictionary);
 
+// SHA-256 and AES, 1 thread
+HRESULT CryptoBenchCon(FILE *f, UInt32 dictionary);
+
+// BCJ and Delta filters, 1 thread. It checks the vector code with FilterInternalTest() first
+HRESULT FilterBenchCon(FILE *f, UInt32 dictionary);
+
 #endif
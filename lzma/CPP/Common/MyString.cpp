@@ -132,6 +132,47 @@ wchar_t MyCharUpper(wchar_t c)
   return toupper(c);
 }
 
+wchar_t MyCharLower(wchar_t c)
+{
+  return tolower(c);
+}
+
+char * MyStringUpper(char *s)
+{
+  if (s == 0)
+    return 0;
+  for (char *p = s; *p != 0; p++)
+    *p = (char)toupper((unsigned char)*p);
+  return s;
+}
+
+wchar_t * MyStringUpper(wchar_t *s)
+{
+  if (s == 0)
+    return 0;
+  for (wchar_t *p = s; *p != 0; p++)
+    *p = MyCharUpper(*p);
+  return s;
+}
+
+char * MyStringLower(char *s)
+{
+  if (s == 0)
+    return 0;
+  for (char *p = s; *p != 0; p++)
+    *p = (char)tolower((unsigned char)*p);
+  return s;
+}
+
+wchar_t * MyStringLower(wchar_t *s)
+{
+  if (s == 0)
+    return 0;
+  for (wchar_t *p = s; *p != 0; p++)
+    *p = MyCharLower(*p);
+  return s;
+}
+
 /*
 int MyStringCollateNoCase(const wchar_t *s1, const wchar_t *s2)
 {
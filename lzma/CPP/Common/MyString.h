@@ -85,6 +85,11 @@ wchar_t * MyStringLower(wchar_t *s);
 
 #else // Standard-C
 wchar_t MyCharUpper(wchar_t c);
+wchar_t MyCharLower(wchar_t c);
+char * MyStringUpper(char *s);
+wchar_t * MyStringUpper(wchar_t *s);
+char * MyStringLower(char *s);
+wchar_t * MyStringLower(wchar_t *s);
 #endif
 
 //////////////////////////////////////
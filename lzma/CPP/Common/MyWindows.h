@@ -145,6 +145,13 @@ typedef WORD PROPVAR_PAD1;
 typedef WORD PROPVAR_PAD2;
 typedef WORD PROPVAR_PAD3;
 
+typedef struct tagSTATPROPSTG
+{
+  LPOLESTR lpwstrName;
+  PROPID propid;
+  VARTYPE vt;
+} STATPROPSTG;
+
 #ifdef __cplusplus
 
 typedef struct tagPROPVARIANT
@@ -193,6 +200,13 @@ MY_EXTERN_C LONG CompareFileTime(const FILETIME* ft1, const FILETIME* ft2);
 #define CP_ACP    0
 #define CP_OEMCP  1
 
+#define FILE_ATTRIBUTE_READONLY  0x0001
+#define FILE_ATTRIBUTE_HIDDEN    0x0002
+#define FILE_ATTRIBUTE_SYSTEM    0x0004
+#define FILE_ATTRIBUTE_DIRECTORY 0x0010
+#define FILE_ATTRIBUTE_ARCHIVE   0x0020
+#define FILE_ATTRIBUTE_NORMAL    0x0080
+
 typedef enum tagSTREAM_SEEK
 {
   STREAM_SEEK_SET = 0,
@@ -6,9 +6,32 @@
 
 #include "System.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 namespace NWindows {
 namespace NSystem {
 
+#ifndef _WIN32
+
+UInt32 GetNumberOfProcessors()
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (UInt32)n : 1;
+}
+
+UInt64 GetRamSize()
+{
+  long numPages = sysconf(_SC_PHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if (numPages <= 0 || pageSize <= 0)
+    return (UInt64)(sizeof(size_t)) << 29;
+  return (UInt64)numPages * (UInt64)pageSize;
+}
+
+#else
+
 UInt32 GetNumberOfProcessors()
 {
   SYSTEM_INFO systemInfo;
@@ -69,4 +92,6 @@ UInt64 GetRamSize()
   #endif
 }
 
+#endif
+
 }}
@@ -10,18 +10,66 @@
  * You can do whatever you want with this file.
  */
 
+/*
+ * CRC64 is the default check of the xz tool, so it is computed over all
+ * of the uncompressed data of typical .xz files. The slice-by-8 version
+ * below is about four times as fast as the byte-at-a-time loop but uses
+ * 16 KiB of tables instead of 2 KiB; #define XZ_CRC64_SMALL to get the
+ * compact version. On x86 with GCC >= 5 or Clang, long buffers are
+ * folded with PCLMULQDQ if xz_crc64_init() finds the CPU supports it.
+ */
+
 #include "xz_private.h"
 
 #ifndef STATIC_RW_DATA
 #	define STATIC_RW_DATA static
 #endif
 
-STATIC_RW_DATA uint64_t xz_crc64_table[256];
+#ifdef XZ_CRC64_SMALL
+#	define XZ_CRC64_TABLES 1
+#else
+#	define XZ_CRC64_TABLES 8
+#endif
 
-XZ_EXTERN void xz_crc64_init(void)
+#if XZ_CRC64_TABLES == 8 && !defined(__KERNEL__) \
+		&& (defined(__x86_64__) || defined(__i386__)) \
+		&& ((defined(__GNUC__) && __GNUC__ >= 5) \
+			|| (defined(__clang__) && __clang_major__ >= 4))
+#	define XZ_CRC64_CLMUL
+#	include <cpuid.h>
+#	include <emmintrin.h>
+#	include <wmmintrin.h>
+#endif
+
+static const uint64_t xz_crc64_poly = 0xC96C5795D7870F42;
+
+STATIC_RW_DATA uint64_t xz_crc64_table[XZ_CRC64_TABLES][256];
+
+#ifdef XZ_CRC64_CLMUL
+/*
+ * Multipliers for folding a 16-byte block over 512 and over 128 bits.
+ * The CRC is bit-reflected, so the coefficient of the highest power is
+ * in the lowest bit of a block. Carryless multiplication of two reflected
+ * 64-bit values gives the reflected product shifted down by one bit,
+ * which is why the multipliers for moving a block forward by n bits are
+ * x^(n+63) mod P (low half) and x^(n-1) mod P (high half).
+ */
+STATIC_RW_DATA uint64_t xz_crc64_fold[4];
+STATIC_RW_DATA bool xz_crc64_clmul;
+
+static uint64_t xz_crc64_xpow(uint32_t n)
 {
-	const uint64_t poly = 0xC96C5795D7870F42;
+	uint64_t r = (uint64_t)1 << 63;
+
+	while (n-- != 0)
+		r = (r >> 1) ^ (xz_crc64_poly & ~((r & 1) - 1));
+
+	return r;
+}
+#endif
 
+XZ_EXTERN void xz_crc64_init(void)
+{
 	uint32_t i;
 	uint32_t j;
 	uint64_t r;
@@ -29,22 +77,140 @@ XZ_EXTERN void xz_crc64_init(void)
 	for (i = 0; i < 256; ++i) {
 		r = i;
 		for (j = 0; j < 8; ++j)
-			r = (r >> 1) ^ (poly & ~((r & 1) - 1));
+			r = (r >> 1) ^ (xz_crc64_poly & ~((r & 1) - 1));
+
+		xz_crc64_table[0][i] = r;
+	}
+
+	for (j = 1; j < XZ_CRC64_TABLES; ++j) {
+		for (i = 0; i < 256; ++i) {
+			r = xz_crc64_table[j - 1][i];
+			xz_crc64_table[j][i] = xz_crc64_table[0][r & 0xFF]
+					^ (r >> 8);
+		}
+	}
+
+#ifdef XZ_CRC64_CLMUL
+	{
+		unsigned int a;
+		unsigned int b;
+		unsigned int c;
+		unsigned int d;
 
-		xz_crc64_table[i] = r;
+		xz_crc64_clmul = __get_cpuid(1, &a, &b, &c, &d)
+				&& (c & bit_PCLMUL) && (d & bit_SSE2);
+
+		xz_crc64_fold[0] = xz_crc64_xpow(512 + 63);
+		xz_crc64_fold[1] = xz_crc64_xpow(512 - 1);
+		xz_crc64_fold[2] = xz_crc64_xpow(128 + 63);
+		xz_crc64_fold[3] = xz_crc64_xpow(128 - 1);
 	}
+#endif
 
 	return;
 }
 
-XZ_EXTERN uint64_t xz_crc64(const uint8_t *buf, size_t size, uint64_t crc)
+/* Update the inverted CRC using the lookup tables. */
+static uint64_t xz_crc64_tables(const uint8_t *buf, size_t size, uint64_t crc)
 {
-	crc = ~crc;
+#if XZ_CRC64_TABLES == 8
+	uint32_t lo;
+	uint32_t hi;
+
+	while (size >= 8) {
+		lo = (uint32_t)crc ^ get_le32(buf);
+		hi = (uint32_t)(crc >> 32) ^ get_le32(buf + 4);
+		crc = xz_crc64_table[7][lo & 0xFF]
+				^ xz_crc64_table[6][(lo >> 8) & 0xFF]
+				^ xz_crc64_table[5][(lo >> 16) & 0xFF]
+				^ xz_crc64_table[4][lo >> 24]
+				^ xz_crc64_table[3][hi & 0xFF]
+				^ xz_crc64_table[2][(hi >> 8) & 0xFF]
+				^ xz_crc64_table[1][(hi >> 16) & 0xFF]
+				^ xz_crc64_table[0][hi >> 24];
+		buf += 8;
+		size -= 8;
+	}
+#endif
 
 	while (size != 0) {
-		crc = xz_crc64_table[*buf++ ^ (crc & 0xFF)] ^ (crc >> 8);
+		crc = xz_crc64_table[0][*buf++ ^ (crc & 0xFF)] ^ (crc >> 8);
 		--size;
 	}
 
-	return ~crc;
+	return crc;
+}
+
+#ifdef XZ_CRC64_CLMUL
+#define clmul_load(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+
+/* Move x forward by the distance of the multipliers k and add y. */
+static inline __attribute__((__target__("sse2,pclmul"))) __m128i clmul_fold(
+		__m128i x, __m128i k, __m128i y)
+{
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+			_mm_clmulepi64_si128(x, k, 0x11)), y);
+}
+
+/*
+ * Fold the buffer into one 16-byte block with four independent 16-byte
+ * accumulators. The CRC of that block (with zero as the initial value)
+ * equals the CRC of everything that was folded into it. size must be
+ * at least 64.
+ */
+static __attribute__((__target__("sse2,pclmul"))) uint64_t xz_crc64_clmul_run(
+		const uint8_t *buf, size_t size, uint64_t crc)
+{
+	__m128i x0;
+	__m128i x1;
+	__m128i x2;
+	__m128i x3;
+	__m128i k;
+	uint8_t block[16];
+
+	x0 = _mm_xor_si128(clmul_load(buf), _mm_set_epi32(0, 0,
+			(int)(uint32_t)(crc >> 32), (int)(uint32_t)crc));
+	x1 = clmul_load(buf + 16);
+	x2 = clmul_load(buf + 32);
+	x3 = clmul_load(buf + 48);
+	buf += 64;
+	size -= 64;
+
+	k = clmul_load(xz_crc64_fold);
+	while (size >= 64) {
+		x0 = clmul_fold(x0, k, clmul_load(buf));
+		x1 = clmul_fold(x1, k, clmul_load(buf + 16));
+		x2 = clmul_fold(x2, k, clmul_load(buf + 32));
+		x3 = clmul_fold(x3, k, clmul_load(buf + 48));
+		buf += 64;
+		size -= 64;
+	}
+
+	k = clmul_load(xz_crc64_fold + 2);
+	x1 = clmul_fold(x0, k, x1);
+	x2 = clmul_fold(x1, k, x2);
+	x3 = clmul_fold(x2, k, x3);
+
+	while (size >= 16) {
+		x3 = clmul_fold(x3, k, clmul_load(buf));
+		buf += 16;
+		size -= 16;
+	}
+
+	_mm_storeu_si128((__m128i *)(void *)block, x3);
+	crc = xz_crc64_tables(block, sizeof(block), 0);
+	return xz_crc64_tables(buf, size, crc);
+}
+#endif
+
+XZ_EXTERN uint64_t xz_crc64(const uint8_t *buf, size_t size, uint64_t crc)
+{
+	crc = ~crc;
+
+#ifdef XZ_CRC64_CLMUL
+	if (xz_crc64_clmul && size >= 128)
+		return ~xz_crc64_clmul_run(buf, size, crc);
+#endif
+
+	return ~xz_crc64_tables(buf, size, crc);
 }
@@ -0,0 +1,134 @@
+/*
+ * Test vectors for xz_crc64()
+ *
+ * The vectors are pseudo-random buffers of lengths around the block
+ * sizes of the slice-by-8 and PCLMULQDQ code. Each buffer is checked at
+ * every alignment and when it is split into two calls.
+ *
+ * This file has been put into the public domain.
+ * You can do whatever you want with this file.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "xz.h"
+
+struct crc64_vector {
+	uint32_t size;
+	uint32_t seed;
+	uint64_t crc;
+};
+
+static const struct crc64_vector vectors[] = {
+	{     0, 0x0000, 0x0000000000000000 },
+	{     1, 0x0001, 0xC835C6078C03E797 },
+	{     7, 0x0001, 0xEC08881AD2FE7C31 },
+	{     8, 0x0001, 0x1245B42D0862BFCF },
+	{     9, 0x0001, 0xFDA52C4551F9709C },
+	{    15, 0x0001, 0x3A30C78FF6CDDB7B },
+	{    16, 0x0001, 0x9B8C1B0D64354A7A },
+	{    17, 0x0001, 0x5C605CCC10A9DF7E },
+	{    63, 0x0001, 0x5AE848854F142319 },
+	{    64, 0x0001, 0x24544A453053BC19 },
+	{    65, 0x0001, 0xB58A33759800D262 },
+	{   127, 0x0001, 0x008EF8C2B19E83AD },
+	{   128, 0x0001, 0x802C4631EF73EAE9 },
+	{   129, 0x0001, 0x0821AB4FCEF1CF8C },
+	{   143, 0x0001, 0x5714D77BE54DCA6F },
+	{   191, 0x0001, 0xABEDA6EDBF9B1D28 },
+	{   255, 0x0001, 0xA78B007935DB0DD2 },
+	{   256, 0x0001, 0xD4D11417B624F935 },
+	{   257, 0x0001, 0xEA6F9E9FF03EB5E5 },
+	{  1000, 0x0001, 0x939A217EB22F7D13 },
+	{  4095, 0x0001, 0xF9480851F1E49027 },
+	{  4096, 0x0001, 0xDD77C1843A7A921B },
+	{ 65537, 0x0001, 0x618D5934EFABE974 },
+	{     1, 0x5EED, 0x98939A94BC9D9B9C },
+	{     7, 0x5EED, 0x3744D6AF3F6AC9D1 },
+	{     8, 0x5EED, 0xFBCB4F9B7D724090 },
+	{     9, 0x5EED, 0x7F1C4ABBC694E0E1 },
+	{    15, 0x5EED, 0xA84F5DDAAF4600AF },
+	{    16, 0x5EED, 0x9FE26FDAE321EBF8 },
+	{    17, 0x5EED, 0x37616D5526CB20B7 },
+	{    63, 0x5EED, 0xE32EFE3E0239112C },
+	{    64, 0x5EED, 0xF2E7332848D547FB },
+	{    65, 0x5EED, 0x70A612E07F872B2F },
+	{   127, 0x5EED, 0x083952DA9C593767 },
+	{   128, 0x5EED, 0x84D8FAD625130704 },
+	{   129, 0x5EED, 0x7709973A04F9DB0B },
+	{   143, 0x5EED, 0xBFB47201A68A547B },
+	{   191, 0x5EED, 0x97657495177B04F7 },
+	{   255, 0x5EED, 0x4D3DF49E8AE47CF2 },
+	{   256, 0x5EED, 0x65A287AC2ECD8B08 },
+	{   257, 0x5EED, 0x66AFA9814B37BEC2 },
+	{  1000, 0x5EED, 0x0C08D37829758A45 },
+	{  4095, 0x5EED, 0x8C9AD2B0D85A7E76 },
+	{  4096, 0x5EED, 0x09BFC5746469E806 },
+	{ 65537, 0x5EED, 0x508184517FA2B31B },
+};
+
+static uint8_t buf[65537 + 16];
+
+static void fill(uint8_t *p, uint32_t size, uint32_t seed)
+{
+	while (size-- != 0) {
+		seed = seed * 1103515245 + 12345;
+		*p++ = (uint8_t)(seed >> 24);
+	}
+}
+
+static bool check(const struct crc64_vector *v)
+{
+	static const uint32_t splits[] = { 1, 8, 63, 64, 100, 129, 1000 };
+	uint32_t offset;
+	uint32_t i;
+	uint64_t crc;
+
+	for (offset = 0; offset < 16; ++offset) {
+		fill(buf + offset, v->size, v->seed);
+		if (xz_crc64(buf + offset, v->size, 0) != v->crc)
+			return false;
+	}
+
+	fill(buf, v->size, v->seed);
+	for (i = 0; i < sizeof(splits) / sizeof(splits[0]); ++i) {
+		if (splits[i] >= v->size)
+			continue;
+
+		crc = xz_crc64(buf, splits[i], 0);
+		crc = xz_crc64(buf + splits[i], v->size - splits[i], crc);
+		if (crc != v->crc)
+			return false;
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	size_t i;
+	int failed = 0;
+
+	xz_crc64_init();
+
+	if (xz_crc64((const uint8_t *)"123456789", 9, 0)
+			!= 0x995DC9BBDF1939FA) {
+		fputs("CRC64 check value is wrong\n", stderr);
+		failed = 1;
+	}
+
+	for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+		if (!check(&vectors[i])) {
+			fprintf(stderr, "CRC64 mismatch: size %u, seed 0x%04X\n",
+					(unsigned int)vectors[i].size,
+					(unsigned int)vectors[i].seed);
+			failed = 1;
+		}
+	}
+
+	if (!failed)
+		puts("CRC64 test vectors OK");
+
+	return failed;
+}
@@ -0,0 +1,116 @@
+/* inf9test.c -- test inflate9() and inflateBack9() on deflate64 data
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+/*
+ * Usage: inf9test < file.raw
+ *
+ * Decodes a raw deflate64 stream from stdin twice: with inflateBack9() in
+ * one pass, and with inflate9() feeding and draining only a few bytes per
+ * call so that every resume point gets exercised.  If both decoders
+ * succeed and agree, it prints the length and crc32 of the data and exits
+ * with 0, otherwise it prints a message to stderr and exits with 1.
+ *
+ * test9.raw has a stored block and a fixed block that uses the codes only
+ * deflate64 has: length code 285 (16 extra bits) and distance codes 30 and
+ * 31.  test9dyn.raw uses the same codes in two dynamic blocks, so the code
+ * length code and the 286 literal/length and 32 distance code lengths are
+ * read too.  "make test" checks the results against the expected length and
+ * crc.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zlib.h"
+#include "infback9.h"
+
+#define MAXIN 65536L
+#define MAXOUT 262144L
+
+static unsigned char in[MAXIN];
+static unsigned char out1[MAXOUT], out2[MAXOUT];
+static unsigned long len1, len2;
+
+static unsigned pull(void FAR *desc, unsigned char FAR * FAR *buf)
+{
+    *buf = (unsigned char *)desc;
+    return 0;
+}
+
+static int push(void FAR *desc, unsigned char FAR *buf, unsigned len)
+{
+    (void)desc;
+    if (len > MAXOUT - len1)
+        return 1;
+    memcpy(out1 + len1, buf, len);
+    len1 += len;
+    return 0;
+}
+
+/* decode with inflateBack9() into out1[] */
+static int back9(unsigned long inlen)
+{
+    int ret;
+    z_stream strm;
+    static unsigned char window[65536L];
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    if (inflateBack9Init(&strm, window) != Z_OK)
+        return Z_MEM_ERROR;
+    strm.next_in = in;
+    strm.avail_in = (unsigned)inlen;
+    ret = inflateBack9(&strm, pull, Z_NULL, push, Z_NULL);
+    inflateBack9End(&strm);
+    return ret;
+}
+
+/* decode with inflate9() into out2[], a few bytes in and out at a time */
+static int inflate9_small(unsigned long inlen)
+{
+    int ret;
+    unsigned long pos = 0;
+    z_stream strm;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = Z_NULL;
+    strm.avail_in = 0;
+    if (inflate9Init(&strm) != Z_OK)
+        return Z_MEM_ERROR;
+    strm.next_out = out2;
+    do {
+        strm.avail_in = inlen - pos < 3 ? (unsigned)(inlen - pos) : 3;
+        strm.next_in = in + pos;
+        strm.avail_out = MAXOUT - len2 < 7 ? (unsigned)(MAXOUT - len2) : 7;
+        ret = inflate9(&strm, Z_NO_FLUSH);
+        pos = (unsigned long)(strm.next_in - in);
+        len2 = (unsigned long)(strm.next_out - out2);
+    } while (ret == Z_OK);
+    inflate9End(&strm);
+    return ret;
+}
+
+int main(void)
+{
+    unsigned long inlen;
+    int ret1, ret2;
+
+    inlen = (unsigned long)fread(in, 1, MAXIN, stdin);
+    ret1 = back9(inlen);
+    ret2 = inflate9_small(inlen);
+    if (ret1 != Z_STREAM_END || ret2 != Z_STREAM_END) {
+        fprintf(stderr, "inf9test: inflateBack9 %d, inflate9 %d\n",
+                ret1, ret2);
+        return 1;
+    }
+    if (len1 != len2 || memcmp(out1, out2, len1) != 0) {
+        fprintf(stderr, "inf9test: decoders disagree\n");
+        return 1;
+    }
+    printf("%lu %08lx\n", len1, crc32(crc32(0L, Z_NULL, 0), out1, (uInt)len1));
+    return 0;
+}
@@ -14,6 +14,11 @@
  * window must be provided.  Also if int's are 16 bits, then a zero for
  * the third parameter of the "out" function actually means 65536UL.
  * zlib.h must be included before this header file.
+ *
+ * inflate9() (inflate9.c) decodes the same raw deflate64 data through the
+ * regular streaming interface, with the semantics of inflate() for a raw
+ * inflateInit2(strm, -15) stream.  It allocates its own 64K window.  Use it
+ * where the caller pulls output a buffer at a time, as minizip does.
  */
 
 #ifdef __cplusplus
@@ -32,6 +37,15 @@ ZEXTERN int ZEXPORT inflateBack9Init_ OF((z_stream FAR *strm,
         inflateBack9Init_((strm), (window), \
         ZLIB_VERSION, sizeof(z_stream))
 
+ZEXTERN int ZEXPORT inflate9 OF((z_stream FAR *strm, int flush));
+ZEXTERN int ZEXPORT inflate9End OF((z_stream FAR *strm));
+ZEXTERN int ZEXPORT inflate9Reset OF((z_stream FAR *strm));
+ZEXTERN int ZEXPORT inflate9Init_ OF((z_stream FAR *strm,
+                                     const char *version,
+                                     int stream_size));
+#define inflate9Init(strm) \
+        inflate9Init_((strm), ZLIB_VERSION, sizeof(z_stream))
+
 #ifdef __cplusplus
 }
 #endif
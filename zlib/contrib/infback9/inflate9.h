@@ -8,14 +8,23 @@
    subject to change. Applications should only use zlib.h.
  */
 
-/* Possible inflate modes between inflate() calls */
+/* Possible inflate modes between inflate9() calls */
 typedef enum {
         TYPE,       /* i: waiting for type bits, including last-flag bit */
         STORED,     /* i: waiting for stored size (length and complement) */
+        COPY,       /* i/o: waiting for input or output to copy stored block */
         TABLE,      /* i: waiting for dynamic block table lengths */
+        LENLENS,    /* i: waiting for code length code lengths */
+        CODELENS,   /* i: waiting for length/lit and distance code lengths */
             LEN,        /* i: waiting for length/lit code */
+            LENEXT,     /* i: waiting for length extra bits */
+            DIST,       /* i: waiting for distance code */
+            DISTEXT,    /* i: waiting for distance extra bits */
+            MATCH,      /* o: waiting for output space to copy string */
+            LIT,        /* o: waiting for output space to write literal */
     DONE,       /* finished check, done -- remain here until reset */
-    BAD         /* got a data error -- remain here until reset */
+    BAD,        /* got a data error -- remain here until reset */
+    MEM         /* got an inflate9() memory error -- remain here until reset */
 } inflate_mode;
 
 /*
@@ -25,16 +34,36 @@ typedef enum {
 
     Read deflate blocks:
             TYPE -> STORED or TABLE or LEN or DONE
-            STORED -> TYPE
+            STORED -> COPY -> TYPE
             TABLE -> LENLENS -> CODELENS -> LEN
     Read deflate codes:
-                LEN -> LEN or TYPE
+                LEN -> LENEXT or LIT or TYPE
+                LENEXT -> DIST -> DISTEXT -> MATCH -> LEN
+                LIT -> LEN
+
+    inflateBack9() keeps the mode and all decoding state in local variables
+    and only uses TYPE, STORED, TABLE, LEN, DONE, and BAD.  inflate9() saves
+    everything below between calls so that it can resume in any mode.
  */
 
-/* state maintained between inflate() calls.  Approximately 7K bytes. */
+/* state maintained between inflate9() calls.  Approximately 7K bytes. */
 struct inflate_state {
         /* sliding window */
     unsigned char FAR *window;  /* allocated sliding window, if needed */
+    unsigned whave;             /* valid bytes in the window */
+    unsigned wnext;             /* window write index */
+        /* streaming decode state, used by inflate9() only */
+    inflate_mode mode;          /* current inflate mode */
+    int last;                   /* true if processing last block */
+    unsigned long hold;         /* input bit accumulator */
+    unsigned bits;              /* number of bits in "in" */
+    unsigned long length;       /* literal or length of data to copy */
+    unsigned long offset;       /* distance back to copy string from */
+    unsigned extra;             /* extra bits needed */
+    code const FAR *lencode;    /* starting table for length/literal codes */
+    code const FAR *distcode;   /* starting table for distance codes */
+    unsigned lenbits;           /* index bits for lencode */
+    unsigned distbits;          /* index bits for distcode */
         /* dynamic table building */
     unsigned ncode;             /* number of code length code lengths */
     unsigned nlen;              /* number of length code lengths */
@@ -7,6 +7,7 @@
 
 #include "zfstream.h"
 #include <iostream>      // for cout
+#include <cstring>       // for memcmp
 
 int main() {
 
@@ -45,6 +46,31 @@ int main() {
   }
   inf.close();
 
+  // Bulk transfers with large zlib buffers go straight through gzread/gzwrite
+  const std::streamsize bulk_size = 4 << 20;
+  char* bulk_out = new char[bulk_size];
+  char* bulk_in = new char[bulk_size];
+  for (std::streamsize i = 0; i < bulk_size; ++i)
+    bulk_out[i] = char('a' + (i * 7 + i / 4093) % 26);
+
+  outf.rdbuf()->pubsetbuf(0,0);
+  outf.rdbuf()->setzbuffer(1 << 20);
+  outf.open("test3.txt.gz");
+  outf.write(bulk_out, bulk_size);
+  outf.close();
+
+  inf.rdbuf()->setzbuffer(1 << 20);
+  inf.open("test3.txt.gz");
+  inf.read(bulk_in, bulk_size);
+  std::cout << "\nReading 'test3.txt.gz' in bulk with 1 MB zlib buffers "
+            << ((inf.gcount() == bulk_size && !memcmp(bulk_in, bulk_out, bulk_size))
+                ? "matches" : "does NOT match")
+            << " the " << bulk_size << " bytes written\n";
+  inf.close();
+
+  delete[] bulk_in;
+  delete[] bulk_out;
+
   return 0;
 
 }
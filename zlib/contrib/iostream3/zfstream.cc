@@ -15,12 +15,15 @@
 #define BIGBUFSIZE BUFSIZ
 #define SMALLBUFSIZE 1
 
+// Largest single transfer handed to gzread/gzwrite (their counts are ints)
+#define MAXCHUNKSIZE (1U << 30)
+
 /*****************************************************************************/
 
 // Default constructor
 gzfilebuf::gzfilebuf()
 : file(NULL), io_mode(std::ios_base::openmode(0)), own_fd(false),
-  buffer(NULL), buffer_size(BIGBUFSIZE), own_buffer(true)
+  buffer(NULL), buffer_size(BIGBUFSIZE), own_buffer(true), zbuffer_size(0)
 {
   // No buffers to start with
   this->disable_buffer();
@@ -46,6 +49,17 @@ gzfilebuf::setcompression(int comp_level,
   return gzsetparams(file, comp_level, comp_strategy);
 }
 
+// Set size of zlib's internal buffers
+int
+gzfilebuf::setzbuffer(unsigned size)
+{
+  // zlib only accepts a new size before the file is opened
+  if (this->is_open())
+    return -1;
+  zbuffer_size = size;
+  return 0;
+}
+
 // Open gzipped file
 gzfilebuf*
 gzfilebuf::open(const char *name,
@@ -67,6 +81,10 @@ gzfilebuf::open(const char *name,
   if ((file = gzopen(name, char_mode)) == NULL)
     return NULL;
 
+  // Size zlib's buffers before the first read or write allocates them
+  if (zbuffer_size)
+    gzbuffer(file, zbuffer_size);
+
   // On success, allocate internal buffer and set flags
   this->enable_buffer();
   io_mode = mode;
@@ -95,6 +113,10 @@ gzfilebuf::attach(int fd,
   if ((file = gzdopen(fd, char_mode)) == NULL)
     return NULL;
 
+  // Size zlib's buffers before the first read or write allocates them
+  if (zbuffer_size)
+    gzbuffer(file, zbuffer_size);
+
   // On success, allocate internal buffer and set flags
   this->enable_buffer();
   io_mode = mode;
@@ -301,6 +323,72 @@ gzfilebuf::sync()
   return traits_type::eq_int_type(this->overflow(), traits_type::eof()) ? -1 : 0;
 }
 
+// Read characters in bulk, bypassing the get area for large requests
+std::streamsize
+gzfilebuf::xsgetn(char_type* s,
+                  std::streamsize n)
+{
+  std::streamsize done = 0;
+  // Hand out whatever is left in the get area first
+  if (this->gptr() && (this->gptr() < this->egptr()))
+  {
+    done = this->egptr() - this->gptr();
+    if (done > n)
+      done = n;
+    traits_type::copy(s, this->gptr(), done);
+    this->setg(this->eback(), this->gptr() + done, this->egptr());
+  }
+  // Requests smaller than the stream buffer are best served by refilling it
+  if (n - done < buffer_size)
+    return done + std::streambuf::xsgetn(s + done, n - done);
+
+  // If the file hasn't been opened for reading, nothing more can be read
+  if (!this->is_open() || !(io_mode & std::ios_base::in))
+    return done;
+  // Let zlib inflate straight into the destination array
+  while (done < n)
+  {
+    std::streamsize left = n - done;
+    unsigned chunk = left < MAXCHUNKSIZE ? unsigned(left) : MAXCHUNKSIZE;
+    int bytes_read = gzread(file, s + done, chunk);
+    // Indicates error or EOF
+    if (bytes_read <= 0)
+      break;
+    done += bytes_read;
+  }
+  return done;
+}
+
+// Write characters in bulk, bypassing the put area for large sequences
+std::streamsize
+gzfilebuf::xsputn(const char_type* s,
+                  std::streamsize n)
+{
+  // Sequences that fit in the put area are simply copied there
+  if (this->pbase() && (n <= this->epptr() - this->pptr()))
+    return std::streambuf::xsputn(s, n);
+
+  // If the file hasn't been opened for writing, produce error
+  if (!this->is_open() || !(io_mode & std::ios_base::out))
+    return 0;
+  // Empty the put area first to preserve the order of characters
+  if (this->sync() == -1)
+    return 0;
+  // Let zlib deflate straight from the source array
+  std::streamsize done = 0;
+  while (done < n)
+  {
+    std::streamsize left = n - done;
+    unsigned chunk = left < MAXCHUNKSIZE ? unsigned(left) : MAXCHUNKSIZE;
+    int bytes_written = gzwrite(file, s + done, chunk);
+    // If gzipped file won't accept the bytes, stop here
+    if (bytes_written <= 0)
+      break;
+    done += bytes_written;
+  }
+  return done;
+}
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 // Allocate internal buffer
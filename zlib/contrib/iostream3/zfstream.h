@@ -49,6 +49,20 @@ public:
   setcompression(int comp_level,
                  int comp_strategy = Z_DEFAULT_STRATEGY);
 
+  /**
+   *  @brief  Set size of zlib's internal buffers.
+   *  @param  size  Buffer size in bytes (see gzbuffer in zlib.h).
+   *  @return  0 on success, -1 otherwise.
+   *
+   *  This sizes the input and output windows that zlib itself keeps for
+   *  the gzipped file, as opposed to the stream buffer installed by
+   *  setbuf. The new size takes effect at the next open() or attach(),
+   *  and fails if the file is already open. Multi-megabyte buffers cut
+   *  down the number of system calls considerably for bulk transfers.
+  */
+  int
+  setzbuffer(unsigned size);
+
   /**
    *  @brief  Check if file is open.
    *  @return  True if file is open.
@@ -145,6 +159,35 @@ protected:
   virtual int
   sync();
 
+  /**
+   *  @brief  Read characters in bulk.
+   *  @param  s  Destination array.
+   *  @param  n  Number of characters requested.
+   *  @return  Number of characters actually read.
+   *
+   *  Characters already in the get area are copied out first. Large
+   *  remaining requests are then passed straight to gzread, which inflates
+   *  directly into the destination array instead of going through the
+   *  stream buffer.
+  */
+  virtual std::streamsize
+  xsgetn(char_type* s,
+         std::streamsize n);
+
+  /**
+   *  @brief  Write characters in bulk.
+   *  @param  s  Source array.
+   *  @param  n  Number of characters to write.
+   *  @return  Number of characters actually written.
+   *
+   *  Sequences that don't fit in the put area flush it and are then
+   *  handed straight to gzwrite, which deflates directly from the source
+   *  array instead of copying it into the stream buffer first.
+  */
+  virtual std::streamsize
+  xsputn(const char_type* s,
+         std::streamsize n);
+
 //
 // Some future enhancements
 //
@@ -221,6 +264,14 @@ private:
    *  upon destruction.
   */
   bool own_buffer;
+
+  /**
+   *  @brief  Size of zlib's internal buffers.
+   *
+   *  Passed to gzbuffer when the file is opened. Zero selects zlib's own
+   *  default size. Modified by setzbuffer.
+  */
+  unsigned zbuffer_size;
 };
 
 /*****************************************************************************/
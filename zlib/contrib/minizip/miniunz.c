@@ -281,6 +281,11 @@ int do_list(uf)
         {
               string_method="BZip2 ";
         }
+        else
+        if (file_info.compression_method==Z_DEFLATE64ED)
+        {
+              string_method="Defl64";
+        }
         else
             string_method="Unkn. ";
 
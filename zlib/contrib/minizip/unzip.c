@@ -1425,6 +1425,9 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
     if ((err==UNZ_OK) && (s->cur_file_info.compression_method!=0) &&
 /* #ifdef HAVE_BZIP2 */
                          (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
+/* #endif */
+/* #ifdef HAVE_DEFLATE64 */
+                         (s->cur_file_info.compression_method!=Z_DEFLATE64ED) &&
 /* #endif */
                          (s->cur_file_info.compression_method!=Z_DEFLATED))
         err=UNZ_BADZIPFILE;
@@ -1532,6 +1535,9 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
     if ((s->cur_file_info.compression_method!=0) &&
 /* #ifdef HAVE_BZIP2 */
         (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
+/* #endif */
+/* #ifdef HAVE_DEFLATE64 */
+        (s->cur_file_info.compression_method!=Z_DEFLATE64ED) &&
 /* #endif */
         (s->cur_file_info.compression_method!=Z_DEFLATED))
 
@@ -1597,6 +1603,31 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
          * size of both compressed and uncompressed data
          */
     }
+    else if ((s->cur_file_info.compression_method==Z_DEFLATE64ED) && (!raw))
+    {
+#ifdef HAVE_DEFLATE64
+      pfile_in_zip_read_info->stream.zalloc = (alloc_func)0;
+      pfile_in_zip_read_info->stream.zfree = (free_func)0;
+      pfile_in_zip_read_info->stream.opaque = (voidpf)0;
+      pfile_in_zip_read_info->stream.next_in = 0;
+      pfile_in_zip_read_info->stream.avail_in = 0;
+
+      err=inflate9Init(&pfile_in_zip_read_info->stream);
+      if (err == Z_OK)
+        pfile_in_zip_read_info->stream_initialised=Z_DEFLATE64ED;
+      else
+      {
+        TRYFREE(pfile_in_zip_read_info);
+        return err;
+      }
+        /* inflate9 is the streaming deflate64 decoder from contrib/infback9.
+         * Like inflate above, it is fed raw data and called repeatedly from
+         * unzReadCurrentFile with whatever output buffer the caller provides.
+         */
+#else
+      pfile_in_zip_read_info->raw=1;
+#endif
+    }
     pfile_in_zip_read_info->rest_read_compressed =
             s->cur_file_info.compressed_size ;
     pfile_in_zip_read_info->rest_read_uncompressed =
@@ -1851,6 +1882,11 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
                 (pfile_in_zip_read_info->rest_read_compressed == 0))
                 flush = Z_FINISH;
             */
+#ifdef HAVE_DEFLATE64
+            if (pfile_in_zip_read_info->compression_method==Z_DEFLATE64ED)
+                err=inflate9(&pfile_in_zip_read_info->stream,flush);
+            else
+#endif
             err=inflate(&pfile_in_zip_read_info->stream,flush);
 
             if ((err>=0) && (pfile_in_zip_read_info->stream.msg!=NULL))
@@ -2028,6 +2064,10 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
     pfile_in_zip_read_info->read_buffer = NULL;
     if (pfile_in_zip_read_info->stream_initialised == Z_DEFLATED)
         inflateEnd(&pfile_in_zip_read_info->stream);
+#ifdef HAVE_DEFLATE64
+    else if (pfile_in_zip_read_info->stream_initialised == Z_DEFLATE64ED)
+        inflate9End(&pfile_in_zip_read_info->stream);
+#endif
 #ifdef HAVE_BZIP2
     else if (pfile_in_zip_read_info->stream_initialised == Z_BZIP2ED)
         BZ2_bzDecompressEnd(&pfile_in_zip_read_info->bstream);
@@ -59,7 +59,12 @@ extern "C" {
 #include "bzlib.h"
 #endif
 
+#ifdef HAVE_DEFLATE64
+#include "infback9.h"
+#endif
+
 #define Z_BZIP2ED 12
+#define Z_DEFLATE64ED 9
 
 #if defined(STRICTUNZIP) || defined(STRICTZIPUNZIP)
 /* like the STRICT of WIN32, we define a pointer that cannot be converted
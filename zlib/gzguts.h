@@ -12,6 +12,10 @@
 #  endif
 #endif
 
+#if defined(GZ_PREFETCH) && defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* for O_DIRECT */
+#endif
+
 #ifdef HAVE_HIDDEN
 #  define ZLIB_INTERNAL __attribute__((visibility ("hidden")))
 #else
@@ -42,6 +46,18 @@
 #  define close _close
 #endif
 
+#ifdef GZ_PREFETCH
+#  include <pthread.h>
+#  include <errno.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#  if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+#    define GZ_DSYNC(fd) fdatasync(fd)
+#  else
+#    define GZ_DSYNC(fd) fsync(fd)
+#  endif
+#endif
+
 #ifdef NO_DEFLATE       /* for compatibility with old definition */
 #  define NO_GZCOMPRESS
 #endif
@@ -157,6 +173,62 @@
 #define COPY 1      /* copy input directly */
 #define GZIP 2      /* decompress a gzip stream */
 
+#ifdef GZ_PREFETCH
+/* number of output buffers in the read-ahead ring */
+#define GZ_SLOTS 4
+
+/* read-ahead state for files opened for reading with "p" -- a helper thread
+   reads and decompresses a private gzFile on the same descriptor into a ring
+   of output buffers, which gz_fetch() then hands out one at a time */
+typedef struct {
+    pthread_t thread;           /* helper thread */
+    pthread_mutex_t lock;       /* protects everything below but inner */
+    pthread_cond_t filled;      /* signaled when a buffer becomes ready */
+    pthread_cond_t drained;     /* signaled when a buffer is handed back */
+    gzFile inner;               /* gzip file read only by the helper */
+    unsigned char *buf[GZ_SLOTS];   /* ring of buffers, size << 1 each */
+    unsigned have[GZ_SLOTS];        /* bytes in each ready buffer */
+    z_off64_t offset[GZ_SLOTS];     /* gzoffset64() of inner after each */
+    unsigned head;              /* next buffer for the helper to fill */
+    unsigned tail;              /* next buffer for the reader to take */
+    unsigned ready;             /* number of filled buffers not yet taken */
+    int held;                   /* true if the reader holds a buffer */
+    z_off64_t pos;              /* gzoffset64() after the buffer last taken */
+    int running;                /* true if the helper thread exists */
+    int done;                   /* true if the helper reached end or error */
+    int stop;                   /* true if the reader wants the helper gone */
+    int direct;                 /* gzdirect() of inner after first buffer */
+    int err;                    /* inner error code once done */
+    const char *msg;            /* inner error message once done */
+} gz_prefetch;
+
+/* alignment of buffers, lengths, and offsets for O_DIRECT writes */
+#define GZ_ALIGN 4096
+
+/* write-behind state for files opened for writing with "p" -- deflate fills a
+   ring of output buffers, and a helper thread writes all of the queued ones
+   with a single writev() while deflate goes on to fill the next -- with "S",
+   the helper also syncs the file once per flush, after the whole batch */
+typedef struct {
+    pthread_t thread;           /* helper thread */
+    pthread_mutex_t lock;       /* protects everything below but buf[] */
+    pthread_cond_t queued;      /* signaled when a buffer is queued */
+    pthread_cond_t written;     /* signaled when buffers have been written */
+    unsigned char *buf[GZ_SLOTS];   /* ring of output buffers, size each */
+    unsigned char *next[GZ_SLOTS];  /* queue of data to write */
+    unsigned len[GZ_SLOTS];         /* queue of bytes to write at next[] */
+    unsigned cur;               /* buffer deflate is filling */
+    unsigned head;              /* next free queue entry */
+    unsigned tail;              /* next queue entry for the helper */
+    unsigned ready;             /* queued buffers not yet taken */
+    unsigned pending;           /* queued buffers not yet written */
+    int odirect;                /* true while writing with O_DIRECT */
+    int sync;                   /* true if the writer wants a sync */
+    int stop;                   /* true if the writer wants the helper gone */
+    int err;                    /* errno from the first failed write, or 0 */
+} gz_wbehind;
+#endif
+
 /* internal gzip file state data structure */
 typedef struct {
         /* exposed contents for gzgetc() macro */
@@ -178,6 +250,13 @@ typedef struct {
     z_off64_t start;        /* where the gzip data started, for rewinding */
     int eof;                /* true if end of input file reached */
     int past;               /* true if read requested past end */
+#ifdef GZ_PREFETCH
+    int prefetch;           /* true if opened with "p" for a helper thread */
+    gz_prefetch *pf;        /* read-ahead state, NULL until first read */
+    int odirect;            /* true if opened with "D" for O_DIRECT writes */
+    int dsync;              /* true if opened with "S" to sync at flushes */
+    gz_wbehind *wb;         /* write-behind state, NULL until first write */
+#endif
         /* just for writing */
     int level;              /* compression level */
     int strategy;           /* compression strategy */
@@ -194,6 +273,9 @@ typedef gz_state FAR *gz_statep;
 
 /* shared functions */
 void ZLIB_INTERNAL gz_error OF((gz_statep, int, const char *));
+#ifdef GZ_PREFETCH
+void ZLIB_INTERNAL gz_pstop OF((gz_statep));
+#endif
 #if defined UNDER_CE
 char ZLIB_INTERNAL *gz_strwinerror OF((DWORD error));
 #endif
@@ -102,6 +102,11 @@ local gzFile gz_open(path, fd, mode)
 #ifdef O_EXCL
     int exclusive = 0;
 #endif
+#ifdef GZ_PREFETCH
+    int prefetch = 0;
+    int odirect = 0;
+    int dsync = 0;
+#endif
 
     /* check input */
     if (path == NULL)
@@ -166,6 +171,17 @@ local gzFile gz_open(path, fd, mode)
             case 'T':
                 state->direct = 1;
                 break;
+#ifdef GZ_PREFETCH
+            case 'p':
+                prefetch = 1;
+                break;
+            case 'D':
+                odirect = 1;
+                break;
+            case 'S':
+                dsync = 1;
+                break;
+#endif
             default:        /* could consider as an error, but just ignore */
                 ;
             }
@@ -186,6 +202,13 @@ local gzFile gz_open(path, fd, mode)
         }
         state->direct = 1;      /* for empty file */
     }
+#ifdef GZ_PREFETCH
+    state->prefetch = prefetch;
+    state->pf = NULL;
+    state->odirect = state->mode != GZ_READ && prefetch && odirect;
+    state->dsync = state->mode != GZ_READ && prefetch && dsync;
+    state->wb = NULL;
+#endif
 
     /* save the path name for error messages */
 #ifdef _WIN32
@@ -351,6 +374,19 @@ int ZEXPORT gzrewind(file)
             (state->err != Z_OK && state->err != Z_BUF_ERROR))
         return -1;
 
+#ifdef GZ_PREFETCH
+    /* stop read-ahead and have the inner file start over */
+    if (state->pf != NULL) {
+        gz_pstop(state);
+        gzclearerr(state->pf->inner);
+        if (gzrewind(state->pf->inner) == -1)
+            return -1;
+        state->pf->pos = state->start;
+        gz_reset(state);
+        return 0;
+    }
+#endif
+
     /* back up and start over */
     if (LSEEK(state->fd, state->start, SEEK_SET) == -1)
         return -1;
@@ -488,6 +524,12 @@ z_off64_t ZEXPORT gzoffset64(file)
     if (state->mode != GZ_READ && state->mode != GZ_WRITE)
         return -1;
 
+#ifdef GZ_PREFETCH
+    /* with read-ahead, report the offset after the buffer being consumed */
+    if (state->pf != NULL)
+        return state->pf->pos;
+#endif
+
     /* compute and return effective offset in file */
     offset = LSEEK(state->fd, 0, SEEK_CUR);
     if (offset == -1)
@@ -12,6 +12,11 @@ local int gz_look OF((gz_statep));
 local int gz_decomp OF((gz_statep));
 local int gz_fetch OF((gz_statep));
 local int gz_skip OF((gz_statep, z_off64_t));
+#ifdef GZ_PREFETCH
+local void *gz_pthread OF((void *));
+local int gz_pstart OF((gz_statep));
+local int gz_pfetch OF((gz_statep));
+#endif
 
 /* Use read() to load a buffer -- return -1 on error, otherwise 0.  Read from
    state->fd, and update state->eof, state->err, and state->msg as appropriate.
@@ -228,6 +233,10 @@ local int gz_fetch(state)
 {
     z_streamp strm = &(state->strm);
 
+#ifdef GZ_PREFETCH
+    if (state->prefetch)
+        return gz_pfetch(state);
+#endif
     do {
         switch(state->how) {
         case LOOK:      /* -> LOOK, COPY (only if never GZIP), or GZIP */
@@ -252,6 +261,183 @@ local int gz_fetch(state)
     return 0;
 }
 
+#ifdef GZ_PREFETCH
+/* Read-ahead helper thread.  Fill free buffers of the ring by reading the
+   private inner gzFile until the end of the input, an error, or a stop request
+   from the reader.  Each buffer is twice the inner buffer size, so gzread()
+   decompresses directly into it without an extra copy.  The lock is not held
+   while reading, so the reader can take ready buffers in the meantime. */
+local void *gz_pthread(arg)
+    void *arg;
+{
+    gz_prefetch *pf = (gz_prefetch *)arg;
+    gz_statep inner = (gz_statep)pf->inner;
+    unsigned len = inner->want << 1;
+    unsigned slot;
+    int got, err;
+    const char *msg;
+
+    pthread_mutex_lock(&(pf->lock));
+    for (;;) {
+        /* wait for a buffer that is neither ready nor held by the reader */
+        while (!pf->stop && pf->ready + pf->held == GZ_SLOTS)
+            pthread_cond_wait(&(pf->drained), &(pf->lock));
+        if (pf->stop)
+            break;
+        slot = pf->head;
+        pthread_mutex_unlock(&(pf->lock));
+
+        /* read and decompress -- gzread() only returns short at the end of
+           the input or on an error */
+        got = gzread(pf->inner, pf->buf[slot], len);
+        msg = gzerror(pf->inner, &err);
+        if (err != Z_OK && err != Z_MEM_ERROR)
+            msg += strlen(inner->path) + 2;     /* drop "path: " */
+
+        /* publish the buffer, and the error or end if that was the last */
+        pthread_mutex_lock(&(pf->lock));
+        if (got > 0) {
+            pf->have[slot] = (unsigned)got;
+            pf->offset[slot] = gzoffset64(pf->inner);
+            pf->head = (slot + 1) % GZ_SLOTS;
+            pf->ready++;
+        }
+        pf->direct = inner->direct;
+        if (got < (int)len) {
+            pf->done = 1;
+            pf->err = err;
+            pf->msg = msg;
+        }
+        pthread_cond_signal(&(pf->filled));
+        if (pf->done)
+            break;
+    }
+    pthread_mutex_unlock(&(pf->lock));
+    return NULL;
+}
+
+/* Start the read-ahead helper thread with an empty ring.  On the first call,
+   allocate the ring and open the private inner gzFile on the same descriptor.
+   Return -1 on error, 0 on success. */
+local int gz_pstart(state)
+    gz_statep state;
+{
+    unsigned n;
+    gz_prefetch *pf = state->pf;
+
+    if (pf == NULL) {
+        /* allocate ring buffers, plus an output buffer for gzungetc() */
+        pf = (gz_prefetch *)malloc(sizeof(gz_prefetch));
+        if (pf == NULL) {
+            gz_error(state, Z_MEM_ERROR, "out of memory");
+            return -1;
+        }
+        state->out = (unsigned char *)malloc(state->want << 1);
+        for (n = 0; n < GZ_SLOTS; n++)
+            pf->buf[n] = (unsigned char *)malloc(state->want << 1);
+        pf->inner = gzdopen(state->fd, "rb");
+        for (n = 0; n < GZ_SLOTS && pf->buf[n] != NULL; n++)
+            ;
+        if (state->out == NULL || n < GZ_SLOTS || pf->inner == NULL) {
+            if (pf->inner != NULL) {        /* don't close the descriptor */
+                free(((gz_statep)pf->inner)->path);
+                free(pf->inner);
+            }
+            for (n = 0; n < GZ_SLOTS; n++)
+                if (pf->buf[n] != NULL)
+                    free(pf->buf[n]);
+            if (state->out != NULL)
+                free(state->out);
+            free(pf);
+            gz_error(state, Z_MEM_ERROR, "out of memory");
+            return -1;
+        }
+        gzbuffer(pf->inner, state->want);
+        state->size = state->want;
+
+        /* initialize synchronization */
+        pthread_mutex_init(&(pf->lock), NULL);
+        pthread_cond_init(&(pf->filled), NULL);
+        pthread_cond_init(&(pf->drained), NULL);
+        pf->running = 0;
+        pf->direct = 1;                     /* for empty file */
+        state->pf = pf;
+    }
+
+    /* start the helper on an empty ring */
+    pf->head = pf->tail = pf->ready = 0;
+    pf->held = 0;
+    pf->done = 0;
+    pf->stop = 0;
+    pf->err = Z_OK;
+    pf->msg = NULL;
+    pf->pos = gzoffset64(pf->inner);
+    if (pthread_create(&(pf->thread), NULL, gz_pthread, pf) != 0) {
+        gz_error(state, Z_ERRNO, "could not start read-ahead thread");
+        return -1;
+    }
+    pf->running = 1;
+    return 0;
+}
+
+/* Stop the read-ahead helper thread, if running, and discard the ring.  The
+   inner gzFile is left where the helper stopped. */
+void ZLIB_INTERNAL gz_pstop(state)
+    gz_statep state;
+{
+    gz_prefetch *pf = state->pf;
+
+    if (pf == NULL || !pf->running)
+        return;
+    pthread_mutex_lock(&(pf->lock));
+    pf->stop = 1;
+    pthread_cond_signal(&(pf->drained));
+    pthread_mutex_unlock(&(pf->lock));
+    pthread_join(pf->thread, NULL);
+    pf->running = 0;
+    state->x.have = 0;
+}
+
+/* gz_fetch() for read-ahead: hand back the buffer the reader was holding, wait
+   for the next one to be ready, and point state->x at it.  When the helper is
+   done and no buffers are left, set state->eof and pick up any error from the
+   inner gzFile.  Assumes state->x.have is 0.  Return -1 on error, 0 otherwise.
+ */
+local int gz_pfetch(state)
+    gz_statep state;
+{
+    unsigned slot;
+    gz_prefetch *pf;
+
+    if ((state->pf == NULL || !state->pf->running) && gz_pstart(state) == -1)
+        return -1;
+    pf = state->pf;
+    pthread_mutex_lock(&(pf->lock));
+    if (pf->held) {
+        pf->held = 0;
+        pthread_cond_signal(&(pf->drained));
+    }
+    while (pf->ready == 0 && !pf->done)
+        pthread_cond_wait(&(pf->filled), &(pf->lock));
+    if (pf->ready) {
+        slot = pf->tail;
+        pf->tail = (slot + 1) % GZ_SLOTS;
+        pf->ready--;
+        pf->held = 1;
+        state->x.next = pf->buf[slot];
+        state->x.have = pf->have[slot];
+        pf->pos = pf->offset[slot];
+    }
+    else {
+        state->eof = 1;
+        if (pf->err != Z_OK)
+            gz_error(state, pf->err, pf->msg);
+    }
+    pthread_mutex_unlock(&(pf->lock));
+    return state->err != Z_OK && state->err != Z_BUF_ERROR ? -1 : 0;
+}
+#endif
+
 /* Skip len uncompressed bytes of output.  Return -1 on error, 0 on success. */
 local int gz_skip(state, len)
     gz_statep state;
@@ -447,6 +633,22 @@ int ZEXPORT gzungetc(c, file)
     if (c < 0)
         return -1;
 
+#ifdef GZ_PREFETCH
+    /* move what is left of a read-ahead buffer to the end of the output buffer
+       and hand the read-ahead buffer back, so there is room to push in front */
+    if (state->pf != NULL && state->x.have &&
+            (state->x.next < state->out ||
+             state->x.next >= state->out + (state->size << 1))) {
+        memcpy(state->out + (state->size << 1) - state->x.have,
+               state->x.next, state->x.have);
+        state->x.next = state->out + (state->size << 1) - state->x.have;
+        pthread_mutex_lock(&(state->pf->lock));
+        state->pf->held = 0;
+        pthread_cond_signal(&(state->pf->drained));
+        pthread_mutex_unlock(&(state->pf->lock));
+    }
+#endif
+
     /* if output buffer empty, put byte at end (allows more pushing) */
     if (state->x.have == 0) {
         state->x.have = 1;
@@ -554,6 +756,25 @@ int ZEXPORT gzdirect(file)
         return 0;
     state = (gz_statep)file;
 
+#ifdef GZ_PREFETCH
+    /* with read-ahead, the helper finds out when it fills the first buffer */
+    if (state->mode == GZ_READ && state->prefetch) {
+        int direct;
+        gz_prefetch *pf;
+
+        if ((state->pf == NULL || !state->pf->running) &&
+                gz_pstart(state) == -1)
+            return 0;
+        pf = state->pf;
+        pthread_mutex_lock(&(pf->lock));
+        while (pf->ready == 0 && !pf->done)
+            pthread_cond_wait(&(pf->filled), &(pf->lock));
+        direct = pf->direct;
+        pthread_mutex_unlock(&(pf->lock));
+        return direct;
+    }
+#endif
+
     /* if the state is not known, but we can find out, then do so (this is
        mainly for right after a gzopen() or gzdopen()) */
     if (state->mode == GZ_READ && state->how == LOOK && state->x.have == 0)
@@ -579,6 +800,30 @@ int ZEXPORT gzclose_r(file)
     if (state->mode != GZ_READ)
         return Z_STREAM_ERROR;
 
+#ifdef GZ_PREFETCH
+    /* stop read-ahead, free the ring, and let the inner file close the
+       descriptor */
+    if (state->pf != NULL) {
+        unsigned n;
+        gz_prefetch *pf = state->pf;
+
+        gz_pstop(state);
+        ret = gzclose_r(pf->inner);
+        for (n = 0; n < GZ_SLOTS; n++)
+            free(pf->buf[n]);
+        pthread_cond_destroy(&(pf->drained));
+        pthread_cond_destroy(&(pf->filled));
+        pthread_mutex_destroy(&(pf->lock));
+        free(pf);
+        free(state->out);
+        err = state->err == Z_BUF_ERROR ? Z_BUF_ERROR : Z_OK;
+        gz_error(state, Z_OK, NULL);
+        free(state->path);
+        free(state);
+        return ret == Z_ERRNO ? Z_ERRNO : err;
+    }
+#endif
+
     /* free memory and close file */
     if (state->size) {
         inflateEnd(&(state->strm));
@@ -9,6 +9,260 @@
 local int gz_init OF((gz_statep));
 local int gz_comp OF((gz_statep, int));
 local int gz_zero OF((gz_statep, z_off64_t));
+#ifdef GZ_PREFETCH
+local void *gz_wthread OF((void *));
+local int gz_winit OF((gz_statep));
+local int gz_wqueue OF((gz_statep, unsigned));
+local int gz_wsync OF((gz_statep));
+local int gz_wstop OF((gz_statep));
+#endif
+
+#ifdef GZ_PREFETCH
+/* Write-behind helper thread.  Take all of the queued buffers at once and
+   write them with one writev(), without holding the lock so that deflate can
+   fill the next buffer meanwhile.  O_DIRECT is turned off for good as soon as
+   a buffer is not a whole aligned block, since that leaves the file offset
+   unaligned.  When the writer asks for a sync ("S"), it is done once all that
+   was queued before it has been written, so a flush costs one fdatasync() for
+   the whole batch however many buffers it took, and nothing is synced between
+   flushes.  After an error the rest is discarded, and the error is reported
+   by the next gz_wqueue(). */
+local void *gz_wthread(arg)
+    void *arg;
+{
+    gz_statep state = (gz_statep)arg;
+    gz_wbehind *wb = state->wb;
+    struct iovec iov[GZ_SLOTS];
+    unsigned n, k, slot;
+    ssize_t got;
+    int err = 0;
+    int dirty = 0;
+
+    pthread_mutex_lock(&(wb->lock));
+    for (;;) {
+        while (wb->ready == 0 && !wb->sync && !wb->stop)
+            pthread_cond_wait(&(wb->queued), &(wb->lock));
+
+        /* sync what has been written since the last sync */
+        if (wb->ready == 0 && wb->sync) {
+            pthread_mutex_unlock(&(wb->lock));
+            if (dirty && !err && GZ_DSYNC(state->fd) == -1)
+                err = errno;
+            dirty = 0;
+            pthread_mutex_lock(&(wb->lock));
+            wb->sync = 0;
+            wb->err = err;
+            pthread_cond_signal(&(wb->written));
+            continue;
+        }
+        if (wb->ready == 0)
+            break;
+
+        /* take everything queued */
+        n = wb->ready;
+        wb->ready = 0;
+        slot = wb->tail;
+        for (k = 0; k < n; k++) {
+            iov[k].iov_base = wb->next[slot];
+            iov[k].iov_len = wb->len[slot];
+            slot = (slot + 1) % GZ_SLOTS;
+        }
+        pthread_mutex_unlock(&(wb->lock));
+
+#ifdef O_DIRECT
+        /* drop O_DIRECT before the first write that can't use it */
+        if (wb->odirect)
+            for (k = 0; k < n; k++)
+                if ((size_t)iov[k].iov_base % GZ_ALIGN ||
+                        iov[k].iov_len % GZ_ALIGN) {
+                    fcntl(state->fd, F_SETFL,
+                          fcntl(state->fd, F_GETFL) & ~O_DIRECT);
+                    wb->odirect = 0;
+                    break;
+                }
+#endif
+
+        /* write it all, picking up after short writes */
+        k = 0;
+        while (k < n && !err) {
+            got = writev(state->fd, iov + k, (int)(n - k));
+            if (got < 0) {
+                if (errno != EINTR)
+                    err = errno;
+                continue;
+            }
+            while (k < n && (size_t)got >= iov[k].iov_len)
+                got -= iov[k++].iov_len;
+            if (k < n) {
+                iov[k].iov_base = (char *)iov[k].iov_base + got;
+                iov[k].iov_len -= got;
+            }
+        }
+        dirty = state->dsync;
+
+        /* hand the buffers back */
+        pthread_mutex_lock(&(wb->lock));
+        wb->tail = slot;
+        wb->pending -= n;
+        wb->err = err;
+        pthread_cond_signal(&(wb->written));
+    }
+
+    /* the end of the file gets synced too */
+    if (dirty && !err && GZ_DSYNC(state->fd) == -1)
+        wb->err = errno;
+    pthread_mutex_unlock(&(wb->lock));
+    return NULL;
+}
+
+/* Allocate the write-behind ring in place of the output buffer, turn on
+   O_DIRECT if requested and possible, and start the helper thread.  The ring
+   buffers are aligned for O_DIRECT.  Return -1 on failure or 0 on success. */
+local int gz_winit(state)
+    gz_statep state;
+{
+    unsigned n;
+    gz_wbehind *wb;
+
+    wb = (gz_wbehind *)malloc(sizeof(gz_wbehind));
+    if (wb == NULL) {
+        gz_error(state, Z_MEM_ERROR, "out of memory");
+        return -1;
+    }
+    for (n = 0; n < GZ_SLOTS; n++)
+        if (posix_memalign((void **)&(wb->buf[n]), GZ_ALIGN, state->want))
+            break;
+    if (n < GZ_SLOTS) {
+        while (n)
+            free(wb->buf[--n]);
+        free(wb);
+        gz_error(state, Z_MEM_ERROR, "out of memory");
+        return -1;
+    }
+    wb->cur = wb->head = wb->tail = 0;
+    wb->ready = wb->pending = 0;
+    wb->sync = 0;
+    wb->stop = 0;
+    wb->err = 0;
+
+    /* O_DIRECT needs an aligned file offset, and may not be supported by the
+       file system, in which case just write normally */
+    wb->odirect = 0;
+#ifdef O_DIRECT
+    if (state->odirect && lseek(state->fd, 0, SEEK_CUR) % GZ_ALIGN == 0 &&
+            fcntl(state->fd, F_SETFL,
+                  fcntl(state->fd, F_GETFL) | O_DIRECT) != -1)
+        wb->odirect = 1;
+#endif
+
+    pthread_mutex_init(&(wb->lock), NULL);
+    pthread_cond_init(&(wb->queued), NULL);
+    pthread_cond_init(&(wb->written), NULL);
+    state->wb = wb;
+    if (pthread_create(&(wb->thread), NULL, gz_wthread, state) != 0) {
+        pthread_cond_destroy(&(wb->written));
+        pthread_cond_destroy(&(wb->queued));
+        pthread_mutex_destroy(&(wb->lock));
+        for (n = 0; n < GZ_SLOTS; n++)
+            free(wb->buf[n]);
+        free(wb);
+        state->wb = NULL;
+        gz_error(state, Z_ERRNO, "could not start write-behind thread");
+        return -1;
+    }
+    state->out = wb->buf[0];
+    return 0;
+}
+
+/* Queue the have bytes at state->x.next for the helper to write.  If the
+   current buffer is full, move deflate on to the next one, waiting for it to
+   be written first if needed.  Otherwise this is a flush, so wait for all of
+   it to be written before returning.  Return -1 on error, 0 on success. */
+local int gz_wqueue(state, have)
+    gz_statep state;
+    unsigned have;
+{
+    int err;
+    z_streamp strm = &(state->strm);
+    gz_wbehind *wb = state->wb;
+
+    pthread_mutex_lock(&(wb->lock));
+    if (have) {
+        wb->next[wb->head] = state->x.next;
+        wb->len[wb->head] = have;
+        wb->head = (wb->head + 1) % GZ_SLOTS;
+        wb->ready++;
+        wb->pending++;
+        pthread_cond_signal(&(wb->queued));
+    }
+    if (strm->avail_out == 0) {
+        wb->cur = (wb->cur + 1) % GZ_SLOTS;
+        while (wb->pending == GZ_SLOTS)
+            pthread_cond_wait(&(wb->written), &(wb->lock));
+        state->out = wb->buf[wb->cur];
+    }
+    else
+        while (wb->pending)
+            pthread_cond_wait(&(wb->written), &(wb->lock));
+    err = wb->err;
+    pthread_mutex_unlock(&(wb->lock));
+    if (err) {
+        errno = err;
+        gz_error(state, Z_ERRNO, zstrerror());
+        return -1;
+    }
+    return 0;
+}
+
+/* Have the helper sync the file once it has written everything queued, and
+   wait for that.  Return -1 on error, 0 on success. */
+local int gz_wsync(state)
+    gz_statep state;
+{
+    int err;
+    gz_wbehind *wb = state->wb;
+
+    pthread_mutex_lock(&(wb->lock));
+    wb->sync = 1;
+    pthread_cond_signal(&(wb->queued));
+    while (wb->pending || wb->sync)
+        pthread_cond_wait(&(wb->written), &(wb->lock));
+    err = wb->err;
+    pthread_mutex_unlock(&(wb->lock));
+    if (err) {
+        errno = err;
+        gz_error(state, Z_ERRNO, zstrerror());
+        return -1;
+    }
+    return 0;
+}
+
+/* Stop the write-behind helper thread once it has written everything queued,
+   and free the ring.  Return -1 if a write or sync failed, 0 otherwise. */
+local int gz_wstop(state)
+    gz_statep state;
+{
+    unsigned n;
+    int err;
+    gz_wbehind *wb = state->wb;
+
+    pthread_mutex_lock(&(wb->lock));
+    wb->stop = 1;
+    pthread_cond_signal(&(wb->queued));
+    pthread_mutex_unlock(&(wb->lock));
+    pthread_join(wb->thread, NULL);
+    err = wb->err;
+    pthread_cond_destroy(&(wb->written));
+    pthread_cond_destroy(&(wb->queued));
+    pthread_mutex_destroy(&(wb->lock));
+    for (n = 0; n < GZ_SLOTS; n++)
+        free(wb->buf[n]);
+    free(wb);
+    state->wb = NULL;
+    state->out = NULL;
+    return err ? -1 : 0;
+}
+#endif
 
 /* Initialize state for writing a gzip file.  Mark initialization by setting
    state->size to non-zero.  Return -1 on failure or 0 on success. */
@@ -18,6 +272,12 @@ local int gz_init(state)
     int ret;
     z_streamp strm = &(state->strm);
 
+#ifdef GZ_PREFETCH
+    /* O_DIRECT writes need whole blocks */
+    if (state->odirect && !state->direct)
+        state->want = (state->want + GZ_ALIGN - 1) & ~(unsigned)(GZ_ALIGN - 1);
+#endif
+
     /* allocate input buffer */
     state->in = (unsigned char *)malloc(state->want);
     if (state->in == NULL) {
@@ -28,6 +288,15 @@ local int gz_init(state)
     /* only need output buffer and deflate state if compressing */
     if (!state->direct) {
         /* allocate output buffer */
+#ifdef GZ_PREFETCH
+        if (state->prefetch) {
+            if (gz_winit(state) == -1) {
+                free(state->in);
+                return -1;
+            }
+        }
+        else
+#endif
         state->out = (unsigned char *)malloc(state->want);
         if (state->out == NULL) {
             free(state->in);
@@ -42,6 +311,11 @@ local int gz_init(state)
         ret = deflateInit2(strm, state->level, Z_DEFLATED,
                            MAX_WBITS + 16, DEF_MEM_LEVEL, state->strategy);
         if (ret != Z_OK) {
+#ifdef GZ_PREFETCH
+            if (state->wb != NULL)
+                gz_wstop(state);
+            else
+#endif
             free(state->out);
             free(state->in);
             gz_error(state, Z_MEM_ERROR, "out of memory");
@@ -98,6 +372,13 @@ local int gz_comp(state, flush)
         if (strm->avail_out == 0 || (flush != Z_NO_FLUSH &&
             (flush != Z_FINISH || ret == Z_STREAM_END))) {
             have = (unsigned)(strm->next_out - state->x.next);
+#ifdef GZ_PREFETCH
+            if (state->wb != NULL) {
+                if (gz_wqueue(state, have) == -1)
+                    return -1;
+            }
+            else
+#endif
             if (have && ((got = write(state->fd, state->x.next, have)) < 0 ||
                          (unsigned)got != have)) {
                 gz_error(state, Z_ERRNO, zstrerror());
@@ -121,6 +402,13 @@ local int gz_comp(state, flush)
         have -= strm->avail_out;
     } while (have);
 
+#ifdef GZ_PREFETCH
+    /* sync once for everything this flush wrote */
+    if (flush != Z_NO_FLUSH && state->dsync && state->wb != NULL &&
+            gz_wsync(state) == -1)
+        return -1;
+#endif
+
     /* if that completed a deflate stream, allow another to start */
     if (flush == Z_FINISH)
         deflateReset(strm);
@@ -564,6 +852,13 @@ int ZEXPORT gzclose_w(file)
     if (state->size) {
         if (!state->direct) {
             (void)deflateEnd(&(state->strm));
+#ifdef GZ_PREFETCH
+            if (state->wb != NULL) {
+                if (gz_wstop(state) == -1 && ret == Z_OK)
+                    ret = Z_ERRNO;
+            }
+            else
+#endif
             free(state->out);
         }
         free(state->in);
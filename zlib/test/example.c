@@ -189,6 +189,55 @@ void test_gzio(fname, uncompr, uncomprLen)
     }
 
     gzclose(file);
+
+    /* write and read again with write-behind, syncing at each flush, and
+       read-ahead ("p" and "S" are ignored without GZ_PREFETCH) */
+    file = gzopen(fname, "wbpS");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    if (gzputs(file, "hello,") != 6 || gzflush(file, Z_SYNC_FLUSH) != Z_OK ||
+        gzprintf(file, " %s!", "hello") != 7 || gzputc(file, 0) != 0) {
+        fprintf(stderr, "gzwrite write-behind err: %s\n", gzerror(file, &err));
+        exit(1);
+    }
+    if (gzclose(file) != Z_OK) {
+        fprintf(stderr, "gzclose write-behind error\n");
+        exit(1);
+    }
+
+    file = gzopen(fname, "rbp");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    strcpy((char*)uncompr, "garbage");
+
+    if (gzread(file, uncompr, (unsigned)uncomprLen) != len) {
+        fprintf(stderr, "gzread read-ahead err: %s\n", gzerror(file, &err));
+        exit(1);
+    }
+    if (strcmp((char*)uncompr, hello)) {
+        fprintf(stderr, "bad gzread read-ahead: %s\n", (char*)uncompr);
+        exit(1);
+    }
+
+    pos = gzseek(file, 7L, SEEK_SET);
+    if (pos != 7 || gzgetc(file) != 'h' || gzungetc('H', file) != 'H') {
+        fprintf(stderr, "gzseek read-ahead error, pos=%ld\n", (long)pos);
+        exit(1);
+    }
+    gzgets(file, (char*)uncompr, (int)uncomprLen);
+    if (strcmp((char*)uncompr, "Hello!")) {
+        fprintf(stderr, "bad gzgets read-ahead: %s\n", (char*)uncompr);
+        exit(1);
+    } else {
+        printf("gzwrite()/gzread() with write-behind/read-ahead: %s\n",
+               hello);
+    }
+
+    gzclose(file);
 #endif
 }
 
@@ -1241,6 +1241,22 @@ ZEXTERN gzFile ZEXPORT gzopen OF((const char *path, const char *mode));
    "x" when writing will create the file exclusively, which fails if the file
    already exists.  On systems that support it, the addition of "e" when
    reading or writing will set the flag to close the file on an execve() call.
+   If zlib was compiled with GZ_PREFETCH, the addition of "p" when reading will
+   start a helper thread on the first read that reads and decompresses ahead
+   into a ring of buffers, each twice the gzbuffer() size, so that file input
+   and inflate overlap with the application's processing of the data.  gzread,
+   gzgets, gzgetc, gzungetc, gzseek, and gzrewind work as usual; gzoffset then
+   reports the offset after the compressed data of the buffer being consumed.
+   When writing, "p" instead has deflate fill a ring of gzbuffer()-sized output
+   buffers while a helper thread writes all of the full ones with a single
+   writev(), so compression and file output overlap.  gzflush and gzclose wait
+   for the helper to write everything.  Adding "D" as well, on systems with
+   O_DIRECT, writes whole aligned blocks with O_DIRECT, bypassing the page
+   cache, until the first flush or the end of the file.  Adding "S" makes
+   gzflush and gzclose also sync the file to storage.  The helper does one
+   fdatasync() (or fsync()) per flush, after it has written everything queued,
+   rather than one per buffer written.  Without GZ_PREFETCH, "p", "D", and "S"
+   are ignored.
 
      These functions, as well as gzip, will read and decode a sequence of gzip
    streams in a file.  The append function of gzopen() can be used to create